@@ -0,0 +1,136 @@
+#ifndef __STOUT_ARENA_HPP__
+#define __STOUT_ARENA_HPP__
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h> // For malloc and free.
+#include <string.h> // For memcpy.
+
+#include <new> // For std::bad_alloc.
+#include <vector>
+
+// A "bump" allocator: memory is handed out from large blocks by
+// moving a pointer, and only freed all at once (when the arena gets
+// destroyed or cleared). This makes allocating many small objects
+// that live and die together (e.g., the nodes of a JSON::Document)
+// about as cheap as it gets. Note that destructors are never run,
+// i.e., only use it for trivially destructible types.
+class Arena
+{
+public:
+  explicit Arena(size_t _size = 4096)
+    : size(_size), current(NULL), remaining(0), last(0) {}
+
+  ~Arena()
+  {
+    for (size_t i = 0; i < blocks.size(); i++) {
+      free(blocks[i]);
+    }
+  }
+
+  void* allocate(size_t bytes, size_t alignment = sizeof(double))
+  {
+    assert((alignment & (alignment - 1)) == 0);
+
+    size_t padding = pad(current, alignment);
+    if (current == NULL || padding + bytes > remaining) {
+      grow(bytes + alignment);
+      padding = pad(current, alignment);
+    }
+
+    char* p = current + padding;
+    current = p + bytes;
+    remaining -= padding + bytes;
+    return p;
+  }
+
+  // Resizes an allocation, in place if it was the last one and there
+  // is room, otherwise by allocating and copying.
+  void* reallocate(
+      void* p,
+      size_t bytes,
+      size_t size,
+      size_t alignment = sizeof(double))
+  {
+    if (p != NULL && static_cast<char*>(p) + bytes == current &&
+        size >= bytes && size - bytes <= remaining) {
+      current += size - bytes;
+      remaining -= size - bytes;
+      return p;
+    }
+
+    void* q = allocate(size, alignment);
+    if (p != NULL) {
+      memcpy(q, p, bytes < size ? bytes : size);
+    }
+    return q;
+  }
+
+  // Returns a copy of the characters (not NUL terminated).
+  char* copy(const char* data, size_t length)
+  {
+    char* s = static_cast<char*>(allocate(length, 1));
+    memcpy(s, data, length);
+    return s;
+  }
+
+  // Frees everything allocated but keeps the last block around for
+  // reuse.
+  void clear()
+  {
+    if (blocks.empty()) {
+      return;
+    }
+
+    for (size_t i = 0; i + 1 < blocks.size(); i++) {
+      free(blocks[i]);
+    }
+    blocks.erase(blocks.begin(), blocks.end() - 1);
+
+    current = blocks.back();
+    remaining = last;
+  }
+
+private:
+  // Not copyable, not assignable.
+  Arena(const Arena&);
+  Arena& operator = (const Arena&);
+
+  static size_t pad(const char* p, size_t alignment)
+  {
+    return (alignment - (reinterpret_cast<uintptr_t>(p) & (alignment - 1))) &
+      (alignment - 1);
+  }
+
+  // Allocates a new block (twice as large as the last one, up to
+  // 1MB, but always large enough for the given number of bytes).
+  void grow(size_t bytes)
+  {
+    if (!blocks.empty() && size < 1024 * 1024) {
+      size *= 2;
+    }
+
+    const size_t length = bytes > size ? bytes : size;
+
+    char* block = static_cast<char*>(malloc(length));
+    if (block == NULL) {
+      throw std::bad_alloc();
+    }
+
+    blocks.push_back(block);
+    current = block;
+    remaining = length;
+    last = length;
+  }
+
+  size_t size; // Of the next block.
+
+  std::vector<char*> blocks;
+
+  char* current;
+  size_t remaining; // Bytes left in the current block.
+  size_t last; // Size of the current (i.e., last) block.
+};
+
+#endif // __STOUT_ARENA_HPP__
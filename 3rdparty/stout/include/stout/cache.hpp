@@ -1,63 +1,129 @@
 #ifndef __STOUT_CACHE_HPP__
 #define __STOUT_CACHE_HPP__
 
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __MACH__
+#include <mach/clock.h>
+#include <mach/mach.h>
+#endif // __MACH__
+
+#include <algorithm>
 #include <functional>
 #include <iostream>
-#include <list>
 #include <map>
+#include <vector>
+
+#include <glog/logging.h>
 
 #include <tr1/functional>
 #include <tr1/unordered_map>
 
+#include "duration.hpp"
+#include "eviction.hpp"
 #include "none.hpp"
 #include "option.hpp"
+#include "timerwheel.hpp"
 
 // Forward declaration.
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Policy>
 class cache;
 
-// Outputs the key/value pairs from least to most-recently used.
-template <typename Key, typename Value>
+// Outputs the key/value pairs (in no particular order).
+template <typename Key, typename Value, typename Policy>
 std::ostream& operator << (
     std::ostream& stream,
-    const cache<Key, Value>& c);
+    const cache<Key, Value, Policy>& c);
 
 
-// Provides a least-recently used (LRU) cache of some predefined
-// capacity. A "write" and a "read" both count as uses.
-template <typename Key, typename Value>
+// Provides a cache of some predefined capacity which evicts entries
+// as decided by a policy (see stout/eviction.hpp), by default the
+// least-recently used (LRU) one. A "write" and a "read" both count as
+// uses. For example, to keep the keys used most often cached despite
+// periodic scans:
+//
+//   cache<std::string, Value, eviction::tinylfu<std::string> > c(1024);
+//
+// Entries can also be given a time-to-live after which they expire
+// (according to the monotonic clock, with millisecond resolution,
+// unless some other clock is given, e.g., by tests). Expired entries
+// are removed by a timer wheel (see stout/timerwheel.hpp) as part of
+// later puts and gets.
+template <typename Key, typename Value,
+          typename Policy = eviction::lru<Key> >
 class cache
 {
+private:
+  struct entry
+  {
+    entry(const Value& _value, const typename Policy::handle& _handle)
+      : value(_value), handle(_handle), expires(false), timer() {}
+
+    Value value;
+    typename Policy::handle handle;
+
+    bool expires;
+    typename timerwheel<Key>::handle timer; // Only valid if 'expires'.
+  };
+
 public:
-  typedef std::list<Key> list;
-  typedef std::tr1::unordered_map<
-    Key, std::pair<Value, typename list::iterator> > map;
+  typedef std::tr1::unordered_map<Key, entry> map;
+
+  // Returns the current time in milliseconds.
+  typedef std::tr1::function<uint64_t()> clock;
 
-  explicit cache(int _capacity) : capacity(_capacity) {}
+  explicit cache(int _capacity, const clock& _time = clock())
+    : capacity(_capacity), policy(_capacity), time(_time) {}
 
   void put(const Key& key, const Value& value)
   {
-    typename map::iterator i = values.find(key);
-    if (i == values.end()) {
-      insert(key, value);
-    } else {
-      (*i).second.first = value;
-      use(i);
+    expire();
+    update(key, value);
+  }
+
+  // Puts the key/value which expires after the given time-to-live
+  // (unless put again before that).
+  void put(const Key& key, const Value& value, const Duration& ttl)
+  {
+    const uint64_t now = this->now();
+
+    // Bring the timer wheel up to date before scheduling.
+    expire(now);
+
+    typename map::iterator i = update(key, value);
+
+    if (i != values.end()) {
+      const double ms = ceil(std::max(0.0, ttl.ms()));
+      (*i).second.timer =
+        timers.schedule(key, now + static_cast<uint64_t>(ms));
+      (*i).second.expires = true;
     }
   }
 
   Option<Value> get(const Key& key)
   {
+    expire();
+
     typename map::iterator i = values.find(key);
 
     if (i != values.end()) {
-      use(i);
-      return (*i).second.first;
+      policy.use((*i).second.handle);
+      return (*i).second.value;
     }
 
     return None();
   }
 
+  // Returns the number of entries, including those that have expired
+  // but not yet been removed.
+  size_t size() const
+  {
+    return values.size();
+  }
+
 private:
   // Not copyable, not assignable.
   cache(const cache&);
@@ -66,64 +132,136 @@ private:
   // Give the operator access to our internals.
   friend std::ostream& operator << <>(
       std::ostream& stream,
-      const cache<Key, Value>& c);
+      const cache<Key, Value, Policy>& c);
 
-  // Insert key/value into the cache.
-  void insert(const Key& key, const Value& value)
+  // Inserts or updates key/value (without a time-to-live), returns
+  // the entry or 'values.end()' if the policy didn't admit it.
+  typename map::iterator update(const Key& key, const Value& value)
   {
-    if (keys.size() == capacity) {
-      evict();
+    typename map::iterator i = values.find(key);
+    if (i == values.end()) {
+      return insert(key, value);
     }
 
-    // Get a "pointer" into the lru list for efficient update.
-    typename list::iterator i = keys.insert(keys.end(), key);
+    (*i).second.value = value;
+    policy.use((*i).second.handle);
 
-    // Save key/value and "pointer" into lru list.
-    values.insert(std::make_pair(key, std::make_pair(value, i)));
+    if ((*i).second.expires) {
+      timers.cancel((*i).second.timer);
+      (*i).second.expires = false;
+    }
+
+    return i;
   }
 
-  // Updates the LRU ordering in the cache for the given iterator.
-  void use(const typename map::iterator& i)
+  // Insert key/value into the cache. Note that we evict after
+  // inserting since the policy might not admit the new key.
+  typename map::iterator insert(const Key& key, const Value& value)
   {
-    // Move the "pointer" to the end of the lru list.
-    keys.splice(keys.end(), keys, (*i).second.second);
+    // Save key/value and the handle from the policy.
+    typename map::iterator i =
+      values.insert(std::make_pair(key, entry(value, policy.insert(key))))
+      .first;
+
+    if (values.size() > capacity) {
+      const Key evicted = policy.evict();
+      if (evicted == key) {
+        remove(i);
+        return values.end();
+      }
+      evict(evicted);
+    }
 
-    // Now update the "pointer" so we can do this again.
-    (*i).second.second = --keys.end();
+    return i;
   }
 
-  // Evict the least-recently used element from the cache.
-  void evict()
+  // Evict the element chosen by the policy.
+  void evict(const Key& key)
   {
-    const typename map::iterator& i = values.find(keys.front());
+    const typename map::iterator& i = values.find(key);
     CHECK(i != values.end());
+    remove(i);
+  }
+
+  // Removes an entry the policy no longer keeps track of.
+  void remove(const typename map::iterator& i)
+  {
+    if ((*i).second.expires) {
+      timers.cancel((*i).second.timer);
+    }
     values.erase(i);
-    keys.pop_front();
+  }
+
+  // Removes the entries that have expired (if any can).
+  void expire()
+  {
+    if (timers.size() > 0) {
+      expire(now());
+    }
+  }
+
+  void expire(uint64_t now)
+  {
+    std::vector<Key> expired;
+    timers.advance(now, &expired);
+
+    for (size_t i = 0; i < expired.size(); i++) {
+      typename map::iterator j = values.find(expired[i]);
+      CHECK(j != values.end());
+      policy.erase((*j).second.handle);
+      values.erase(j);
+    }
+  }
+
+  // Returns the time of the clock (if any) in milliseconds.
+  uint64_t now() const
+  {
+    return time ? time() : monotonic();
+  }
+
+  // Returns the time of the monotonic clock in milliseconds.
+  static uint64_t monotonic()
+  {
+#ifdef __MACH__
+    // OS X does not have clock_gettime, use clock_get_time.
+    clock_serv_t cclock;
+    mach_timespec_t mts;
+    host_get_clock_service(mach_host_self(), SYSTEM_CLOCK, &cclock);
+    clock_get_time(cclock, &mts);
+    mach_port_deallocate(mach_task_self(), cclock);
+    return static_cast<uint64_t>(mts.tv_sec) * 1000 + mts.tv_nsec / 1000000;
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+#endif // __MACH__
   }
 
   // Size of the cache.
-  int capacity;
+  size_t capacity;
 
-  // Cache of values and "pointers" into the least-recently used list.
+  // Cache of values and handles for the policy.
   map values;
 
-  // Keys ordered by least-recently used.
-  list keys;
+  // Decides which key to evict.
+  Policy policy;
+
+  // When entries with a time-to-live expire.
+  timerwheel<Key> timers;
+
+  // Clock for the time-to-live, the monotonic one if empty.
+  clock time;
 };
 
 
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Policy>
 std::ostream& operator << (
     std::ostream& stream,
-    const cache<Key, Value>& c)
+    const cache<Key, Value, Policy>& c)
 {
-  typename cache<Key, Value>::list::const_iterator i1;
-  for (i1 = c.keys.begin(); i1 != c.keys.end(); i1++) {
-    stream << *i1 << ": ";
-    typename cache<Key, Value>::map::const_iterator i2;
-    i2 = c.values.find(*i1);
-    CHECK(i2 != c.values.end());
-    stream << *i2 << std::endl;
+  typename cache<Key, Value, Policy>::map::const_iterator i;
+  for (i = c.values.begin(); i != c.values.end(); i++) {
+    stream << (*i).first << ": " << (*i).second.value << std::endl;
   }
   return stream;
 }
@@ -0,0 +1,407 @@
+#ifndef __STOUT_CONCURRENT_CACHE_HPP__
+#define __STOUT_CONCURRENT_CACHE_HPP__
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include <vector>
+
+#include <tr1/functional>
+
+#include "none.hpp"
+#include "option.hpp"
+
+// Provides a least-recently used (LRU) cache that can be used from
+// multiple threads. The cache is split into a number of shards (by
+// hash of the key), each with its own lock, LRU list and capacity, so
+// threads only contend when they use keys of the same shard. Each
+// entry costs a single allocation: it's a node in both the (intrusive)
+// hash table and LRU list of its shard and stores its key only once.
+//
+// The capacity is in terms of a "weight" which is 1 per entry by
+// default, or given by a function of the key and value (e.g., their
+// size in bytes). Note that each shard gets an equal share of the
+// capacity, so an entry that weighs more than that is never cached.
+template <typename Key, typename Value>
+class concurrent_cache
+{
+public:
+  typedef std::tr1::function<size_t(const Key&, const Value&)> weigher;
+
+  struct statistics
+  {
+    statistics()
+      : hits(0), misses(0), evictions(0), size(0), weight(0) {}
+
+    long hits;
+    long misses;
+    long evictions; // Including entries too heavy to be cached.
+    size_t size; // Number of entries.
+    size_t weight; // Total weight of the entries.
+  };
+
+  // Creates a cache of (at most) the given capacity split across
+  // 'shards' shards (rounded up to a power of two, but fewer if the
+  // capacity is too small to give each shard a share).
+  explicit concurrent_cache(
+      size_t capacity,
+      size_t shards = 16,
+      const weigher& _weigh = weigher())
+    : weigh(_weigh),
+      count(1)
+  {
+    size_t shift = 0;
+    while (count < shards && count * 2 <= capacity) {
+      count *= 2;
+      shift++;
+    }
+
+    this->shards = new shard[count];
+    for (size_t i = 0; i < count; i++) {
+      this->shards[i].capacity = capacity / count;
+      this->shards[i].shift = shift;
+    }
+  }
+
+  ~concurrent_cache()
+  {
+    delete[] shards;
+  }
+
+  void put(const Key& key, const Value& value)
+  {
+    const size_t hash = mix(hasher(key));
+    const size_t weight = weigh ? weigh(key, value) : 1;
+
+    shard& s = select(hash);
+
+    pthread_mutex_lock(&s.mutex);
+
+    node* n = s.find(key, hash);
+
+    // An entry too heavy to ever fit isn't cached (rather than evicting
+    // everything else first), but it still replaces any previous value.
+    if (weight > s.capacity) {
+      if (n != NULL) {
+        s.remove(n);
+        delete n;
+      }
+      s.evictions++;
+      pthread_mutex_unlock(&s.mutex);
+      return;
+    }
+
+    if (n != NULL) {
+      n->value = value;
+      s.weight = s.weight - n->weight + weight;
+      n->weight = weight;
+      s.use(n);
+    } else {
+      s.insert(new node(key, value, hash, weight));
+    }
+
+    s.evict();
+
+    pthread_mutex_unlock(&s.mutex);
+  }
+
+  Option<Value> get(const Key& key)
+  {
+    const size_t hash = mix(hasher(key));
+
+    shard& s = select(hash);
+
+    pthread_mutex_lock(&s.mutex);
+
+    node* n = s.find(key, hash);
+
+    if (n == NULL) {
+      s.misses++;
+      pthread_mutex_unlock(&s.mutex);
+      return None();
+    }
+
+    s.hits++;
+    s.use(n);
+
+    Option<Value> value = n->value;
+
+    pthread_mutex_unlock(&s.mutex);
+
+    return value;
+  }
+
+  // Removes the entry, returns false if there was none.
+  bool erase(const Key& key)
+  {
+    const size_t hash = mix(hasher(key));
+
+    shard& s = select(hash);
+
+    pthread_mutex_lock(&s.mutex);
+
+    node* n = s.find(key, hash);
+
+    if (n != NULL) {
+      s.remove(n);
+      delete n;
+    }
+
+    pthread_mutex_unlock(&s.mutex);
+
+    return n != NULL;
+  }
+
+  void clear()
+  {
+    for (size_t i = 0; i < count; i++) {
+      pthread_mutex_lock(&shards[i].mutex);
+      shards[i].clear();
+      pthread_mutex_unlock(&shards[i].mutex);
+    }
+  }
+
+  // Returns the statistics summed over all shards. Note that shards
+  // are read one after the other, i.e., not atomically.
+  statistics stats() const
+  {
+    statistics result;
+
+    for (size_t i = 0; i < count; i++) {
+      pthread_mutex_lock(&shards[i].mutex);
+      result.hits += shards[i].hits;
+      result.misses += shards[i].misses;
+      result.evictions += shards[i].evictions;
+      result.size += shards[i].size;
+      result.weight += shards[i].weight;
+      pthread_mutex_unlock(&shards[i].mutex);
+    }
+
+    return result;
+  }
+
+private:
+  // Not copyable, not assignable.
+  concurrent_cache(const concurrent_cache&);
+  concurrent_cache& operator = (const concurrent_cache&);
+
+  struct node
+  {
+    node(const Key& _key, const Value& _value, size_t _hash, size_t _weight)
+      : key(_key),
+        value(_value),
+        hash(_hash),
+        weight(_weight),
+        chain(NULL),
+        prev(NULL),
+        next(NULL) {}
+
+    const Key key;
+    Value value;
+    const size_t hash;
+    size_t weight;
+
+    node* chain; // Next node in the same bucket.
+
+    // Neighbors in the LRU list (towards least and most recently
+    // used respectively).
+    node* prev;
+    node* next;
+  };
+
+  struct shard
+  {
+    shard()
+      : buckets(16, static_cast<node*>(NULL)),
+        head(NULL),
+        tail(NULL),
+        size(0),
+        weight(0),
+        capacity(0),
+        shift(0),
+        hits(0),
+        misses(0),
+        evictions(0)
+    {
+      pthread_mutex_init(&mutex, NULL);
+    }
+
+    ~shard()
+    {
+      clear();
+      pthread_mutex_destroy(&mutex);
+    }
+
+    node* find(const Key& key, size_t hash) const
+    {
+      node* n = buckets[index(hash)];
+      while (n != NULL && !(n->hash == hash && n->key == key)) {
+        n = n->chain;
+      }
+      return n;
+    }
+
+    // Adds the node as the most recently used one.
+    void insert(node* n)
+    {
+      if (size == buckets.size()) {
+        rehash(buckets.size() * 2);
+      }
+
+      node*& bucket = buckets[index(n->hash)];
+      n->chain = bucket;
+      bucket = n;
+
+      link(n);
+
+      size++;
+      weight += n->weight;
+    }
+
+    // Unlinks the node from its bucket and the LRU list (but doesn't
+    // delete it).
+    void remove(node* n)
+    {
+      node** p = &buckets[index(n->hash)];
+      while (*p != n) {
+        p = &(*p)->chain;
+      }
+      *p = n->chain;
+
+      unlink(n);
+
+      size--;
+      weight -= n->weight;
+    }
+
+    // Makes the node the most recently used one.
+    void use(node* n)
+    {
+      if (n != tail) {
+        unlink(n);
+        link(n);
+      }
+    }
+
+    // Evicts the least recently used nodes until within capacity.
+    void evict()
+    {
+      while (weight > capacity && head != NULL) {
+        node* n = head;
+        remove(n);
+        delete n;
+        evictions++;
+      }
+    }
+
+    void clear()
+    {
+      while (head != NULL) {
+        node* n = head;
+        remove(n);
+        delete n;
+      }
+    }
+
+    size_t index(size_t hash) const
+    {
+      // The low bits select the shard (see 'select'), so use the
+      // others for the bucket.
+      return (hash >> shift) & (buckets.size() - 1);
+    }
+
+    void rehash(size_t count)
+    {
+      std::vector<node*> previous(count, static_cast<node*>(NULL));
+      buckets.swap(previous);
+
+      for (size_t i = 0; i < previous.size(); i++) {
+        node* n = previous[i];
+        while (n != NULL) {
+          node* chain = n->chain;
+          node*& bucket = buckets[index(n->hash)];
+          n->chain = bucket;
+          bucket = n;
+          n = chain;
+        }
+      }
+    }
+
+    void link(node* n)
+    {
+      n->prev = tail;
+      n->next = NULL;
+      if (tail != NULL) {
+        tail->next = n;
+      } else {
+        head = n;
+      }
+      tail = n;
+    }
+
+    void unlink(node* n)
+    {
+      if (n->prev != NULL) {
+        n->prev->next = n->next;
+      } else {
+        head = n->next;
+      }
+      if (n->next != NULL) {
+        n->next->prev = n->prev;
+      } else {
+        tail = n->prev;
+      }
+    }
+
+    mutable pthread_mutex_t mutex;
+
+    std::vector<node*> buckets; // Size is a power of two.
+
+    node* head; // Least recently used.
+    node* tail; // Most recently used.
+
+    size_t size;
+    size_t weight;
+    size_t capacity;
+    size_t shift; // Number of bits used to select the shard.
+
+    long hits;
+    long misses;
+    long evictions;
+
+    // Keeps the locks of adjacent shards on different cache lines.
+    char padding[64];
+
+  private:
+    // Not copyable, not assignable.
+    shard(const shard&);
+    shard& operator = (const shard&);
+  };
+
+  // Spreads the bits of a hash since std::tr1::hash is the identity
+  // for integers, which would put consecutive keys in the same bucket
+  // of different shards (uses the finalizer of MurmurHash3).
+  static size_t mix(size_t hash)
+  {
+    hash ^= (hash >> 16) >> 16; // Folds in the upper half (if any).
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash;
+  }
+
+  shard& select(size_t hash) const
+  {
+    return shards[hash & (count - 1)];
+  }
+
+  std::tr1::hash<Key> hasher;
+  const weigher weigh;
+
+  size_t count; // Number of shards (a power of two).
+  shard* shards;
+};
+
+#endif // __STOUT_CONCURRENT_CACHE_HPP__
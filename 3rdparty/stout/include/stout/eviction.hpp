@@ -0,0 +1,491 @@
+#ifndef __STOUT_EVICTION_HPP__
+#define __STOUT_EVICTION_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <list>
+#include <vector>
+
+#include <tr1/functional>
+#include <tr1/unordered_map>
+
+// Eviction policies for a cache (see stout/cache.hpp). A policy keeps
+// track of the keys in the cache and decides which one to evict:
+//
+//   // Creates the policy for a cache of the given capacity.
+//   explicit Policy(size_t capacity);
+//
+//   // Adds a key (not yet in the cache), returns a handle the cache
+//   // passes back when the key gets used.
+//   handle insert(const Key& key);
+//
+//   // Records a use (i.e., a hit) of a key.
+//   void use(handle h);
+//
+//   // Removes a key the cache removed (e.g., because it expired).
+//   void erase(handle h);
+//
+//   // Removes a key and returns it for the cache to evict. Only called
+//   // when the cache is over capacity (i.e., never when empty). Note
+//   // that this may be the key that was just inserted, i.e., a policy
+//   // can refuse to admit a key.
+//   Key evict();
+//
+// Handles are iterators into std::list and need to remain valid while
+// policies move entries between lists (which std::list::splice
+// guarantees as of C++11, and every implementation has done before).
+namespace eviction {
+
+// Evicts the least recently used key. Every hit moves its key to the
+// back of the list, and a scan (i.e., many keys used once) flushes
+// all keys that are used more often.
+template <typename Key>
+class lru
+{
+public:
+  typedef typename std::list<Key>::iterator handle;
+
+  explicit lru(size_t) {}
+
+  handle insert(const Key& key)
+  {
+    return keys.insert(keys.end(), key);
+  }
+
+  void use(handle h)
+  {
+    keys.splice(keys.end(), keys, h);
+  }
+
+  void erase(handle h)
+  {
+    keys.erase(h);
+  }
+
+  Key evict()
+  {
+    const Key key = keys.front();
+    keys.pop_front();
+    return key;
+  }
+
+private:
+  std::list<Key> keys; // Least recently used first.
+};
+
+
+// Approximates LRU, but a hit only sets a bit (rather than moving its
+// key) which is cleared when the "hand" passes over the key looking
+// for one to evict, i.e., used keys get a second chance.
+template <typename Key>
+class clock
+{
+private:
+  struct entry
+  {
+    explicit entry(const Key& _key) : key(_key), referenced(false) {}
+
+    Key key;
+    bool referenced;
+  };
+
+public:
+  typedef typename std::list<entry>::iterator handle;
+
+  explicit clock(size_t) : hand(entries.end()) {}
+
+  handle insert(const Key& key)
+  {
+    // Insert "behind" the hand so the key is considered last.
+    return entries.insert(hand, entry(key));
+  }
+
+  void use(handle h)
+  {
+    h->referenced = true;
+  }
+
+  void erase(handle h)
+  {
+    if (h == hand) {
+      hand = entries.erase(h);
+    } else {
+      entries.erase(h);
+    }
+  }
+
+  Key evict()
+  {
+    while (true) {
+      if (hand == entries.end()) {
+        hand = entries.begin();
+      }
+      if (!hand->referenced) {
+        break;
+      }
+      hand->referenced = false;
+      ++hand;
+    }
+
+    const Key key = hand->key;
+    hand = entries.erase(hand);
+    return key;
+  }
+
+private:
+  std::list<entry> entries;
+  handle hand;
+};
+
+
+// S3-FIFO (see "FIFO queues are all you need for cache eviction",
+// SOSP 2023): new keys go into a small FIFO queue (10% of the
+// capacity) and only move to the main FIFO queue if they get used
+// before reaching its end, so keys used only once (e.g., in a scan)
+// get evicted quickly. The main queue reinserts used keys rather than
+// evicting them (like CLOCK with a small counter instead of a bit).
+// Keys evicted from the small queue are remembered (without values)
+// in a ghost queue, and go straight into the main queue if inserted
+// again soon after.
+template <typename Key>
+class s3fifo
+{
+private:
+  struct entry
+  {
+    entry(const Key& _key, bool _main)
+      : key(_key), frequency(0), main(_main) {}
+
+    Key key;
+    int frequency; // Uses (saturating at 3).
+    bool main; // Whether in the main queue (or else the small one).
+  };
+
+  typedef std::list<entry> queue;
+
+public:
+  typedef typename queue::iterator handle;
+
+  explicit s3fifo(size_t capacity)
+    : limit(std::max<size_t>(1, capacity / 10)),
+      ghosts(capacity) {}
+
+  handle insert(const Key& key)
+  {
+    typename ghostmap::iterator i = ghosted.find(key);
+    if (i != ghosted.end()) {
+      ghost.erase(i->second);
+      ghosted.erase(i);
+      return main.insert(main.end(), entry(key, true));
+    }
+
+    return small.insert(small.end(), entry(key, false));
+  }
+
+  void use(handle h)
+  {
+    if (h->frequency < 3) {
+      h->frequency++;
+    }
+  }
+
+  void erase(handle h)
+  {
+    if (h->main) {
+      main.erase(h);
+    } else {
+      small.erase(h);
+    }
+  }
+
+  Key evict()
+  {
+    while (true) {
+      if (!small.empty() && (small.size() >= limit || main.empty())) {
+        handle h = small.begin();
+        if (h->frequency > 0) {
+          h->frequency = 0;
+          h->main = true;
+          main.splice(main.end(), small, h);
+          continue;
+        }
+
+        const Key key = h->key;
+        small.erase(h);
+        remember(key);
+        return key;
+      }
+
+      handle h = main.begin();
+      if (h->frequency > 0) {
+        h->frequency--;
+        main.splice(main.end(), main, h);
+        continue;
+      }
+
+      const Key key = h->key;
+      main.erase(h);
+      return key;
+    }
+  }
+
+private:
+  typedef std::tr1::unordered_map<Key, typename std::list<Key>::iterator>
+    ghostmap;
+
+  void remember(const Key& key)
+  {
+    ghosted[key] = ghost.insert(ghost.end(), key);
+    if (ghost.size() > ghosts) {
+      ghosted.erase(ghost.front());
+      ghost.pop_front();
+    }
+  }
+
+  const size_t limit; // Of the small queue.
+  const size_t ghosts; // Number of keys remembered.
+
+  queue small;
+  queue main;
+
+  std::list<Key> ghost;
+  ghostmap ghosted;
+};
+
+
+// A count-min sketch of how often keys are used, i.e., an estimate
+// that is never lower than the actual count using a few bits per key
+// (see "An improved data stream summary: the count-min sketch and its
+// applications"). Counters saturate at 15 and are all halved every
+// 10 times the capacity increments, so the estimates favor recent
+// uses.
+template <typename Key>
+class sketch
+{
+public:
+  explicit sketch(size_t capacity)
+    : width(16),
+      period(10 * std::max<size_t>(1, capacity)),
+      additions(0)
+  {
+    while (width < capacity) {
+      width *= 2;
+    }
+    counters.resize(DEPTH * width, 0);
+  }
+
+  void increment(const Key& key)
+  {
+    const size_t hash = hasher(key);
+
+    bool added = false;
+    for (size_t row = 0; row < DEPTH; row++) {
+      uint8_t& counter = counters[row * width + index(hash, row)];
+      if (counter < 15) {
+        counter++;
+        added = true;
+      }
+    }
+
+    if (added && ++additions == period) {
+      age();
+    }
+  }
+
+  unsigned estimate(const Key& key) const
+  {
+    const size_t hash = hasher(key);
+
+    unsigned estimate = 15;
+    for (size_t row = 0; row < DEPTH; row++) {
+      estimate = std::min<unsigned>(
+          estimate, counters[row * width + index(hash, row)]);
+    }
+    return estimate;
+  }
+
+private:
+  static const size_t DEPTH = 4;
+
+  // Derives an index per row from the hash (with the finalizer of
+  // MurmurHash3 since std::tr1::hash is the identity for integers).
+  size_t index(size_t hash, size_t row) const
+  {
+    static const size_t seeds[DEPTH] = {
+      0x97cb3127, 0xb492b66f, 0x9ae16a3b, 0xcbf29ce5
+    };
+
+    hash += seeds[row];
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash & (width - 1);
+  }
+
+  void age()
+  {
+    for (size_t i = 0; i < counters.size(); i++) {
+      counters[i] >>= 1;
+    }
+    additions /= 2;
+  }
+
+  size_t width; // Counters per row (a power of two).
+  const size_t period; // Additions between aging.
+  size_t additions;
+
+  std::vector<uint8_t> counters;
+
+  std::tr1::hash<Key> hasher;
+};
+
+
+// W-TinyLFU (see "TinyLFU: A Highly Efficient Cache Admission
+// Policy"): new keys go into a small LRU window (1% of the capacity),
+// and when evicted from there only get admitted into the main cache
+// if they have been used more often (as estimated by a sketch of
+// recent uses) than the key they would replace. The main cache is a
+// segmented LRU: keys start in a probation segment and move into the
+// protected segment (80% of the main cache) when used again.
+template <typename Key>
+class tinylfu
+{
+private:
+  enum Segment {
+    WINDOW,
+    PROBATION,
+    PROTECTED,
+  };
+
+  struct entry
+  {
+    entry(const Key& _key, Segment _segment) : key(_key), segment(_segment) {}
+
+    Key key;
+    Segment segment;
+  };
+
+  typedef std::list<entry> queue;
+
+public:
+  typedef typename queue::iterator handle;
+
+  explicit tinylfu(size_t capacity)
+    : windowed(std::max<size_t>(1, capacity / 100)),
+      mained(capacity > windowed ? capacity - windowed : 0),
+      protectable(mained * 8 / 10),
+      candidate(false),
+      frequencies(capacity) {}
+
+  handle insert(const Key& key)
+  {
+    frequencies.increment(key);
+
+    handle h = window.insert(window.end(), entry(key, WINDOW));
+
+    // Move the least recently used key of the window into probation,
+    // it's the candidate for admission if the cache is over capacity.
+    candidate = false;
+    if (window.size() > windowed) {
+      window.begin()->segment = PROBATION;
+      probation.splice(probation.end(), window, window.begin());
+      candidate = true;
+    }
+
+    return h;
+  }
+
+  void use(handle h)
+  {
+    frequencies.increment(h->key);
+
+    switch (h->segment) {
+      case WINDOW:
+        window.splice(window.end(), window, h);
+        break;
+      case PROBATION:
+        h->segment = PROTECTED;
+        protection.splice(protection.end(), probation, h);
+        if (protection.size() > protectable) {
+          // Demote the least recently used protected key.
+          handle demoted = protection.begin();
+          demoted->segment = PROBATION;
+          probation.splice(probation.end(), protection, demoted);
+        }
+        break;
+      case PROTECTED:
+        protection.splice(protection.end(), protection, h);
+        break;
+    }
+  }
+
+  void erase(handle h)
+  {
+    candidate = false;
+
+    switch (h->segment) {
+      case WINDOW:
+        window.erase(h);
+        break;
+      case PROBATION:
+        probation.erase(h);
+        break;
+      case PROTECTED:
+        protection.erase(h);
+        break;
+    }
+  }
+
+  Key evict()
+  {
+    if (candidate && probation.size() > 1) {
+      candidate = false;
+
+      // Only admit the candidate if it has been used more often than
+      // the key it would replace.
+      if (frequencies.estimate(probation.back().key) >
+          frequencies.estimate(probation.front().key)) {
+        return erase(probation, probation.begin());
+      }
+      return erase(probation, --probation.end());
+    }
+
+    if (!probation.empty()) {
+      return erase(probation, probation.begin());
+    } else if (!protection.empty()) {
+      return erase(protection, protection.begin());
+    }
+
+    return erase(window, window.begin());
+  }
+
+private:
+  Key erase(queue& q, handle h)
+  {
+    const Key key = h->key;
+    q.erase(h);
+    return key;
+  }
+
+  const size_t windowed; // Capacity of the window.
+  const size_t mained; // Capacity of the main cache.
+  const size_t protectable; // Capacity of the protected segment.
+
+  queue window;
+  queue probation;
+  queue protection;
+
+  // Whether the last key of probation is a candidate for admission,
+  // i.e., it was just moved there from the window.
+  bool candidate;
+
+  sketch<Key> frequencies;
+};
+
+} // namespace eviction {
+
+#endif // __STOUT_EVICTION_HPP__
@@ -5,18 +5,467 @@
 #include <zlib.h>
 #endif
 
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <string>
 
 #include "error.hpp"
+#include "lambda.hpp"
+#include "nothing.hpp"
+#include "option.hpp"
+#include "stringify.hpp"
 #include "try.hpp"
 
 // Compression utilities.
-// TODO(bmahler): Provide streaming compression / decompression as well.
 namespace gzip {
 
 // We use a 16KB buffer with zlib compression / decompression.
 #define GZIP_BUFFER_SIZE 16384
 
+// Receives output (e.g., to write it somewhere), in chunks of up to
+// GZIP_BUFFER_SIZE bytes.
+typedef lambda::function<Try<Nothing>(const char*, size_t)> Sink;
+
+
+namespace internal {
+
+// A sink which appends to a string.
+inline Try<Nothing> append(std::string* s, const char* data, size_t size)
+{
+  s->append(data, size);
+  return Nothing();
+}
+
+
+// A sink which writes to a file descriptor.
+inline Try<Nothing> write(int fd, const char* data, size_t size)
+{
+  while (size > 0) {
+    const ssize_t length = ::write(fd, data, size);
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return ErrnoError("Failed to write");
+    }
+    data += length;
+    size -= length;
+  }
+  return Nothing();
+}
+
+
+// Reads up to 'size' bytes, returns 0 at the end of the file.
+inline Try<size_t> read(int fd, char* data, size_t size)
+{
+  while (true) {
+    const ssize_t length = ::read(fd, data, size);
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return ErrnoError("Failed to read");
+    }
+    return static_cast<size_t>(length);
+  }
+}
+
+} // namespace internal {
+
+
+#ifdef HAVE_LIBZ
+namespace internal {
+
+// Returns the message zlib left in the stream, if any, or else the
+// one for the code.
+inline std::string message(const z_stream_s& stream, int code)
+{
+  return stream.msg != NULL ? stream.msg : zError(code);
+}
+
+
+// The most zlib (which counts in 32 bits) gets to see at once.
+const size_t MAX_CHUNK = 1 << 30;
+
+} // namespace internal {
+
+
+// Compresses a stream of data incrementally, with memory bounded by
+// zlib's own state (about 256KB) regardless of how much goes through
+// it. Input is either "fed" to the compressor and the output "read"
+// into buffers of the caller:
+//
+//   gzip::Compressor compressor;
+//   compressor.feed(data, size);
+//   while ((n = compressor.read(buffer, sizeof(buffer)).get()) > 0) {
+//     ... // Consume 'n' bytes of 'buffer'.
+//   }
+//   ...
+//   compressor.finish();
+//   while (!compressor.done()) {
+//     n = compressor.read(buffer, sizeof(buffer)).get();
+//     ...
+//   }
+//
+// or passed along with a sink that receives the output:
+//
+//   compressor.compress(data, size, sink);
+//   ...
+//   compressor.finish(sink);
+//
+// Any error (including from a sink) is returned by every later call.
+class Compressor
+{
+public:
+  // The compression level should be within the range [-1, 9] (see
+  // 'compress' below).
+  explicit Compressor(int level = Z_DEFAULT_COMPRESSION)
+    : input(NULL),
+      remaining(0),
+      initialized(false),
+      finished(false),
+      ended(false)
+  {
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+
+    // Verify the level is within range.
+    if (!(level == Z_DEFAULT_COMPRESSION ||
+        (level >= Z_NO_COMPRESSION && level <= Z_BEST_COMPRESSION))) {
+      error = "Invalid compression level: " + stringify(level);
+      return;
+    }
+
+    const int code = deflateInit2(
+        &stream,
+        level,          // Compression level.
+        Z_DEFLATED,     // Compression method.
+        MAX_WBITS + 16, // Zlib magic for gzip compression / decompression.
+        8,              // Default memLevel value.
+        Z_DEFAULT_STRATEGY);
+
+    if (code != Z_OK) {
+      error = "Failed to initialize zlib: " + internal::message(stream, code);
+      return;
+    }
+
+    initialized = true;
+  }
+
+  ~Compressor()
+  {
+    if (initialized) {
+      deflateEnd(&stream);
+    }
+  }
+
+  // Adds input to compress. The data is not copied, it needs to stay
+  // valid until it's been consumed, i.e., until 'read' returns 0.
+  void feed(const char* data, size_t size)
+  {
+    assert(remaining == 0 && !finished);
+    input = data;
+    remaining = size;
+  }
+
+  // Marks the end of input.
+  void finish()
+  {
+    finished = true;
+  }
+
+  // Compresses (fed) input into the buffer, returns the number of
+  // bytes written there. Returns 0 once all input has been consumed
+  // and more is needed (or, after 'finish', when done).
+  Try<size_t> read(char* buffer, size_t size)
+  {
+    if (error.isSome()) {
+      return Error(error.get());
+    } else if (ended) {
+      return 0;
+    }
+
+    size_t produced = 0;
+
+    while (produced < size) {
+      const size_t in = std::min(remaining, internal::MAX_CHUNK);
+      const size_t out = std::min(size - produced, internal::MAX_CHUNK);
+
+      stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+      stream.avail_in = in;
+      stream.next_out = reinterpret_cast<Bytef*>(buffer + produced);
+      stream.avail_out = out;
+
+      const int code =
+        deflate(&stream, finished && in == remaining ? Z_FINISH : Z_NO_FLUSH);
+
+      input += in - stream.avail_in;
+      remaining -= in - stream.avail_in;
+      produced += out - stream.avail_out;
+
+      if (code == Z_STREAM_END) {
+        ended = true;
+        break;
+      } else if (code == Z_BUF_ERROR) {
+        break; // No progress possible, i.e., needs more input.
+      } else if (code != Z_OK) {
+        error = internal::message(stream, code);
+        return Error(error.get());
+      } else if (remaining == 0 && stream.avail_out > 0 && !finished) {
+        break; // Consumed everything (and flushed nothing).
+      }
+    }
+
+    return produced;
+  }
+
+  // Returns whether all output has been read (after 'finish').
+  bool done() const
+  {
+    return ended;
+  }
+
+  // Compresses the data, passing any output to the sink.
+  Try<Nothing> compress(const char* data, size_t size, const Sink& sink)
+  {
+    feed(data, size);
+    return drain(sink);
+  }
+
+  Try<Nothing> compress(const std::string& data, const Sink& sink)
+  {
+    return compress(data.data(), data.size(), sink);
+  }
+
+  // Ends the input, passing the rest of the output to the sink.
+  Try<Nothing> finish(const Sink& sink)
+  {
+    finish();
+    return drain(sink);
+  }
+
+private:
+  // Not copyable, not assignable.
+  Compressor(const Compressor&);
+  Compressor& operator = (const Compressor&);
+
+  // Reads all the output there is (for now) into the sink.
+  Try<Nothing> drain(const Sink& sink)
+  {
+    char buffer[GZIP_BUFFER_SIZE];
+    while (true) {
+      Try<size_t> length = read(buffer, sizeof(buffer));
+      if (length.isError()) {
+        return Error(length.error());
+      } else if (length.get() == 0) {
+        return Nothing();
+      }
+
+      Try<Nothing> sunk = sink(buffer, length.get());
+      if (sunk.isError()) {
+        error = sunk.error();
+        return sunk;
+      }
+    }
+  }
+
+  z_stream_s stream;
+
+  const char* input; // Fed input not yet consumed.
+  size_t remaining;
+
+  bool initialized;
+  bool finished; // Whether all input has been fed.
+  bool ended; // Whether zlib has output everything.
+
+  Option<std::string> error;
+};
+
+
+// Decompresses a stream of data incrementally, with bounded memory
+// (about 40KB of zlib state). Works like the Compressor above, with
+// 'decompress' taking the place of 'compress'. Concatenated gzip
+// "members" decompress into the concatenation of their data (like
+// gunzip does), i.e., a file compressed in pieces decompresses the
+// same as if it had been compressed at once.
+class Decompressor
+{
+public:
+  Decompressor()
+    : input(NULL),
+      remaining(0),
+      initialized(false),
+      finished(false),
+      ended(false)
+  {
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+
+    const int code = inflateInit2(
+        &stream,
+        MAX_WBITS + 16); // Zlib magic for gzip compression / decompression.
+
+    if (code != Z_OK) {
+      error = "Failed to initialize zlib: " + internal::message(stream, code);
+      return;
+    }
+
+    initialized = true;
+  }
+
+  ~Decompressor()
+  {
+    if (initialized) {
+      inflateEnd(&stream);
+    }
+  }
+
+  // Adds input to decompress. The data is not copied, it needs to
+  // stay valid until it's been consumed, i.e., until 'read' returns 0.
+  void feed(const char* data, size_t size)
+  {
+    assert(remaining == 0 && !finished);
+    input = data;
+    remaining = size;
+  }
+
+  // Marks the end of input.
+  void finish()
+  {
+    finished = true;
+  }
+
+  // Decompresses (fed) input into the buffer, returns the number of
+  // bytes written there. Returns 0 once all input has been consumed
+  // and more is needed (or, after 'finish', when done). Fails if the
+  // input ends in the middle of a gzip member.
+  Try<size_t> read(char* buffer, size_t size)
+  {
+    if (error.isSome()) {
+      return Error(error.get());
+    }
+
+    size_t produced = 0;
+
+    while (produced < size) {
+      if (ended) {
+        if (remaining == 0) {
+          break;
+        }
+
+        // Another member follows.
+        inflateReset(&stream);
+        ended = false;
+      }
+
+      const size_t in = std::min(remaining, internal::MAX_CHUNK);
+      const size_t out = std::min(size - produced, internal::MAX_CHUNK);
+
+      stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+      stream.avail_in = in;
+      stream.next_out = reinterpret_cast<Bytef*>(buffer + produced);
+      stream.avail_out = out;
+
+      const int code = inflate(&stream, Z_NO_FLUSH);
+
+      input += in - stream.avail_in;
+      remaining -= in - stream.avail_in;
+      produced += out - stream.avail_out;
+
+      if (code == Z_STREAM_END) {
+        ended = true;
+      } else if (code == Z_BUF_ERROR) {
+        break; // No progress possible, i.e., needs more input.
+      } else if (code != Z_OK) {
+        error = internal::message(stream, code);
+        return Error(error.get());
+      } else if (remaining == 0 && stream.avail_out > 0) {
+        break; // Consumed everything (and output all there is).
+      }
+    }
+
+    if (produced == 0 && finished && remaining == 0 && !ended) {
+      error = std::string("Unexpected end of compressed data");
+      return Error(error.get());
+    }
+
+    return produced;
+  }
+
+  // Returns whether all output has been read (after 'finish').
+  bool done() const
+  {
+    return finished && ended && remaining == 0;
+  }
+
+  // Decompresses the data, passing any output to the sink.
+  Try<Nothing> decompress(const char* data, size_t size, const Sink& sink)
+  {
+    feed(data, size);
+    return drain(sink);
+  }
+
+  Try<Nothing> decompress(const std::string& data, const Sink& sink)
+  {
+    return decompress(data.data(), data.size(), sink);
+  }
+
+  // Ends the input, passing the rest of the output to the sink.
+  Try<Nothing> finish(const Sink& sink)
+  {
+    finish();
+    return drain(sink);
+  }
+
+private:
+  // Not copyable, not assignable.
+  Decompressor(const Decompressor&);
+  Decompressor& operator = (const Decompressor&);
+
+  // Reads all the output there is (for now) into the sink.
+  Try<Nothing> drain(const Sink& sink)
+  {
+    char buffer[GZIP_BUFFER_SIZE];
+    while (true) {
+      Try<size_t> length = read(buffer, sizeof(buffer));
+      if (length.isError()) {
+        return Error(length.error());
+      } else if (length.get() == 0) {
+        return Nothing();
+      }
+
+      Try<Nothing> sunk = sink(buffer, length.get());
+      if (sunk.isError()) {
+        error = sunk.error();
+        return sunk;
+      }
+    }
+  }
+
+  z_stream_s stream;
+
+  const char* input; // Fed input not yet consumed.
+  size_t remaining;
+
+  bool initialized;
+  bool finished; // Whether all input has been fed.
+  bool ended; // Whether the last member has ended.
+
+  Option<std::string> error;
+};
+#endif // HAVE_LIBZ
+
+
 // Returns a gzip compressed version of the provided string.
 // The compression level should be within the range [-1, 9].
 // See zlib.h:
@@ -35,58 +484,22 @@ inline Try<std::string> compress(
 #ifndef HAVE_LIBZ
   return Error("libz is not available");
 #else
-  // Verify the level is within range.
-  if (!(level == Z_DEFAULT_COMPRESSION ||
-      (level >= Z_NO_COMPRESSION && level <= Z_BEST_COMPRESSION))) {
-    return Error("Invalid compression level: " + level);
-  }
+  std::string result;
+  const Sink sink = lambda::bind(&internal::append, &result, lambda::_1,
+                                 lambda::_2);
 
-  z_stream_s stream;
-  stream.next_in =
-    const_cast<Bytef*>(reinterpret_cast<const Bytef*>(decompressed.data()));
-  stream.avail_in = decompressed.length();
-  stream.zalloc = Z_NULL;
-  stream.zfree = Z_NULL;
-  stream.opaque = Z_NULL;
-
-  int code = deflateInit2(
-      &stream,
-      level,          // Compression level.
-      Z_DEFLATED,     // Compression method.
-      MAX_WBITS + 16, // Zlib magic for gzip compression / decompression.
-      8,              // Default memLevel value.
-      Z_DEFAULT_STRATEGY);
-
-  if (code != Z_OK) {
-    return Error("Failed to initialize zlib: " + std::string(stream.msg));
-  }
-
-  // Build up the compressed result.
-  Bytef buffer[GZIP_BUFFER_SIZE];
-  std::string result = "";
-  do {
-    stream.next_out = buffer;
-    stream.avail_out = GZIP_BUFFER_SIZE;
-    code = deflate(&stream, stream.avail_in > 0 ? Z_NO_FLUSH : Z_FINISH);
-
-    if (code != Z_OK && code != Z_STREAM_END) {
-      Error error(std::string(stream.msg));
-      deflateEnd(&stream);
-      return error;
-    }
+  Compressor compressor(level);
 
-    // Consume output and reset the buffer.
-    result.append(
-        reinterpret_cast<char*>(buffer),
-        GZIP_BUFFER_SIZE - stream.avail_out);
-    stream.next_out = buffer;
-    stream.avail_out = GZIP_BUFFER_SIZE;
-  } while (code != Z_STREAM_END);
+  Try<Nothing> compressed = compressor.compress(decompressed, sink);
+  if (compressed.isError()) {
+    return Error(compressed.error());
+  }
 
-  code = deflateEnd(&stream);
-  if (code != Z_OK) {
-    return Error("Failed to clean up zlib: " + std::string(stream.msg));
+  compressed = compressor.finish(sink);
+  if (compressed.isError()) {
+    return Error(compressed.error());
   }
+
   return result;
 #endif // HAVE_LIBZ
 }
@@ -98,52 +511,95 @@ inline Try<std::string> decompress(const std::string& compressed)
 #ifndef HAVE_LIBZ
   return Error("libz is not available");
 #else
-  z_stream_s stream;
-  stream.next_in =
-    const_cast<Bytef*>(reinterpret_cast<const Bytef*>(compressed.data()));
-  stream.avail_in = compressed.length();
-  stream.zalloc = Z_NULL;
-  stream.zfree = Z_NULL;
-  stream.opaque = Z_NULL;
-
-  int code = inflateInit2(
-      &stream,
-      MAX_WBITS + 16); // Zlib magic for gzip compression / decompression.
-
-  if (code != Z_OK) {
-    return Error("Failed to initialize zlib: " + std::string(stream.msg));
-  }
-
-  // Build up the decompressed result.
-  Bytef buffer[GZIP_BUFFER_SIZE];
-  std::string result = "";
-  do {
-    stream.next_out = buffer;
-    stream.avail_out = GZIP_BUFFER_SIZE;
-    code = inflate(&stream, stream.avail_in > 0 ? Z_NO_FLUSH : Z_FINISH);
-
-    if (code != Z_OK && code != Z_STREAM_END) {
-      Error error(std::string(stream.msg));
-      inflateEnd(&stream);
-      return error;
-    }
+  std::string result;
+  const Sink sink = lambda::bind(&internal::append, &result, lambda::_1,
+                                 lambda::_2);
+
+  Decompressor decompressor;
 
-    // Consume output and reset the buffer.
-    result.append(
-        reinterpret_cast<char*>(buffer),
-        GZIP_BUFFER_SIZE - stream.avail_out);
-    stream.next_out = buffer;
-    stream.avail_out = GZIP_BUFFER_SIZE;
-  } while (code != Z_STREAM_END);
+  Try<Nothing> decompressed = decompressor.decompress(compressed, sink);
+  if (decompressed.isError()) {
+    return Error(decompressed.error());
+  }
 
-  code = inflateEnd(&stream);
-  if (code != Z_OK) {
-    return Error("Failed to clean up zlib: " + std::string(stream.msg));
+  decompressed = decompressor.finish(sink);
+  if (decompressed.isError()) {
+    return Error(decompressed.error());
   }
+
   return result;
 #endif // HAVE_LIBZ
 }
 
+
+// Compresses everything read from one file descriptor (until the end
+// of the file) to another, in constant memory. Neither gets closed.
+inline Try<Nothing> compress(
+    int in,
+    int out,
+#ifdef HAVE_LIBZ
+    int level = Z_DEFAULT_COMPRESSION)
+#else
+    int level = -1)
+#endif
+{
+#ifndef HAVE_LIBZ
+  return Error("libz is not available");
+#else
+  const Sink sink = lambda::bind(&internal::write, out, lambda::_1,
+                                 lambda::_2);
+
+  Compressor compressor(level);
+
+  char buffer[GZIP_BUFFER_SIZE];
+  while (true) {
+    Try<size_t> length = internal::read(in, buffer, sizeof(buffer));
+    if (length.isError()) {
+      return Error(length.error());
+    } else if (length.get() == 0) {
+      return compressor.finish(sink);
+    }
+
+    Try<Nothing> compressed = compressor.compress(buffer, length.get(), sink);
+    if (compressed.isError()) {
+      return compressed;
+    }
+  }
+#endif // HAVE_LIBZ
+}
+
+
+// Decompresses everything read from one file descriptor (until the
+// end of the file) to another, in constant memory. Neither gets
+// closed.
+inline Try<Nothing> decompress(int in, int out)
+{
+#ifndef HAVE_LIBZ
+  return Error("libz is not available");
+#else
+  const Sink sink = lambda::bind(&internal::write, out, lambda::_1,
+                                 lambda::_2);
+
+  Decompressor decompressor;
+
+  char buffer[GZIP_BUFFER_SIZE];
+  while (true) {
+    Try<size_t> length = internal::read(in, buffer, sizeof(buffer));
+    if (length.isError()) {
+      return Error(length.error());
+    } else if (length.get() == 0) {
+      return decompressor.finish(sink);
+    }
+
+    Try<Nothing> decompressed =
+      decompressor.decompress(buffer, length.get(), sink);
+    if (decompressed.isError()) {
+      return decompressed;
+    }
+  }
+#endif // HAVE_LIBZ
+}
+
 } // namespace gzip {
 
 #endif // __STOUT_GZIP_HPP__
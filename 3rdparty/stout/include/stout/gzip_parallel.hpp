@@ -0,0 +1,652 @@
+#ifndef __STOUT_GZIP_PARALLEL_HPP__
+#define __STOUT_GZIP_PARALLEL_HPP__
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "error.hpp"
+#include "gzip.hpp"
+#include "lambda.hpp"
+#include "none.hpp"
+#include "nothing.hpp"
+#include "option.hpp"
+#include "os.hpp"
+#include "stringify.hpp"
+#include "try.hpp"
+
+// Parallel compression (and decompression) for large files, e.g.,
+// ZooKeeper snapshots and logs. The input is split into blocks which
+// get compressed independently on multiple threads, each into its
+// own gzip "member". Concatenated members are a valid gzip file (see
+// RFC 1952), which gunzip (and gzip::decompress) decompress into the
+// concatenation of the blocks.
+//
+// Each member also records its own (compressed) size in an "extra"
+// field of its header, which other tools ignore, so that members can
+// be found without decompressing them, and hence be decompressed in
+// parallel too. Anything else (e.g., a file compressed by gzip) gets
+// decompressed sequentially.
+//
+// Note that a block isn't "primed" with the end of the previous block
+// as a dictionary (like pigz does) since members would then depend on
+// each other. Blocks are large enough for that not to matter much.
+namespace gzip {
+namespace parallel {
+
+// Default size of the (uncompressed) blocks.
+const size_t BLOCK_SIZE = 1024 * 1024;
+
+namespace internal {
+
+// Returns the number of threads to use by default, i.e., one per cpu.
+inline size_t threads()
+{
+  Try<long> cpus = os::cpus();
+  return cpus.isSome() && cpus.get() > 0 ? cpus.get() : 1;
+}
+
+
+// Runs 'f' for each of [0, n) on (up to) the given number of threads,
+// including the calling one.
+class Pool
+{
+public:
+  static void run(
+      size_t n,
+      size_t threads,
+      const lambda::function<void(size_t)>& f)
+  {
+    Pool pool(n, f);
+
+    std::vector<pthread_t> workers;
+    for (size_t i = 1; i < std::min(n, threads); i++) {
+      pthread_t worker;
+      if (pthread_create(&worker, NULL, &Pool::start, &pool) != 0) {
+        break; // Make do with fewer threads.
+      }
+      workers.push_back(worker);
+    }
+
+    pool.work();
+
+    for (size_t i = 0; i < workers.size(); i++) {
+      pthread_join(workers[i], NULL);
+    }
+  }
+
+private:
+  Pool(size_t _n, const lambda::function<void(size_t)>& _f)
+    : n(_n), next(0), f(_f)
+  {
+    pthread_mutex_init(&mutex, NULL);
+  }
+
+  ~Pool()
+  {
+    pthread_mutex_destroy(&mutex);
+  }
+
+  static void* start(void* pool)
+  {
+    static_cast<Pool*>(pool)->work();
+    return NULL;
+  }
+
+  void work()
+  {
+    while (true) {
+      pthread_mutex_lock(&mutex);
+      const size_t i = next++;
+      pthread_mutex_unlock(&mutex);
+
+      if (i >= n) {
+        return;
+      }
+
+      f(i);
+    }
+  }
+
+  const size_t n;
+  size_t next;
+  const lambda::function<void(size_t)>& f;
+
+  pthread_mutex_t mutex;
+};
+
+
+#ifdef HAVE_LIBZ
+// Layout of a member's header: the fixed header (with the FEXTRA
+// flag set) followed by the length of the extra field and a single
+// "SZ" subfield holding the size of the member (little endian).
+const size_t HEADER_SIZE = 10 + 2 + 4 + 4;
+const size_t TRAILER_SIZE = 8;
+
+
+inline void little(uint32_t value, char* data)
+{
+  for (size_t i = 0; i < 4; i++) {
+    data[i] = (value >> (8 * i)) & 0xFF;
+  }
+}
+
+
+inline uint32_t little(const char* data, size_t bytes)
+{
+  uint32_t value = 0;
+  for (size_t i = 0; i < bytes; i++) {
+    value |= static_cast<uint32_t>(static_cast<unsigned char>(data[i]))
+      << (8 * i);
+  }
+  return value;
+}
+
+
+// Compresses the block into a gzip member.
+inline Try<std::string> member(const char* data, size_t size, int level)
+{
+  z_stream_s stream;
+  stream.zalloc = Z_NULL;
+  stream.zfree = Z_NULL;
+  stream.opaque = Z_NULL;
+
+  int code = deflateInit2(
+      &stream,
+      level,
+      Z_DEFLATED,
+      -MAX_WBITS, // Raw deflate, we write the header and trailer.
+      8,
+      Z_DEFAULT_STRATEGY);
+
+  if (code != Z_OK) {
+    return Error("Failed to initialize zlib: " +
+                 gzip::internal::message(stream, code));
+  }
+
+  std::string result(
+      HEADER_SIZE + deflateBound(&stream, size) + TRAILER_SIZE, '\0');
+
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream.avail_in = size;
+  stream.next_out = reinterpret_cast<Bytef*>(&result[HEADER_SIZE]);
+  stream.avail_out = result.size() - HEADER_SIZE - TRAILER_SIZE;
+
+  // The output buffer is large enough to finish in one go.
+  code = deflate(&stream, Z_FINISH);
+  if (code != Z_STREAM_END) {
+    Error error(gzip::internal::message(stream, code));
+    deflateEnd(&stream);
+    return error;
+  }
+
+  const size_t length = HEADER_SIZE + stream.total_out + TRAILER_SIZE;
+  deflateEnd(&stream);
+
+  result.resize(length);
+
+  const char header[] = {
+    '\x1f', '\x8b', // Magic.
+    8, // Deflate.
+    4, // FEXTRA.
+    0, 0, 0, 0, // No modification time.
+    0, // Extra flags.
+    3, // Unix.
+    8, 0, // Length of the extra field.
+    'S', 'Z', 4, 0, // Subfield and its length.
+  };
+
+  memcpy(&result[0], header, sizeof(header));
+  little(length, &result[sizeof(header)]);
+
+  const uLong crc = crc32(
+      crc32(0L, Z_NULL, 0),
+      reinterpret_cast<const Bytef*>(data),
+      size);
+
+  little(crc, &result[length - TRAILER_SIZE]);
+  little(size, &result[length - 4]); // Size modulo 2^32.
+
+  return result;
+}
+
+
+// Returns the size of the member starting at 'data' if its header
+// records it (see 'member' above).
+inline Option<size_t> size(const char* data, size_t size)
+{
+  if (size < 12 ||
+      data[0] != '\x1f' || data[1] != '\x8b' || data[2] != 8 ||
+      (data[3] & 4) == 0) {
+    return None();
+  }
+
+  // Look through the subfields of the extra field.
+  const size_t end = std::min<size_t>(size, 12 + little(data + 10, 2));
+  for (size_t i = 12; i + 4 <= end; ) {
+    const size_t length = little(data + i + 2, 2);
+    if (data[i] == 'S' && data[i + 1] == 'Z' && length == 4 &&
+        i + 8 <= end) {
+      const size_t member = little(data + i + 4, 4);
+      if (member < HEADER_SIZE + TRAILER_SIZE) {
+        return None();
+      }
+      return member;
+    }
+    i += 4 + length;
+  }
+
+  return None();
+}
+
+
+// The inputs and outputs of the blocks (or members) of a batch.
+struct Batch
+{
+  // Returns the first error, if any.
+  Option<std::string> error() const
+  {
+    for (size_t i = 0; i < errors.size(); i++) {
+      if (errors[i].isSome()) {
+        return errors[i];
+      }
+    }
+    return None();
+  }
+
+  std::vector<std::pair<const char*, size_t> > inputs;
+  std::vector<std::string> outputs;
+  std::vector<Option<std::string> > errors;
+};
+
+
+inline void compressBlock(Batch* batch, int level, size_t i)
+{
+  Try<std::string> compressed =
+    member(batch->inputs[i].first, batch->inputs[i].second, level);
+
+  if (compressed.isError()) {
+    batch->errors[i] = compressed.error();
+  } else {
+    batch->outputs[i] = compressed.get();
+  }
+}
+
+
+inline void decompressMember(Batch* batch, size_t i)
+{
+  const Sink sink = lambda::bind(
+      &gzip::internal::append, &batch->outputs[i], lambda::_1, lambda::_2);
+
+  // Reserve room for all of the output (or its size modulo 2^32),
+  // within what deflate could possibly have compressed into 'size'.
+  const char* data = batch->inputs[i].first;
+  const size_t size = batch->inputs[i].second;
+  batch->outputs[i].reserve(
+      std::min<size_t>(little(data + size - 4, 4), size * 1032));
+
+  Decompressor decompressor;
+
+  Try<Nothing> decompressed = decompressor.decompress(data, size, sink);
+  if (decompressed.isSome()) {
+    decompressed = decompressor.finish(sink);
+  }
+
+  if (decompressed.isError()) {
+    batch->errors[i] = decompressed.error();
+  }
+}
+
+
+// Splits the data into (at least one) blocks of the given size.
+inline void blocks(const char* data, size_t size, size_t block, Batch* batch)
+{
+  const size_t n = std::max<size_t>(1, (size + block - 1) / block);
+
+  for (size_t i = 0; i < n; i++) {
+    const size_t offset = i * block;
+    batch->inputs.push_back(
+        std::make_pair(data + offset, std::min(block, size - offset)));
+  }
+}
+
+
+// Splits off (up to 'max' of) the members at the start of the data
+// which record their size, returns how many bytes they take.
+inline size_t members(const char* data, size_t size, size_t max, Batch* batch)
+{
+  size_t offset = 0;
+  while (batch->inputs.size() < max) {
+    Option<size_t> member = internal::size(data + offset, size - offset);
+
+    if (member.isNone() || member.get() > size - offset) {
+      break;
+    }
+
+    batch->inputs.push_back(std::make_pair(data + offset, member.get()));
+    offset += member.get();
+  }
+  return offset;
+}
+
+
+// Compresses (or decompresses) the inputs of the batch on the given
+// number of threads, then writes the outputs to the sink in order.
+inline Try<Nothing> run(
+    Batch* batch,
+    const lambda::function<void(size_t)>& f,
+    size_t threads,
+    const Sink& sink)
+{
+  batch->outputs.resize(batch->inputs.size());
+  batch->errors.resize(batch->inputs.size());
+
+  Pool::run(batch->inputs.size(), threads, f);
+
+  Option<std::string> error = batch->error();
+  if (error.isSome()) {
+    return Error(error.get());
+  }
+
+  for (size_t i = 0; i < batch->outputs.size(); i++) {
+    Try<Nothing> written =
+      sink(batch->outputs[i].data(), batch->outputs[i].size());
+    if (written.isError()) {
+      return written;
+    }
+  }
+
+  return Nothing();
+}
+
+
+inline Try<Nothing> compress(
+    Batch* batch,
+    int level,
+    size_t threads,
+    const Sink& sink)
+{
+  return run(
+      batch,
+      lambda::bind(&compressBlock, batch, level, lambda::_1),
+      threads,
+      sink);
+}
+
+
+inline Try<Nothing> decompress(Batch* batch, size_t threads, const Sink& sink)
+{
+  return run(
+      batch,
+      lambda::bind(&decompressMember, batch, lambda::_1),
+      threads,
+      sink);
+}
+
+
+inline Option<Error> validate(int level, size_t block)
+{
+  if (!(level == Z_DEFAULT_COMPRESSION ||
+      (level >= Z_NO_COMPRESSION && level <= Z_BEST_COMPRESSION))) {
+    return Error("Invalid compression level: " + stringify(level));
+  } else if (block == 0 || block > gzip::internal::MAX_CHUNK) {
+    return Error("Invalid block size: " + stringify(block));
+  }
+  return None();
+}
+#endif // HAVE_LIBZ
+
+} // namespace internal {
+
+
+// Returns a gzip compressed version of the provided string, compressed
+// in blocks of the given size on the given number of threads (by
+// default one per cpu). See gzip::compress for the level.
+inline Try<std::string> compress(
+    const std::string& decompressed,
+#ifdef HAVE_LIBZ
+    int level = Z_DEFAULT_COMPRESSION,
+#else
+    int level = -1,
+#endif
+    size_t threads = internal::threads(),
+    size_t block = BLOCK_SIZE)
+{
+#ifndef HAVE_LIBZ
+  return Error("libz is not available");
+#else
+  Option<Error> error = internal::validate(level, block);
+  if (error.isSome()) {
+    return error.get();
+  }
+
+  internal::Batch batch;
+  internal::blocks(decompressed.data(), decompressed.size(), block, &batch);
+
+  std::string result;
+
+  const Sink sink =
+    lambda::bind(&gzip::internal::append, &result, lambda::_1, lambda::_2);
+
+  Try<Nothing> compressed = internal::compress(&batch, level, threads, sink);
+  if (compressed.isError()) {
+    return Error(compressed.error());
+  }
+
+  return result;
+#endif // HAVE_LIBZ
+}
+
+
+// Returns a gzip decompressed version of the provided string. The
+// members written by gzip::parallel::compress get decompressed on the
+// given number of threads (by default one per cpu), anything else
+// sequentially.
+inline Try<std::string> decompress(
+    const std::string& compressed,
+    size_t threads = internal::threads())
+{
+#ifndef HAVE_LIBZ
+  return Error("libz is not available");
+#else
+  internal::Batch batch;
+  const size_t offset = internal::members(
+      compressed.data(),
+      compressed.size(),
+      compressed.size(),
+      &batch);
+
+  std::string result;
+
+  const Sink sink =
+    lambda::bind(&gzip::internal::append, &result, lambda::_1, lambda::_2);
+
+  Try<Nothing> decompressed = internal::decompress(&batch, threads, sink);
+  if (decompressed.isError()) {
+    return Error(decompressed.error());
+  }
+
+  if (offset < compressed.size() || offset == 0) {
+    Try<std::string> rest = gzip::decompress(compressed.substr(offset));
+    if (rest.isError()) {
+      return Error(rest.error());
+    }
+    result += rest.get();
+  }
+
+  return result;
+#endif // HAVE_LIBZ
+}
+
+
+// Compresses everything read from one file descriptor (until the end
+// of the file) to another like 'compress' above, reading a block per
+// thread at a time. Neither file descriptor gets closed.
+inline Try<Nothing> compress(
+    int in,
+    int out,
+#ifdef HAVE_LIBZ
+    int level = Z_DEFAULT_COMPRESSION,
+#else
+    int level = -1,
+#endif
+    size_t threads = internal::threads(),
+    size_t block = BLOCK_SIZE)
+{
+#ifndef HAVE_LIBZ
+  return Error("libz is not available");
+#else
+  Option<Error> error = internal::validate(level, block);
+  if (error.isSome()) {
+    return error.get();
+  }
+
+  threads = std::max<size_t>(1, threads);
+
+  const Sink sink =
+    lambda::bind(&gzip::internal::write, out, lambda::_1, lambda::_2);
+
+  std::string buffer(threads * block, '\0');
+
+  for (bool first = true; ; first = false) {
+    // Fill the buffer (or read to the end of the file).
+    size_t size = 0;
+    while (size < buffer.size()) {
+      Try<size_t> length =
+        gzip::internal::read(in, &buffer[size], buffer.size() - size);
+      if (length.isError()) {
+        return Error(length.error());
+      } else if (length.get() == 0) {
+        break;
+      }
+      size += length.get();
+    }
+
+    // Note that an empty file still gets (an empty) member.
+    if (size == 0 && !first) {
+      return Nothing();
+    }
+
+    internal::Batch batch;
+    internal::blocks(buffer.data(), size, block, &batch);
+
+    Try<Nothing> compressed =
+      internal::compress(&batch, level, threads, sink);
+
+    if (compressed.isError() || size < buffer.size()) {
+      return compressed;
+    }
+  }
+#endif // HAVE_LIBZ
+}
+
+
+// Decompresses everything read from one file descriptor (until the
+// end of the file) to another like 'decompress' above, reading a
+// member per thread at a time. Neither file descriptor gets closed.
+inline Try<Nothing> decompress(
+    int in,
+    int out,
+    size_t threads = internal::threads())
+{
+#ifndef HAVE_LIBZ
+  return Error("libz is not available");
+#else
+  threads = std::max<size_t>(1, threads);
+
+  const Sink sink =
+    lambda::bind(&gzip::internal::write, out, lambda::_1, lambda::_2);
+
+  std::string buffer; // Read but not yet decompressed.
+  bool eof = false;
+
+  while (true) {
+    // Read until the buffer holds a member per thread (or the end of
+    // the file, or something which isn't one of our members).
+    internal::Batch batch;
+    size_t offset = 0;
+    while (true) {
+      batch.inputs.clear();
+      offset = internal::members(buffer.data(), buffer.size(), threads, &batch);
+
+      if (eof || batch.inputs.size() == threads) {
+        break;
+      }
+
+      const size_t available = buffer.size() - offset;
+      if (available >= internal::HEADER_SIZE &&
+          internal::size(buffer.data() + offset, available).isNone()) {
+        break;
+      }
+
+      const size_t size = buffer.size();
+      buffer.resize(size + BLOCK_SIZE);
+
+      Try<size_t> length =
+        gzip::internal::read(in, &buffer[size], BLOCK_SIZE);
+      if (length.isError()) {
+        return Error(length.error());
+      }
+
+      buffer.resize(size + length.get());
+      eof = length.get() == 0;
+    }
+
+    if (batch.inputs.empty()) {
+      break;
+    }
+
+    Try<Nothing> decompressed = internal::decompress(&batch, threads, sink);
+    if (decompressed.isError()) {
+      return decompressed;
+    }
+
+    buffer.erase(0, offset);
+
+    if (eof && buffer.empty()) {
+      return Nothing();
+    }
+  }
+
+  // Decompress whatever isn't one of our members sequentially.
+  Decompressor decompressor;
+
+  Try<Nothing> decompressed = decompressor.decompress(buffer, sink);
+  if (decompressed.isError()) {
+    return decompressed;
+  }
+
+  buffer.resize(GZIP_BUFFER_SIZE);
+
+  while (!eof) {
+    Try<size_t> length = gzip::internal::read(in, &buffer[0], buffer.size());
+    if (length.isError()) {
+      return Error(length.error());
+    } else if (length.get() == 0) {
+      break;
+    }
+
+    decompressed = decompressor.decompress(&buffer[0], length.get(), sink);
+    if (decompressed.isError()) {
+      return decompressed;
+    }
+  }
+
+  return decompressor.finish(sink);
+#endif // HAVE_LIBZ
+}
+
+} // namespace parallel {
+} // namespace gzip {
+
+#endif // __STOUT_GZIP_PARALLEL_HPP__
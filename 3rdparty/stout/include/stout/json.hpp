@@ -1,17 +1,32 @@
 #ifndef __STOUT_JSON__
 #define __STOUT_JSON__
 
-#include <iomanip>
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
 #include <iostream>
 #include <list>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <boost/variant.hpp>
 
+#include <stout/arena.hpp>
+#include <stout/error.hpp>
 #include <stout/foreach.hpp>
-
-// TODO(jsirois): Implement parsing that constructs JSON objects.
+#include <stout/nothing.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
 
 
 namespace JSON {
@@ -85,118 +100,1239 @@ struct False {};
 struct Null {};
 
 
-// Implementation of rendering JSON objects built above using standard
-// C++ output streams. The visitor pattern is used thanks to to build
-// a "renderer" with boost::static_visitor and two top-level render
-// routines are provided for rendering JSON objects and arrays.
+namespace internal {
+
+// Returns the length of the UTF-8 encoded character at the start of
+// 'data', or 0 if it's not a valid encoding (see RFC 3629), i.e., an
+// overlong encoding, a surrogate, beyond U+10FFFF or truncated.
+inline size_t utf8(const char* data, size_t size)
+{
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+
+  size_t length;
+  unsigned char low = 0x80; // Bounds of the second byte.
+  unsigned char high = 0xBF;
+
+  if (bytes[0] >= 0xC2 && bytes[0] <= 0xDF) {
+    length = 2;
+  } else if (bytes[0] >= 0xE0 && bytes[0] <= 0xEF) {
+    length = 3;
+    if (bytes[0] == 0xE0) {
+      low = 0xA0; // Overlong.
+    } else if (bytes[0] == 0xED) {
+      high = 0x9F; // Surrogates.
+    }
+  } else if (bytes[0] >= 0xF0 && bytes[0] <= 0xF4) {
+    length = 4;
+    if (bytes[0] == 0xF0) {
+      low = 0x90; // Overlong.
+    } else if (bytes[0] == 0xF4) {
+      high = 0x8F; // Beyond U+10FFFF.
+    }
+  } else {
+    return 0;
+  }
+
+  if (length > size || bytes[1] < low || bytes[1] > high) {
+    return 0;
+  }
+
+  for (size_t i = 2; i < length; i++) {
+    if (bytes[i] < 0x80 || bytes[i] > 0xBF) {
+      return 0;
+    }
+  }
+
+  return length;
+}
+
+
+// Returns whether a character can't be copied into a JSON string as
+// is (or, for bytes above 0x7F, needs to be checked).
+inline bool special(unsigned char c)
+{
+  return c < 0x20 || c == '"' || c == '\\' || c == '/' || c >= 0x7F;
+}
+
+
+// Returns the offset of the first special character (see above) in
+// 'data' or 'size' if there is none, looking at 16 bytes at a time
+// (using SSE2 if available).
+inline size_t skip(const char* data, size_t size)
+{
+  size_t i = 0;
+
+#ifdef __SSE2__
+  // Comparing signed bytes, so those above 0x7F are less than 0x20.
+  const __m128i space = _mm_set1_epi8(0x20);
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i slash = _mm_set1_epi8('/');
+  const __m128i del = _mm_set1_epi8(0x7F);
+
+  for (; i + 16 <= size; i += 16) {
+    const __m128i v =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+
+    const __m128i matches = _mm_or_si128(
+        _mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, quote)),
+        _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, backslash),
+                         _mm_cmpeq_epi8(v, slash)),
+            _mm_cmpeq_epi8(v, del)));
+
+    const int mask = _mm_movemask_epi8(matches);
+    if (mask != 0) {
+      return i + __builtin_ctz(mask);
+    }
+  }
+#endif // __SSE2__
+
+  while (i < size && !special(data[i])) {
+    i++;
+  }
+
+  return i;
+}
+
+
+// Appends the characters as a (quoted and escaped) JSON string (see
+// RFC 8259). Valid UTF-8 is copied as is, while control characters,
+// DEL and bytes that aren't part of valid UTF-8 get escaped as \u00XX
+// (i.e., as if they were Latin-1). Characters that need no escaping
+// are appended a run at a time.
+inline void escape(std::string* out, const char* data, size_t size)
+{
+  static const char hex[] = "0123456789ABCDEF";
+
+  out->push_back('"');
+
+  size_t i = 0;
+  while (true) {
+    const size_t run = skip(data + i, size - i);
+    out->append(data + i, run);
+    i += run;
+
+    if (i == size) {
+      break;
+    }
+
+    const unsigned char c = data[i];
+
+    if (c > 0x7F) {
+      const size_t length = utf8(data + i, size - i);
+      if (length > 0) {
+        out->append(data + i, length);
+        i += length;
+        continue;
+      }
+    }
+
+    switch (c) {
+      case '"':  out->append("\\\"", 2); break;
+      case '\\': out->append("\\\\", 2); break;
+      case '/':  out->append("\\/", 2);  break;
+      case '\b': out->append("\\b", 2);  break;
+      case '\f': out->append("\\f", 2);  break;
+      case '\n': out->append("\\n", 2);  break;
+      case '\r': out->append("\\r", 2);  break;
+      case '\t': out->append("\\t", 2);  break;
+      default:
+        out->append("\\u00", 4);
+        out->push_back(hex[c >> 4]);
+        out->push_back(hex[c & 0xF]);
+        break;
+    }
+
+    i++;
+  }
+
+  out->push_back('"');
+}
+
+
+// Writes the decimal digits of the integer so that they end at 'end',
+// returns where they start.
+inline char* digits(char* end, uint64_t integer)
+{
+  do {
+    *--end = '0' + integer % 10;
+    integer /= 10;
+  } while (integer > 0);
+  return end;
+}
+
+
+// Appends the number in the shortest form that parses back to the
+// same double. Most numbers are integers or have a few decimals
+// (e.g., 0.25), which get written directly: if the number times 10^k
+// is an integer N (of up to 15 digits) such that N / 10^k is the same
+// number then that's exactly what parsing "N with k decimals" gives
+// (both are correctly rounded). Anything else gets printed with the
+// fewest significant digits (15 to 17) that round-trip. JSON can't
+// represent NaN or infinity, those are rendered as null.
+inline void format(std::string* out, double number)
+{
+  static const double powers[] = { 1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6 };
+
+  // Only NaN and infinity have a difference that is not zero.
+  if (number - number != 0) {
+    out->append("null", 4);
+    return;
+  }
+
+  char buffer[32];
+  char* const end = buffer + sizeof(buffer);
+
+  const double magnitude = fabs(number);
+
+  for (size_t k = 0; k < sizeof(powers) / sizeof(powers[0]); k++) {
+    const double scaled = magnitude * powers[k];
+    if (scaled >= 1e15) {
+      break;
+    }
+
+    if (scaled != floor(scaled) || scaled / powers[k] != magnitude) {
+      continue;
+    }
+
+    // Write the decimals (zero padded) and the integral part.
+    char* start = digits(end, static_cast<uint64_t>(scaled));
+    if (k > 0) {
+      while (static_cast<size_t>(end - start) <= k) {
+        *--start = '0';
+      }
+      char* point = end - k;
+      memmove(start - 1, start, point - start);
+      *--point = '.';
+      start--;
+    }
+
+    // Including negative zero.
+    if (number < 0 || (number == 0 && 1 / number < 0)) {
+      *--start = '-';
+    }
+
+    out->append(start, end - start);
+    return;
+  }
+
+  int length = 0;
+  for (int precision = 15; precision <= 17; precision++) {
+    length = snprintf(buffer, sizeof(buffer), "%.*g", precision, number);
+    if (strtod(buffer, NULL) == number) {
+      break;
+    }
+  }
+
+  out->append(buffer, length);
+}
+
+} // namespace internal {
+
+
+// Implementation of rendering JSON objects built above. The visitor
+// pattern is used thanks to to build a "renderer" with
+// boost::static_visitor which appends to a string (rather than
+// writing to an output stream a few characters at a time), and
+// top-level render routines are provided for appending to a string
+// and for writing to a standard C++ output stream.
 
 struct Renderer : boost::static_visitor<>
 {
-  Renderer(std::ostream& _out) : out(_out) {}
+  Renderer(std::string* _out) : out(_out) {}
 
   void operator () (const String& string) const
   {
-    // TODO(benh): This escaping DOES NOT handle unicode, it encodes as ASCII.
-    // See RFC4627 for the JSON string specificiation.
-    out << "\"";
-    foreach (unsigned char c, string.value) {
-      switch (c) {
-        case '"':  out << "\\\""; break;
-        case '\\': out << "\\\\"; break;
-        case '/':  out << "\\/";  break;
-        case '\b': out << "\\b";  break;
-        case '\f': out << "\\f";  break;
-        case '\n': out << "\\n";  break;
-        case '\r': out << "\\r";  break;
-        case '\t': out << "\\t";  break;
-        default:
-          // See RFC4627 for these ranges.
-          if ((c >= 0x20 && c <= 0x21) ||
-              (c >= 0x23 && c <= 0x5B) ||
-              (c >= 0x5D && c < 0x7F)) {
-            out << c;
-          } else {
-            // NOTE: We also escape all bytes > 0x7F since they imply more than
-            // 1 byte in UTF-8. This is why we don't escape UTF-8 properly.
-            // See RFC4627 for the escaping format: \uXXXX (X is a hex digit).
-            // Each byte here will be of the form: \u00XX (this is why we need
-            // setw and the cast to unsigned int).
-            out << "\\u" << std::setfill('0') << std::setw(4)
-                << std::hex << std::uppercase << (unsigned int) c;
-          }
-          break;
-      }
-    }
-    out << "\"";
+    internal::escape(out, string.value.data(), string.value.size());
   }
 
   void operator () (const Number& number) const
   {
-    out.precision(10);
-    out << number.value;
+    internal::format(out, number.value);
   }
 
   void operator () (const Object& object) const
   {
-    out << "{";
+    out->push_back('{');
     std::map<std::string, Value>::const_iterator iterator;
     iterator = object.values.begin();
     while (iterator != object.values.end()) {
-      out << "\"" << (*iterator).first << "\":";
-      boost::apply_visitor(Renderer(out), (*iterator).second);
+      const std::string& key = (*iterator).first;
+      internal::escape(out, key.data(), key.size());
+      out->push_back(':');
+      boost::apply_visitor(*this, (*iterator).second);
       if (++iterator != object.values.end()) {
-        out << ",";
+        out->push_back(',');
       }
     }
-    out << "}";
+    out->push_back('}');
   }
 
   void operator () (const Array& array) const
   {
-    out << "[";
+    out->push_back('[');
     std::list<Value>::const_iterator iterator;
     iterator = array.values.begin();
     while (iterator != array.values.end()) {
-      boost::apply_visitor(Renderer(out), *iterator);
+      boost::apply_visitor(*this, *iterator);
       if (++iterator != array.values.end()) {
-        out << ",";
+        out->push_back(',');
       }
     }
-    out << "]";
+    out->push_back(']');
   }
 
   void operator () (const True&) const
   {
-    out << "true";
+    out->append("true", 4);
   }
 
   void operator () (const False&) const
   {
-    out << "false";
+    out->append("false", 5);
   }
 
   void operator () (const Null&) const
   {
-    out << "null";
+    out->append("null", 4);
   }
 
 private:
-  std::ostream& out;
+  std::string* out;
 };
 
 
-inline void render(std::ostream& out, const Value& value)
+// Appends the rendered value to 'out'.
+inline void render(std::string* out, const Value& value)
 {
   boost::apply_visitor(Renderer(out), value);
 }
 
 
+inline void render(std::ostream& out, const Value& value)
+{
+  std::string buffer;
+  render(&buffer, value);
+  out.write(buffer.data(), buffer.size());
+}
+
+
 inline std::ostream& operator<<(std::ostream& out, const JSON::Value& value)
 {
   JSON::render(out, value);
   return out;
 }
 
+// An alternative to the types above for building (and reading) large
+// documents cheaply: all of the nodes (and strings) of a Document
+// live in an arena (see stout/arena.hpp) and get freed at once, and
+// objects and arrays are contiguous (i.e., an object is a flat array
+// of key/value members, looked up linearly). For example:
+//
+//   JSON::Document document;
+//   JSON::Node& object = document.root().object();
+//   object.add("timestamp", document).number(1.3e9);
+//   JSON::Node& array = object.add("values", document).array();
+//   array.append(document).string("value", document);
+//
+// Nodes are passed the document for anything that allocates. Note
+// that (like for std::vector) references to the members or elements
+// of an object or array are invalidated by adding to it, and that
+// keys are not checked for duplicates.
+
+class Document;
+struct Member;
+
+
+class Node
+{
+public:
+  enum Type {
+    STRING,
+    NUMBER,
+    OBJECT,
+    ARRAY,
+    BOOLEAN,
+    NIL, // I.e., 'null'.
+  };
+
+  Node() : kind(NIL), length(0) { u.members = NULL; }
+
+  Type type() const { return static_cast<Type>(kind); }
+
+  // Setters, which replace the node with a value of that type.
+
+  Node& string(const std::string& s, Document& document);
+
+  Node& string(const char* data, size_t size, Document& document);
+
+  Node& number(double value)
+  {
+    kind = NUMBER;
+    length = 0;
+    u.number = value;
+    return *this;
+  }
+
+  Node& boolean(bool value)
+  {
+    kind = BOOLEAN;
+    length = 0;
+    u.boolean = value;
+    return *this;
+  }
+
+  Node& null()
+  {
+    kind = NIL;
+    length = 0;
+    return *this;
+  }
+
+  // Makes the node an empty object or array.
+  Node& object()
+  {
+    kind = OBJECT;
+    length = 0;
+    u.members = NULL;
+    return *this;
+  }
+
+  Node& array()
+  {
+    kind = ARRAY;
+    length = 0;
+    u.elements = NULL;
+    return *this;
+  }
+
+  // Adds a member to an object, returns its (null) value.
+  Node& add(const std::string& key, Document& document);
+
+  // Appends a (null) element to an array.
+  Node& append(Document& document);
+
+  // Getters, which are only valid for nodes of the right type.
+
+  std::string string() const
+  {
+    assert(kind == STRING);
+    return std::string(u.string, length);
+  }
+
+  const char* data() const { assert(kind == STRING); return u.string; }
+
+  double number() const { assert(kind == NUMBER); return u.number; }
+
+  bool boolean() const { assert(kind == BOOLEAN); return u.boolean; }
+
+  // Number of characters of a string, members of an object, or
+  // elements of an array.
+  size_t size() const { return length; }
+
+  const Member& member(size_t i) const;
+
+  // Returns the value of the (first) member with the key, if any.
+  const Node* find(const std::string& key) const;
+
+  const Node& operator [] (size_t i) const
+  {
+    assert(kind == ARRAY && i < length);
+    return u.elements[i];
+  }
+
+private:
+  // Returns whether an object or array needs more room before adding
+  // to it. Capacities are the powers of two starting at 4, so they
+  // can be derived from the length rather than stored.
+  static bool full(uint32_t length)
+  {
+    return length == 0 || (length >= 4 && (length & (length - 1)) == 0);
+  }
+
+  static uint32_t capacity(uint32_t length)
+  {
+    return length == 0 ? 4 : length * 2;
+  }
+
+  uint32_t kind; // The Type (fewer bytes than an enum).
+  uint32_t length;
+
+  union {
+    double number;
+    bool boolean;
+    const char* string;
+    Node* elements;
+    Member* members;
+  } u;
+};
+
+
+struct Member
+{
+  const char* key;
+  uint32_t length; // Of the key.
+  Node value;
+};
+
+
+class Document
+{
+public:
+  Document() {}
+
+  Node& root() { return node; }
+  const Node& root() const { return node; }
+
+  // Frees all nodes (keeping some memory around to build the next
+  // document).
+  void clear()
+  {
+    arena.clear();
+    node = Node();
+  }
+
+private:
+  friend class Node;
+
+  // Not copyable, not assignable.
+  Document(const Document&);
+  Document& operator = (const Document&);
+
+  Arena arena;
+  Node node;
+};
+
+
+inline Node& Node::string(const std::string& s, Document& document)
+{
+  return string(s.data(), s.size(), document);
+}
+
+
+inline Node& Node::string(const char* data, size_t size, Document& document)
+{
+  kind = STRING;
+  length = size;
+  u.string = document.arena.copy(data, size);
+  return *this;
+}
+
+
+inline Node& Node::add(const std::string& key, Document& document)
+{
+  assert(kind == OBJECT);
+
+  if (full(length)) {
+    u.members = static_cast<Member*>(document.arena.reallocate(
+        u.members,
+        length * sizeof(Member),
+        capacity(length) * sizeof(Member)));
+  }
+
+  Member& member = u.members[length++];
+  member.key = document.arena.copy(key.data(), key.size());
+  member.length = key.size();
+  member.value = Node();
+  return member.value;
+}
+
+
+inline Node& Node::append(Document& document)
+{
+  assert(kind == ARRAY);
+
+  if (full(length)) {
+    u.elements = static_cast<Node*>(document.arena.reallocate(
+        u.elements,
+        length * sizeof(Node),
+        capacity(length) * sizeof(Node)));
+  }
+
+  Node& element = u.elements[length++];
+  element = Node();
+  return element;
+}
+
+
+inline const Member& Node::member(size_t i) const
+{
+  assert(kind == OBJECT && i < length);
+  return u.members[i];
+}
+
+
+inline const Node* Node::find(const std::string& key) const
+{
+  assert(kind == OBJECT);
+
+  for (uint32_t i = 0; i < length; i++) {
+    const Member& member = u.members[i];
+    if (member.length == key.size() &&
+        memcmp(member.key, key.data(), key.size()) == 0) {
+      return &member.value;
+    }
+  }
+
+  return NULL;
+}
+
+
+// Appends the rendered node to 'out'.
+inline void render(std::string* out, const Node& node)
+{
+  switch (node.type()) {
+    case Node::STRING:
+      internal::escape(out, node.data(), node.size());
+      break;
+    case Node::NUMBER:
+      internal::format(out, node.number());
+      break;
+    case Node::OBJECT:
+      out->push_back('{');
+      for (size_t i = 0; i < node.size(); i++) {
+        const Member& member = node.member(i);
+        if (i > 0) {
+          out->push_back(',');
+        }
+        internal::escape(out, member.key, member.length);
+        out->push_back(':');
+        render(out, member.value);
+      }
+      out->push_back('}');
+      break;
+    case Node::ARRAY:
+      out->push_back('[');
+      for (size_t i = 0; i < node.size(); i++) {
+        if (i > 0) {
+          out->push_back(',');
+        }
+        render(out, node[i]);
+      }
+      out->push_back(']');
+      break;
+    case Node::BOOLEAN:
+      if (node.boolean()) {
+        out->append("true", 4);
+      } else {
+        out->append("false", 5);
+      }
+      break;
+    case Node::NIL:
+      out->append("null", 4);
+      break;
+  }
+}
+
+
+inline void render(std::ostream& out, const Node& node)
+{
+  std::string buffer;
+  render(&buffer, node);
+  out.write(buffer.data(), buffer.size());
+}
+
+
+inline std::ostream& operator<<(std::ostream& out, const JSON::Node& node)
+{
+  JSON::render(out, node);
+  return out;
+}
+
+
+inline std::ostream& operator<<(std::ostream& out, const JSON::Document& d)
+{
+  JSON::render(out, d.root());
+  return out;
+}
+
+// Implementation of parsing (see RFC 8259) in two stages, similar to
+// simdjson (see "Parsing Gigabytes of JSON per Second"): the first
+// finds the offsets of all structural characters and quotes in
+// blocks of 16 bytes at a time (using SSE2 if available), and the
+// second builds the values by walking those offsets, i.e., it skips
+// over strings without looking at every byte.
+
+namespace internal {
+
+// Bit masks of the quotes, backslashes and structural characters
+// ('{', '}', '[', ']', ':' and ',') in a block of 16 bytes.
+inline void classify(
+    const char* block,
+    uint32_t* quotes,
+    uint32_t* backslashes,
+    uint32_t* structurals)
+{
+#ifdef __SSE2__
+  const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+
+  // Setting 0x20 maps '[' to '{' and ']' to '}' (and nothing else to
+  // either of them).
+  const __m128i lowered = _mm_or_si128(v, _mm_set1_epi8(0x20));
+
+  *quotes = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+  *backslashes = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+  *structurals = _mm_movemask_epi8(
+      _mm_or_si128(
+          _mm_or_si128(
+              _mm_cmpeq_epi8(lowered, _mm_set1_epi8('{')),
+              _mm_cmpeq_epi8(lowered, _mm_set1_epi8('}'))),
+          _mm_or_si128(
+              _mm_cmpeq_epi8(v, _mm_set1_epi8(':')),
+              _mm_cmpeq_epi8(v, _mm_set1_epi8(',')))));
+#else
+  *quotes = 0;
+  *backslashes = 0;
+  *structurals = 0;
+  for (int i = 0; i < 16; i++) {
+    switch (block[i]) {
+      case '"': *quotes |= 1 << i; break;
+      case '\\': *backslashes |= 1 << i; break;
+      case '{': case '}': case '[': case ']': case ':': case ',':
+        *structurals |= 1 << i;
+        break;
+    }
+  }
+#endif // __SSE2__
+}
+
+
+// Returns the offsets of the structural characters outside of
+// strings and of the quotes delimiting strings, followed by the size
+// (as a sentinel).
+inline Try<std::vector<uint32_t> > scan(const char* data, size_t size)
+{
+  std::vector<uint32_t> indices;
+  indices.reserve(size / 4 + 1);
+
+  bool escaped = false; // Whether the next block starts escaped.
+  bool quoted = false; // Whether the next block starts in a string.
+
+  for (size_t offset = 0; offset < size; offset += 16) {
+    const char* block = data + offset;
+
+    // Pad the last block with spaces.
+    char padded[16];
+    if (size - offset < 16) {
+      memset(padded, ' ', sizeof(padded));
+      memcpy(padded, block, size - offset);
+      block = padded;
+    }
+
+    uint32_t quotes, backslashes, structurals;
+    classify(block, &quotes, &backslashes, &structurals);
+
+    // Determine the escaped characters, i.e., those following an odd
+    // number of backslashes (which is rare, so just loop).
+    uint32_t escapes = 0;
+    if (escaped) {
+      escapes = 1;
+      backslashes &= ~1u;
+    }
+    while (backslashes != 0) {
+      const int i = __builtin_ctz(backslashes);
+      escapes |= 2u << i;
+      backslashes &= ~(3u << i);
+    }
+    escaped = (escapes & 0x10000) != 0;
+
+    quotes &= ~escapes;
+
+    // The characters inside strings (including the opening but not
+    // the closing quotes) by XOR-ing all preceding quotes.
+    uint32_t inside = quotes;
+    inside ^= inside << 1;
+    inside ^= inside << 2;
+    inside ^= inside << 4;
+    inside ^= inside << 8;
+    inside &= 0xffff;
+    if (quoted) {
+      inside ^= 0xffff;
+    }
+    quoted = (inside & 0x8000) != 0;
+
+    uint32_t bits = (structurals & ~inside) | quotes;
+    while (bits != 0) {
+      indices.push_back(offset + __builtin_ctz(bits));
+      bits &= bits - 1;
+    }
+  }
+
+  if (quoted) {
+    return Error("Unterminated string");
+  }
+
+  indices.push_back(size);
+
+  return indices;
+}
+
+
+// Parses the 4 hex digits of a '\u' escape at 'i' (which gets moved
+// past them).
+inline bool hex(const char* data, size_t* i, size_t end, uint32_t* code)
+{
+  if (*i + 4 > end) {
+    return false;
+  }
+
+  *code = 0;
+  for (size_t j = 0; j < 4; j++) {
+    const char c = data[(*i)++];
+    *code <<= 4;
+    if (c >= '0' && c <= '9') {
+      *code |= c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      *code |= c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      *code |= c - 'A' + 10;
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+// Unescapes the escape sequence at 'i' (which gets moved past it).
+inline Try<Nothing> unescape(
+    const char* data,
+    size_t* i,
+    size_t end,
+    std::string* s)
+{
+  if (*i + 1 >= end) {
+    return Error("Invalid escape sequence");
+  }
+
+  const char c = data[*i + 1];
+  *i += 2;
+
+  switch (c) {
+    case '"': s->push_back('"'); return Nothing();
+    case '\\': s->push_back('\\'); return Nothing();
+    case '/': s->push_back('/'); return Nothing();
+    case 'b': s->push_back('\b'); return Nothing();
+    case 'f': s->push_back('\f'); return Nothing();
+    case 'n': s->push_back('\n'); return Nothing();
+    case 'r': s->push_back('\r'); return Nothing();
+    case 't': s->push_back('\t'); return Nothing();
+    case 'u': break;
+    default: return Error("Invalid escape sequence");
+  }
+
+  uint32_t code;
+  if (!hex(data, i, end, &code)) {
+    return Error("Invalid escape sequence");
+  }
+
+  // Characters outside the Basic Multilingual Plane are escaped as
+  // a UTF-16 surrogate pair.
+  if (code >= 0xD800 && code <= 0xDBFF) {
+    uint32_t low;
+    if (*i + 1 >= end || data[*i] != '\\' || data[*i + 1] != 'u') {
+      return Error("Unpaired surrogate in string");
+    }
+    *i += 2;
+    if (!hex(data, i, end, &low)) {
+      return Error("Invalid escape sequence");
+    } else if (low < 0xDC00 || low > 0xDFFF) {
+      return Error("Unpaired surrogate in string");
+    }
+    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+  } else if (code >= 0xDC00 && code <= 0xDFFF) {
+    return Error("Unpaired surrogate in string");
+  }
+
+  // Encode as UTF-8.
+  if (code < 0x80) {
+    s->push_back(code);
+  } else if (code < 0x800) {
+    s->push_back(0xC0 | (code >> 6));
+    s->push_back(0x80 | (code & 0x3F));
+  } else if (code < 0x10000) {
+    s->push_back(0xE0 | (code >> 12));
+    s->push_back(0x80 | ((code >> 6) & 0x3F));
+    s->push_back(0x80 | (code & 0x3F));
+  } else {
+    s->push_back(0xF0 | (code >> 18));
+    s->push_back(0x80 | ((code >> 12) & 0x3F));
+    s->push_back(0x80 | ((code >> 6) & 0x3F));
+    s->push_back(0x80 | (code & 0x3F));
+  }
+
+  return Nothing();
+}
+
+
+// Decodes the characters of a string (i.e., what's between the
+// quotes) into 's': unescapes escape sequences, validates UTF-8 and
+// rejects control characters.
+inline Try<Nothing> unquote(const char* data, size_t size, std::string* s)
+{
+  // Most strings have nothing to unescape or validate.
+  size_t i = 0;
+  while (i < size && data[i] >= 0x20 && data[i] != '\\' &&
+         static_cast<unsigned char>(data[i]) < 0x80) {
+    i++;
+  }
+
+  s->assign(data, i);
+
+  while (i < size) {
+    const unsigned char c = data[i];
+    if (c < 0x20) {
+      return Error("Unescaped control character in string");
+    } else if (c == '\\') {
+      Try<Nothing> unescaped = unescape(data, &i, size, s);
+      if (unescaped.isError()) {
+        return unescaped;
+      }
+    } else if (c >= 0x80) {
+      const size_t length = utf8(data + i, size - i);
+      if (length == 0) {
+        return Error("Invalid UTF-8 in string");
+      }
+      s->append(data + i, length);
+      i += length;
+    } else {
+      s->push_back(c);
+      i++;
+    }
+  }
+
+  return Nothing();
+}
+
+
+// Returns whether the characters are a number:
+//   -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+inline bool numeric(const char* s, size_t length)
+{
+  size_t i = 0;
+
+  if (i < length && s[i] == '-') {
+    i++;
+  }
+
+  if (i < length && s[i] == '0') {
+    i++;
+  } else if (i < length && s[i] >= '1' && s[i] <= '9') {
+    while (i < length && s[i] >= '0' && s[i] <= '9') {
+      i++;
+    }
+  } else {
+    return false;
+  }
+
+  if (i < length && s[i] == '.') {
+    i++;
+    if (i == length || s[i] < '0' || s[i] > '9') {
+      return false;
+    }
+    while (i < length && s[i] >= '0' && s[i] <= '9') {
+      i++;
+    }
+  }
+
+  if (i < length && (s[i] == 'e' || s[i] == 'E')) {
+    i++;
+    if (i < length && (s[i] == '+' || s[i] == '-')) {
+      i++;
+    }
+    if (i == length || s[i] < '0' || s[i] > '9') {
+      return false;
+    }
+    while (i < length && s[i] >= '0' && s[i] <= '9') {
+      i++;
+    }
+  }
+
+  return i == length;
+}
+
+
+// Converts the characters of a number (see 'numeric' above), which
+// must be followed by a character that is not part of it.
+inline Try<double> number(const char* s, size_t length)
+{
+  // Note that this relies on the "C" locale (for the '.').
+  char* e;
+  errno = 0;
+  const double d = strtod(s, &e);
+  if (e != s + length) {
+    return Error("Invalid number");
+  } else if (errno == ERANGE && (d == HUGE_VAL || d == -HUGE_VAL)) {
+    return Error("Number out of range");
+  }
+  return d;
+}
+
+
+class Parser
+{
+public:
+  Parser(const char* _data,
+         size_t _size,
+         const std::vector<uint32_t>& _indices)
+    : data(_data),
+      size(_size),
+      indices(_indices),
+      position(0),
+      next(0),
+      depth(0) {}
+
+  Try<Value> parse()
+  {
+    Value value;
+    if (!parse(&value)) {
+      return Error(error);
+    }
+
+    whitespace();
+    if (position != size) {
+      return Error(unexpected());
+    }
+
+    return value;
+  }
+
+private:
+  // Maximum nesting of objects and arrays (bounds the recursion).
+  static const size_t MAX_DEPTH = 1024;
+
+  bool parse(Value* value)
+  {
+    whitespace();
+
+    if (position == size) {
+      return fail("Unexpected end of input");
+    }
+
+    if (position != indices[next]) {
+      return scalar(value);
+    }
+
+    switch (data[position]) {
+      case '{': {
+        *value = Object();
+        return object(&boost::get<Object>(*value));
+      }
+      case '[': {
+        *value = Array();
+        return array(&boost::get<Array>(*value));
+      }
+      case '"': {
+        *value = String();
+        return string(&boost::get<String>(*value).value);
+      }
+      default:
+        return fail(unexpected());
+    }
+  }
+
+  bool object(Object* object)
+  {
+    if (++depth > MAX_DEPTH) {
+      return fail("Exceeded maximum depth");
+    }
+
+    structural(); // The '{'.
+
+    if (!whitespace('}')) {
+      while (true) {
+        if (!whitespace('"')) {
+          return fail(unexpected());
+        }
+
+        std::string key;
+        if (!string(&key)) {
+          return false;
+        }
+
+        if (!whitespace(':')) {
+          return fail(unexpected());
+        }
+        structural();
+
+        if (!parse(&object->values[key])) {
+          return false;
+        }
+
+        if (whitespace(',')) {
+          structural();
+        } else if (whitespace('}')) {
+          break;
+        } else {
+          return fail(unexpected());
+        }
+      }
+    }
+
+    structural(); // The '}'.
+    depth--;
+    return true;
+  }
+
+  bool array(Array* array)
+  {
+    if (++depth > MAX_DEPTH) {
+      return fail("Exceeded maximum depth");
+    }
+
+    structural(); // The '['.
+
+    if (!whitespace(']')) {
+      while (true) {
+        array->values.push_back(Null());
+        if (!parse(&array->values.back())) {
+          return false;
+        }
+
+        if (whitespace(',')) {
+          structural();
+        } else if (whitespace(']')) {
+          break;
+        } else {
+          return fail(unexpected());
+        }
+      }
+    }
+
+    structural(); // The ']'.
+    depth--;
+    return true;
+  }
+
+  bool string(std::string* s)
+  {
+    // The closing quote is the next index (see 'scan').
+    const size_t start = position + 1;
+    const size_t end = indices[next + 1];
+
+    next += 2;
+    position = end + 1;
+
+    Try<Nothing> unquoted = unquote(data + start, end - start, s);
+    if (unquoted.isError()) {
+      return fail(unquoted.error());
+    }
+
+    return true;
+  }
+
+  // Parses a number, 'true', 'false' or 'null', i.e., everything up
+  // to the next structural character (or quote) less whitespace.
+  bool scalar(Value* value)
+  {
+    const size_t start = position;
+
+    size_t end = indices[next];
+    while (end > start && space(data[end - 1])) {
+      end--;
+    }
+
+    const char* s = data + start;
+    const size_t length = end - start;
+
+    position = end;
+
+    if (length == 4 && strncmp(s, "true", 4) == 0) {
+      *value = True();
+    } else if (length == 5 && strncmp(s, "false", 5) == 0) {
+      *value = False();
+    } else if (length == 4 && strncmp(s, "null", 4) == 0) {
+      *value = Null();
+    } else if (numeric(s, length)) {
+      Try<double> d = number(s, length);
+      if (d.isError()) {
+        return fail(d.error());
+      }
+      *value = Number(d.get());
+    } else {
+      position = start;
+      return fail(unexpected());
+    }
+
+    return true;
+  }
+
+  static bool space(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+  void whitespace()
+  {
+    while (position < size && space(data[position])) {
+      position++;
+    }
+  }
+
+  // Skips whitespace, returns whether followed by the (structural)
+  // character.
+  bool whitespace(char c)
+  {
+    whitespace();
+    return position < size && position == indices[next] &&
+      data[position] == c;
+  }
+
+  // Moves past the structural character at the current position.
+  void structural()
+  {
+    position++;
+    next++;
+  }
+
+  std::string unexpected() const
+  {
+    if (position == size) {
+      return "Unexpected end of input";
+    }
+    return "Unexpected character '" + std::string(1, data[position]) +
+      "' at offset " + stringify(position);
+  }
+
+  bool fail(const std::string& message)
+  {
+    error = message;
+    return false;
+  }
+
+  const char* data;
+  const size_t size;
+  const std::vector<uint32_t>& indices;
+
+  size_t position; // Offset into the data.
+  size_t next; // Index of the next structural character (or quote).
+  size_t depth;
+
+  std::string error;
+};
+
+} // namespace internal {
+
+
+// Parses a JSON text (any value, not just an object or array).
+inline Try<Value> parse(const std::string& s)
+{
+  // Offsets are 32 bits (and one is needed for the sentinel).
+  if (s.size() >= static_cast<uint32_t>(-1)) {
+    return Error("Input too large");
+  }
+
+  Try<std::vector<uint32_t> > indices = internal::scan(s.data(), s.size());
+  if (indices.isError()) {
+    return Error(indices.error());
+  }
+
+  return internal::Parser(s.data(), s.size(), indices.get()).parse();
+}
+
+
 } // namespace JSON {
 
 #endif // __STOUT_JSON__
@@ -0,0 +1,633 @@
+#ifndef __STOUT_JSON_STREAM_HPP__
+#define __STOUT_JSON_STREAM_HPP__
+
+#include <stddef.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "error.hpp"
+#include "json.hpp"
+#include "nothing.hpp"
+#include "option.hpp"
+#include "os.hpp"
+#include "stringify.hpp"
+#include "try.hpp"
+
+namespace JSON {
+
+// Writes a JSON text one "event" at a time rather than rendering a
+// JSON::Value (which would have to fit in memory in its entirety),
+// e.g.:
+//
+//   JSON::Writer writer(fd);
+//   writer.beginObject();
+//   writer.key("children");
+//   writer.beginArray();
+//   foreach (const std::string& child, children) {
+//     writer.value(child);
+//   }
+//   writer.endArray();
+//   writer.endObject();
+//   Try<Nothing> written = writer.flush();
+//
+// Output is buffered and written to the file descriptor whenever the
+// buffer fills up, so memory stays bounded however large the document
+// gets. Without a file descriptor everything is kept in the buffer
+// (see 'data'). Strings and numbers are rendered like JSON::render
+// does. Writing a value where a key is expected (or vice versa) or
+// ending the wrong object or array is a programming error.
+class Writer
+{
+public:
+  // Writes into the buffer only.
+  Writer() : fd(-1), size(0), comma(false), keyed(false), complete(false) {}
+
+  // Writes to the file descriptor (which is not closed) whenever at
+  // least 'size' bytes are buffered.
+  explicit Writer(int _fd, size_t _size = 64 * 1024)
+    : fd(_fd), size(_size), comma(false), keyed(false), complete(false)
+  {
+    buffer.reserve(size);
+  }
+
+  // Writes out whatever is still buffered (see 'flush' for errors).
+  ~Writer()
+  {
+    flush();
+  }
+
+  void beginObject()
+  {
+    prepare();
+    buffer.push_back('{');
+    stack.push_back('{');
+    comma = false;
+  }
+
+  void endObject()
+  {
+    CHECK(!stack.empty() && stack.back() == '{') << "Not in an object";
+    CHECK(!keyed) << "Expecting a value for the last key";
+    buffer.push_back('}');
+    end();
+  }
+
+  void beginArray()
+  {
+    prepare();
+    buffer.push_back('[');
+    stack.push_back('[');
+    comma = false;
+  }
+
+  void endArray()
+  {
+    CHECK(!stack.empty() && stack.back() == '[') << "Not in an array";
+    buffer.push_back(']');
+    end();
+  }
+
+  void key(const std::string& key)
+  {
+    CHECK(!stack.empty() && stack.back() == '{') << "Not in an object";
+    CHECK(!keyed) << "Expecting a value for the last key";
+    if (comma) {
+      buffer.push_back(',');
+    }
+    internal::escape(&buffer, key.data(), key.size());
+    buffer.push_back(':');
+    comma = true;
+    keyed = true;
+  }
+
+  void value(const std::string& string)
+  {
+    prepare();
+    internal::escape(&buffer, string.data(), string.size());
+    done();
+  }
+
+  void value(const char* string)
+  {
+    value(std::string(string));
+  }
+
+  void value(double number)
+  {
+    prepare();
+    internal::format(&buffer, number);
+    done();
+  }
+
+  // Overloads for integers, which would otherwise be ambiguous
+  // between the double and bool ones.
+  void value(int number)
+  {
+    value(static_cast<double>(number));
+  }
+
+  void value(long number)
+  {
+    value(static_cast<double>(number));
+  }
+
+  void value(unsigned int number)
+  {
+    value(static_cast<double>(number));
+  }
+
+  void value(unsigned long number)
+  {
+    value(static_cast<double>(number));
+  }
+
+  void value(bool boolean)
+  {
+    prepare();
+    if (boolean) {
+      buffer.append("true", 4);
+    } else {
+      buffer.append("false", 5);
+    }
+    done();
+  }
+
+  void null()
+  {
+    prepare();
+    buffer.append("null", 4);
+    done();
+  }
+
+  // Writes a (small) JSON::Value or JSON::Node as is.
+  void value(const Value& value)
+  {
+    prepare();
+    render(&buffer, value);
+    done();
+  }
+
+  void value(const Node& node)
+  {
+    prepare();
+    render(&buffer, node);
+    done();
+  }
+
+  // Writes out whatever is buffered (if writing to a file
+  // descriptor). Returns the first error writing ran into, after
+  // which nothing else gets written.
+  Try<Nothing> flush()
+  {
+    if (error.isSome()) {
+      buffer.clear();
+      return Error(error.get());
+    }
+
+    if (fd >= 0 && !buffer.empty()) {
+      Try<Nothing> written = os::write(fd, buffer);
+      buffer.clear();
+      if (written.isError()) {
+        error = written.error();
+        return written;
+      }
+    }
+
+    return Nothing();
+  }
+
+  // Returns what's buffered, i.e., everything written so far when
+  // not writing to a file descriptor.
+  const std::string& data() const
+  {
+    return buffer;
+  }
+
+  // Returns whether a complete JSON text has been written.
+  bool finished() const
+  {
+    return complete;
+  }
+
+private:
+  // Not copyable, not assignable.
+  Writer(const Writer&);
+  Writer& operator = (const Writer&);
+
+  // Separates a value from the one before it (if any).
+  void prepare()
+  {
+    CHECK(!complete) << "Already wrote a complete JSON text";
+
+    if (stack.empty()) {
+      return;
+    }
+
+    if (stack.back() == '{') {
+      CHECK(keyed) << "Expecting a key";
+      keyed = false;
+    } else {
+      if (comma) {
+        buffer.push_back(',');
+      }
+      comma = true;
+    }
+  }
+
+  // Ends the current object or array.
+  void end()
+  {
+    stack.pop_back();
+    comma = true;
+    done();
+  }
+
+  // Called after every value, flushes a full buffer.
+  void done()
+  {
+    complete = stack.empty();
+
+    if (fd >= 0 && buffer.size() >= size) {
+      flush();
+    }
+  }
+
+  const int fd;
+  const size_t size; // Bytes to buffer before writing.
+
+  std::string buffer;
+
+  std::vector<char> stack; // The '{' or '[' of every enclosing value.
+  bool comma; // Whether the enclosing value already has an element.
+  bool keyed; // Whether a key was written (but not its value yet).
+  bool complete;
+
+  Option<std::string> error; // The first error writing.
+};
+
+
+// Reads a JSON text one "event" at a time from input that gets "fed"
+// to it in chunks (e.g., as they arrive from a file or a socket)
+// rather than parsing it into a JSON::Value, e.g.:
+//
+//   JSON::Reader reader;
+//   char buffer[4096];
+//   while (true) {
+//     Try<JSON::Reader::Event> event = reader.next();
+//     if (event.isError()) {
+//       ...
+//     } else if (event.get() == JSON::Reader::MORE) {
+//       ssize_t length = ::read(fd, buffer, sizeof(buffer));
+//       if (length > 0) {
+//         reader.feed(buffer, length);
+//       } else if (length == 0) {
+//         reader.finish();
+//       } else if (errno != EINTR) {
+//         ...
+//       }
+//     } else if (event.get() == JSON::Reader::END) {
+//       break;
+//     } else if (event.get() == JSON::Reader::KEY) {
+//       ... reader.string() ...
+//     }
+//     ...
+//   }
+//
+// Only the input that hasn't been read yet is kept around, i.e.,
+// memory stays bounded by the largest string (or chunk). Strings and
+// numbers are validated and decoded like JSON::parse does.
+class Reader
+{
+public:
+  enum Event {
+    MORE, // Needs more input (see 'feed' and 'finish').
+    BEGIN_OBJECT,
+    END_OBJECT,
+    BEGIN_ARRAY,
+    END_ARRAY,
+    KEY, // See 'string'.
+    STRING, // See 'string'.
+    NUMBER, // See 'number'.
+    BOOLEAN, // See 'boolean'.
+    NIL,
+    END, // Of the JSON text (and the input).
+  };
+
+  Reader()
+    : position(0),
+      offset(0),
+      resume(0),
+      state(START),
+      finished(false),
+      decimal(0),
+      truth(false) {}
+
+  void feed(const char* data, size_t size)
+  {
+    CHECK(!finished) << "Fed after the end of input";
+
+    // Drop what's been read.
+    if (position > 0) {
+      buffer.erase(0, position);
+      offset += position;
+      if (resume > 0) {
+        resume -= position;
+      }
+      position = 0;
+    }
+
+    buffer.append(data, size);
+  }
+
+  void feed(const std::string& data)
+  {
+    feed(data.data(), data.size());
+  }
+
+  // Marks the end of input.
+  void finish()
+  {
+    finished = true;
+  }
+
+  // Returns the next event, MORE if that needs more input, or an
+  // error if the input is not valid JSON (after which every call
+  // returns the same error).
+  Try<Event> next()
+  {
+    if (error.isSome()) {
+      return Error(error.get());
+    }
+
+    while (position < buffer.size() && space(buffer[position])) {
+      position++;
+    }
+
+    if (position == buffer.size()) {
+      if (!finished) {
+        return MORE;
+      } else if (state == DONE) {
+        return END;
+      }
+      return fail("Unexpected end of input");
+    }
+
+    const char c = buffer[position];
+
+    switch (state) {
+      case START:
+      case VALUE:
+        return value();
+      case FIRST_VALUE:
+        if (c == ']') {
+          return close(']');
+        }
+        return value();
+      case FIRST_MEMBER:
+        if (c == '}') {
+          return close('}');
+        }
+        // Fall through.
+      case MEMBER:
+        if (c != '"') {
+          return fail(unexpected());
+        }
+        return string(KEY);
+      case COLON:
+        if (c != ':') {
+          return fail(unexpected());
+        }
+        position++;
+        state = VALUE;
+        return next();
+      case COMMA:
+        if (c == ',') {
+          position++;
+          state = stack.back() == '{' ? MEMBER : VALUE;
+          return next();
+        } else if (c == '}' || c == ']') {
+          return close(c);
+        }
+        return fail(unexpected());
+      case DONE:
+        return fail(unexpected());
+    }
+
+    return fail(unexpected()); // Unreachable.
+  }
+
+  // The (decoded) characters of the last KEY or STRING.
+  const std::string& string() const
+  {
+    return text;
+  }
+
+  // The value of the last NUMBER.
+  double number() const
+  {
+    return decimal;
+  }
+
+  // The value of the last BOOLEAN.
+  bool boolean() const
+  {
+    return truth;
+  }
+
+  // Returns the number of objects and arrays the reader is in.
+  size_t depth() const
+  {
+    return stack.size();
+  }
+
+private:
+  // What's expected next.
+  enum State {
+    START, // The value of the JSON text.
+    VALUE, // A value (after a ',' in an array or a ':').
+    FIRST_VALUE, // A value or ']' (after a '[').
+    MEMBER, // A key (after a ',' in an object).
+    FIRST_MEMBER, // A key or '}' (after a '{').
+    COLON, // A ':' (after a key).
+    COMMA, // A ',', '}' or ']' (after a value in an object or array).
+    DONE, // Nothing (after the value of the JSON text).
+  };
+
+  // Not copyable, not assignable.
+  Reader(const Reader&);
+  Reader& operator = (const Reader&);
+
+  Try<Event> value()
+  {
+    switch (buffer[position]) {
+      case '{':
+        position++;
+        stack.push_back('{');
+        state = FIRST_MEMBER;
+        return BEGIN_OBJECT;
+      case '[':
+        position++;
+        stack.push_back('[');
+        state = FIRST_VALUE;
+        return BEGIN_ARRAY;
+      case '"':
+        return string(STRING);
+      default:
+        return scalar();
+    }
+  }
+
+  // Ends the current object or array with the character at the
+  // current position.
+  Try<Event> close(char c)
+  {
+    if (stack.back() != (c == '}' ? '{' : '[')) {
+      return fail(unexpected());
+    }
+
+    position++;
+    stack.pop_back();
+    done();
+    return c == '}' ? END_OBJECT : END_ARRAY;
+  }
+
+  // Reads the string starting at the current position (as a KEY or
+  // STRING), or returns MORE if it's not complete yet.
+  Try<Event> string(Event event)
+  {
+    // Find the closing quote, continuing where the last attempt (if
+    // any) stopped. Note that this may skip past the end of the
+    // buffer when it ends with a backslash.
+    size_t i = std::max(position + 1, resume);
+    while (i < buffer.size() && buffer[i] != '"') {
+      i += buffer[i] == '\\' ? 2 : 1;
+    }
+
+    if (i >= buffer.size()) {
+      if (finished) {
+        return fail("Unterminated string");
+      }
+      resume = i;
+      return MORE;
+    }
+
+    resume = 0;
+
+    const size_t start = position + 1;
+    Try<Nothing> unquoted =
+      internal::unquote(buffer.data() + start, i - start, &text);
+    if (unquoted.isError()) {
+      return fail(unquoted.error());
+    }
+
+    position = i + 1;
+
+    if (event == KEY) {
+      state = COLON;
+    } else {
+      done();
+    }
+
+    return event;
+  }
+
+  // Reads a number, 'true', 'false' or 'null' (i.e., everything up to
+  // the next whitespace, structural character or quote), or returns
+  // MORE if the input might continue it.
+  Try<Event> scalar()
+  {
+    size_t end = position;
+    while (end < buffer.size() && !delimiter(buffer[end])) {
+      end++;
+    }
+
+    if (end == buffer.size() && !finished) {
+      return MORE;
+    }
+
+    const char* s = buffer.data() + position;
+    const size_t length = end - position;
+
+    Event event;
+    if (length == 4 && strncmp(s, "true", 4) == 0) {
+      truth = true;
+      event = BOOLEAN;
+    } else if (length == 5 && strncmp(s, "false", 5) == 0) {
+      truth = false;
+      event = BOOLEAN;
+    } else if (length == 4 && strncmp(s, "null", 4) == 0) {
+      event = NIL;
+    } else if (internal::numeric(s, length)) {
+      // The number is followed by a delimiter (or the terminating
+      // NUL of the buffer).
+      Try<double> number = internal::number(s, length);
+      if (number.isError()) {
+        return fail(number.error());
+      }
+      decimal = number.get();
+      event = NUMBER;
+    } else {
+      return fail(unexpected());
+    }
+
+    position = end;
+    done();
+    return event;
+  }
+
+  // Called after every complete value.
+  void done()
+  {
+    state = stack.empty() ? DONE : COMMA;
+  }
+
+  static bool space(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+  static bool delimiter(char c)
+  {
+    return space(c) || c == ',' || c == ':' || c == '"' ||
+      c == '{' || c == '}' || c == '[' || c == ']';
+  }
+
+  std::string unexpected() const
+  {
+    return "Unexpected character '" + std::string(1, buffer[position]) +
+      "' at offset " + stringify(offset + position);
+  }
+
+  Try<Event> fail(const std::string& message)
+  {
+    error = message;
+    return Error(message);
+  }
+
+  std::string buffer; // Input that hasn't been read yet.
+  size_t position; // Offset into the buffer.
+  size_t offset; // Offset of the buffer into the input.
+
+  // Offset into the buffer to continue looking for the end of an
+  // incomplete string from (if not 0).
+  size_t resume;
+
+  std::vector<char> stack; // The '{' or '[' of every enclosing value.
+  State state;
+  bool finished; // Whether the end of input has been fed.
+
+  std::string text;
+  double decimal;
+  bool truth;
+
+  Option<std::string> error; // Once the input turned out invalid.
+};
+
+} // namespace JSON {
+
+#endif // __STOUT_JSON_STREAM_HPP__
@@ -3,58 +3,109 @@
 
 #include <assert.h>
 
+#include <new> // For placement new.
+
+#if __cplusplus >= 201103L
+#include <utility> // For std::move.
+#endif
+
+#include <boost/type_traits/aligned_storage.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+#include <boost/type_traits/is_scalar.hpp>
+
+// Note that the value is stored inline (rather than allocated on the
+// heap), so creating or copying an Option<T> costs no more than
+// creating or copying a T. With C++11 values can also be moved into
+// and between options.
 template <typename T>
 class Option
 {
 public:
   static Option<T> none()
   {
-    return Option<T>(NONE);
+    return Option<T>();
   }
 
   static Option<T> some(const T& t)
   {
-    return Option<T>(SOME, new T(t));
+    return Option<T>(t);
   }
 
-  Option() : state(NONE), t(NULL) {}
+  Option() : state(NONE)
+  {
+    initialize();
+  }
 
-  Option(const T& _t) : state(SOME), t(new T(_t)) {}
+  Option(const T& _t) : state(NONE)
+  {
+    new (storage.address()) T(_t);
+    state = SOME;
+  }
 
-  Option(const Option<T>& that)
+  Option(const Option<T>& that) : state(NONE)
   {
-    state = that.state;
-    if (that.t != NULL) {
-      t = new T(*that.t);
-    } else {
-      t = NULL;
+    initialize();
+    if (that.state == SOME) {
+      new (storage.address()) T(*that.t());
+      state = SOME;
     }
   }
 
+#if __cplusplus >= 201103L
+  Option(T&& _t) : state(NONE)
+  {
+    new (storage.address()) T(std::move(_t));
+    state = SOME;
+  }
+
+  Option(Option<T>&& that) : state(NONE)
+  {
+    initialize();
+    if (that.state == SOME) {
+      new (storage.address()) T(std::move(*that.t()));
+      state = SOME;
+    }
+  }
+#endif
+
   ~Option()
   {
-    delete t;
+    clear();
   }
 
   Option<T>& operator = (const Option<T>& that)
   {
     if (this != &that) {
-      delete t;
-      state = that.state;
-      if (that.t != NULL) {
-        t = new T(*that.t);
-      } else {
-        t = NULL;
+      clear();
+      if (that.state == SOME) {
+        new (storage.address()) T(*that.t());
+        state = SOME;
       }
     }
 
     return *this;
   }
 
+#if __cplusplus >= 201103L
+  Option<T>& operator = (Option<T>&& that)
+  {
+    if (this != &that) {
+      clear();
+      if (that.state == SOME) {
+        new (storage.address()) T(std::move(*that.t()));
+        state = SOME;
+      }
+    }
+
+    return *this;
+  }
+#endif
+
   bool operator == (const Option<T>& that) const
   {
     return (state == NONE && that.state == NONE) ||
-      (state == SOME && that.state == SOME && *t == *that.t);
+      (state == SOME && that.state == SOME && *t() == *that.t());
   }
 
   bool operator != (const Option<T>& that) const
@@ -65,9 +116,9 @@ public:
   bool isSome() const { return state == SOME; }
   bool isNone() const { return state == NONE; }
 
-  T get() const { assert(state == SOME); return *t; }
+  T get() const { assert(state == SOME); return *t(); }
 
-  T get(const T& _t) const { return state == NONE ? _t : *t; }
+  T get(const T& _t) const { return state == NONE ? _t : *t(); }
 
 private:
   enum State {
@@ -75,11 +126,38 @@ private:
     NONE,
   };
 
-  Option(State _state, T* _t = NULL)
-    : state(_state), t(_t) {}
+  T* t() { return static_cast<T*>(storage.address()); }
+  const T* t() const { return static_cast<const T*>(storage.address()); }
+
+  // Value-initializes the storage of a scalar (i.e., a single store)
+  // so that compilers which can't follow 'state' don't warn about the
+  // storage being read uninitialized (e.g., after 'clear').
+  void initialize()
+  {
+    initialize(boost::is_scalar<T>());
+  }
+
+  void initialize(const boost::true_type&)
+  {
+    new (storage.address()) T();
+  }
+
+  void initialize(const boost::false_type&) {}
+
+  // Destroys the value, if any. Note that we set the state first so
+  // that we're left in a valid state if constructing a new value
+  // throws.
+  void clear()
+  {
+    if (state == SOME) {
+      state = NONE;
+      t()->~T();
+      initialize();
+    }
+  }
 
   State state;
-  T* t;
+  boost::aligned_storage<sizeof(T), boost::alignment_of<T>::value> storage;
 };
 
 #endif // __STOUT_OPTION_HPP__
@@ -5,9 +5,17 @@
 #include <stdlib.h> // For abort.
 
 #include <iostream>
+#include <new> // For placement new.
 #include <string>
 
+#if __cplusplus >= 201103L
+#include <utility> // For std::move.
+#endif
 
+#include <boost/type_traits/aligned_storage.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+
+// Note that the value is stored inline, like in Option<T>.
 template <typename T>
 class Result
 {
@@ -19,48 +27,82 @@ public:
 
   static Result<T> some(const T& t)
   {
-    return Result<T>(SOME, new T(t));
+    return Result<T>(t);
   }
 
   static Result<T> error(const std::string& message)
   {
-    return Result<T>(ERROR, NULL, message);
+    return Result<T>(ERROR, message);
   }
 
-  Result(const T& _t) : state(SOME), t(new T(_t)) {}
+  Result(const T& _t) : state(NONE)
+  {
+    new (storage.address()) T(_t);
+    state = SOME;
+  }
 
-  Result(const Result<T>& that)
+  Result(const Result<T>& that) : state(that.state), message(that.message)
   {
-    state = that.state;
-    if (that.t != NULL) {
-      t = new T(*that.t);
-    } else {
-      t = NULL;
+    if (that.state == SOME) {
+      state = NONE;
+      new (storage.address()) T(*that.t());
+      state = SOME;
     }
-    message = that.message;
   }
 
+#if __cplusplus >= 201103L
+  Result(T&& _t) : state(NONE)
+  {
+    new (storage.address()) T(std::move(_t));
+    state = SOME;
+  }
+
+  Result(Result<T>&& that)
+    : state(that.state), message(std::move(that.message))
+  {
+    if (that.state == SOME) {
+      state = NONE;
+      new (storage.address()) T(std::move(*that.t()));
+      state = SOME;
+    }
+  }
+#endif
+
   ~Result()
   {
-    delete t;
+    clear();
   }
 
   Result<T>& operator = (const Result<T>& that)
   {
     if (this != &that) {
-      delete t;
-      state = that.state;
-      if (that.t != NULL) {
-        t = new T(*that.t);
-      } else {
-        t = NULL;
+      clear();
+      if (that.state == SOME) {
+        new (storage.address()) T(*that.t());
       }
+      state = that.state;
       message = that.message;
     }
 
     return *this;
   }
 
+#if __cplusplus >= 201103L
+  Result<T>& operator = (Result<T>&& that)
+  {
+    if (this != &that) {
+      clear();
+      if (that.state == SOME) {
+        new (storage.address()) T(std::move(*that.t()));
+      }
+      state = that.state;
+      message = std::move(that.message);
+    }
+
+    return *this;
+  }
+#endif
+
   bool isSome() const { return state == SOME; }
   bool isNone() const { return state == NONE; }
   bool isError() const { return state == ERROR; }
@@ -76,7 +118,7 @@ public:
       }
       abort();
     }
-    return *t;
+    return *t();
   }
 
   std::string error() const { assert(state == ERROR); return message; }
@@ -88,11 +130,24 @@ private:
     ERROR
   };
 
-  Result(State _state, T* _t = NULL, const std::string& _message = "")
-    : state(_state), t(_t), message(_message) {}
+  Result(State _state, const std::string& _message = "")
+    : state(_state), message(_message) {}
+
+  T* t() { return static_cast<T*>(storage.address()); }
+  const T* t() const { return static_cast<const T*>(storage.address()); }
+
+  // Destroys the value, if any, leaving none in case constructing a
+  // new value throws.
+  void clear()
+  {
+    if (state == SOME) {
+      state = NONE;
+      t()->~T();
+    }
+  }
 
   State state;
-  T* t;
+  boost::aligned_storage<sizeof(T), boost::alignment_of<T>::value> storage;
   std::string message;
 };
 
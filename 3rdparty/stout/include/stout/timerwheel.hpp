@@ -0,0 +1,161 @@
+#ifndef __STOUT_TIMERWHEEL_HPP__
+#define __STOUT_TIMERWHEEL_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <list>
+#include <vector>
+
+// A hierarchical timer wheel (see "Hashed and Hierarchical Timing
+// Wheels", Varghese and Lauck) which keeps track of when things
+// expire in terms of "ticks" of some clock (e.g., milliseconds). It
+// has four levels of 64 slots: a thing expiring within 64 ticks goes
+// into the slot of the first level for that tick, one expiring later
+// goes into a slot of a higher level covering 64 times as many ticks,
+// and gets moved ("cascaded") to a lower level when the time of that
+// slot comes. Scheduling, cancelling and expiring are all O(1), and
+// advancing is amortized O(1) per tick.
+//
+// Things further out than the last level covers (2^24 ticks, i.e.,
+// more than 4 hours in milliseconds) go into the last slot of the
+// last level and get scheduled again from there.
+template <typename T>
+class timerwheel
+{
+private:
+  struct entry
+  {
+    entry(const T& _t, uint64_t _deadline)
+      : t(_t), deadline(_deadline), level(0), slot(0) {}
+
+    T t;
+    uint64_t deadline;
+
+    // Where the entry is.
+    size_t level;
+    size_t slot;
+  };
+
+public:
+  typedef typename std::list<entry>::iterator handle;
+
+  explicit timerwheel(uint64_t _current = 0) : current(_current), count(0) {}
+
+  // Schedules 't' to expire at the given tick. Note that a deadline
+  // that has already passed expires on the next tick.
+  handle schedule(const T& t, uint64_t deadline)
+  {
+    std::list<entry> scheduled;
+    scheduled.push_back(entry(t, deadline));
+
+    handle h = scheduled.begin();
+    place(scheduled, h, current + 1);
+    count++;
+    return h;
+  }
+
+  void cancel(handle h)
+  {
+    slots[h->level][h->slot].erase(h);
+    count--;
+  }
+
+  uint64_t deadline(handle h) const
+  {
+    return h->deadline;
+  }
+
+  // Moves the wheel up to the given tick (if it's not past it
+  // already), appending whatever expires to 'expired'.
+  void advance(uint64_t now, std::vector<T>* expired)
+  {
+    while (current < now) {
+      if (count == 0) {
+        current = now; // Nothing to expire, jump ahead.
+        break;
+      }
+
+      current++;
+
+      // Cascade the slots of the higher levels that come up (i.e.,
+      // when the digits of the lower levels are all zero), starting
+      // at the highest so entries can cascade further down.
+      size_t levels = 1;
+      while (levels < LEVELS && (current & (span(levels) - 1)) == 0) {
+        levels++;
+      }
+
+      for (size_t level = levels - 1; level > 0; level--) {
+        std::list<entry>& slot = slots[level][index(current, level)];
+        while (!slot.empty()) {
+          place(slot, slot.begin(), current);
+        }
+      }
+
+      std::list<entry>& slot = slots[0][index(current, 0)];
+      while (!slot.empty()) {
+        expired->push_back(slot.front().t);
+        slot.pop_front();
+        count--;
+      }
+    }
+  }
+
+  // Number of things scheduled.
+  size_t size() const
+  {
+    return count;
+  }
+
+private:
+  static const size_t BITS = 6;
+  static const size_t SLOTS = 1 << BITS;
+  static const size_t LEVELS = 4;
+
+  // Not copyable, not assignable (handles point into the slots).
+  timerwheel(const timerwheel&);
+  timerwheel& operator = (const timerwheel&);
+
+  // Number of ticks covered by the slots of a level.
+  static uint64_t span(size_t level)
+  {
+    return static_cast<uint64_t>(1) << (BITS * level);
+  }
+
+  static size_t index(uint64_t tick, size_t level)
+  {
+    return (tick >> (BITS * level)) & (SLOTS - 1);
+  }
+
+  // Moves an entry from the list it's in into its slot, expiring no
+  // earlier than the given tick.
+  void place(std::list<entry>& from, handle h, uint64_t earliest)
+  {
+    uint64_t deadline = std::max(h->deadline, earliest);
+
+    size_t level = 0;
+    while (level < LEVELS && deadline - current >= span(level + 1)) {
+      level++;
+    }
+
+    if (level == LEVELS) {
+      level = LEVELS - 1;
+      deadline = current + span(LEVELS) - 1;
+    }
+
+    h->level = level;
+    h->slot = index(deadline, level);
+
+    std::list<entry>& slot = slots[h->level][h->slot];
+    slot.splice(slot.end(), from, h);
+  }
+
+  uint64_t current; // Tick the wheel is at.
+  size_t count;
+
+  std::list<entry> slots[LEVELS][SLOTS];
+};
+
+#endif // __STOUT_TIMERWHEEL_HPP__
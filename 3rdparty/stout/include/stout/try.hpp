@@ -5,50 +5,73 @@
 #include <stdlib.h> // For abort.
 
 #include <iostream>
+#include <new> // For placement new.
 #include <string>
 
+#if __cplusplus >= 201103L
+#include <utility> // For std::move.
+#endif
 
+#include <boost/type_traits/aligned_storage.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+
+// Note that the value is stored inline, like in Option<T>.
 template <typename T>
 class Try
 {
 public:
   static Try<T> some(const T& t)
   {
-    return Try<T>(SOME, new T(t));
+    return Try<T>(t);
   }
 
   static Try<T> error(const std::string& message)
   {
-    return Try<T>(ERROR, NULL, message);
+    return Try<T>(ERROR, message);
+  }
+
+  Try(const T& _t) : state(ERROR)
+  {
+    new (storage.address()) T(_t);
+    state = SOME;
+  }
+
+  Try(const Try<T>& that) : state(ERROR), message(that.message)
+  {
+    if (that.state == SOME) {
+      new (storage.address()) T(*that.t());
+      state = SOME;
+    }
   }
 
-  Try(const T& _t) : state(SOME), t(new T(_t)) {}
+#if __cplusplus >= 201103L
+  Try(T&& _t) : state(ERROR)
+  {
+    new (storage.address()) T(std::move(_t));
+    state = SOME;
+  }
 
-  Try(const Try<T>& that)
+  Try(Try<T>&& that) : state(ERROR), message(std::move(that.message))
   {
-    state = that.state;
-    if (that.t != NULL) {
-      t = new T(*that.t);
-    } else {
-      t = NULL;
+    if (that.state == SOME) {
+      new (storage.address()) T(std::move(*that.t()));
+      state = SOME;
     }
-    message = that.message;
   }
+#endif
 
   ~Try()
   {
-    delete t;
+    clear();
   }
 
   Try<T>& operator = (const Try<T>& that)
   {
     if (this != &that) {
-      delete t;
-      state = that.state;
-      if (that.t != NULL) {
-        t = new T(*that.t);
-      } else {
-        t = NULL;
+      clear();
+      if (that.state == SOME) {
+        new (storage.address()) T(*that.t());
+        state = SOME;
       }
       message = that.message;
     }
@@ -56,6 +79,22 @@ public:
     return *this;
   }
 
+#if __cplusplus >= 201103L
+  Try<T>& operator = (Try<T>&& that)
+  {
+    if (this != &that) {
+      clear();
+      if (that.state == SOME) {
+        new (storage.address()) T(std::move(*that.t()));
+        state = SOME;
+      }
+      message = std::move(that.message);
+    }
+
+    return *this;
+  }
+#endif
+
   bool isSome() const { return state == SOME; }
   bool isError() const { return state == ERROR; }
 
@@ -65,7 +104,7 @@ public:
       std::cerr << "Try::get() but state == ERROR: " << error() << std::endl;
       abort();
     }
-    return *t;
+    return *t();
   }
 
   std::string error() const { assert(state == ERROR); return message; }
@@ -76,11 +115,24 @@ private:
     ERROR
   };
 
-  Try(State _state, T* _t = NULL, const std::string& _message = "")
-    : state(_state), t(_t), message(_message) {}
+  Try(State _state, const std::string& _message)
+    : state(_state), message(_message) {}
+
+  T* t() { return static_cast<T*>(storage.address()); }
+  const T* t() const { return static_cast<const T*>(storage.address()); }
+
+  // Destroys the value, if any, leaving an error (with whatever
+  // message we had) in case constructing a new value throws.
+  void clear()
+  {
+    if (state == SOME) {
+      state = ERROR;
+      t()->~T();
+    }
+  }
 
   State state;
-  T* t;
+  boost::aligned_storage<sizeof(T), boost::alignment_of<T>::value> storage;
   std::string message;
 };
 
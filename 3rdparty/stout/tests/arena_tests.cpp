@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <gmock/gmock.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <stout/arena.hpp>
+
+
+TEST(ArenaTest, Allocate)
+{
+  Arena arena(64);
+
+  char* c = static_cast<char*>(arena.allocate(1, 1));
+  double* d = static_cast<double*>(arena.allocate(sizeof(double)));
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(d) % sizeof(double));
+
+  *c = 'c';
+  *d = 4.2;
+
+  // Larger than a block.
+  char* large = static_cast<char*>(arena.allocate(1000));
+  memset(large, 'x', 1000);
+
+  EXPECT_EQ('c', *c);
+  EXPECT_EQ(4.2, *d);
+
+  char* s = arena.copy("hello", 5);
+  EXPECT_EQ(0, memcmp(s, "hello", 5));
+}
+
+
+TEST(ArenaTest, Reallocate)
+{
+  Arena arena(1024);
+
+  int* ints = static_cast<int*>(arena.allocate(4 * sizeof(int)));
+  for (int i = 0; i < 4; i++) {
+    ints[i] = i;
+  }
+
+  // The last allocation grows in place.
+  int* more = static_cast<int*>(
+      arena.reallocate(ints, 4 * sizeof(int), 8 * sizeof(int)));
+  EXPECT_EQ(ints, more);
+
+  arena.allocate(1);
+
+  // Otherwise it gets copied.
+  int* moved = static_cast<int*>(
+      arena.reallocate(more, 8 * sizeof(int), 16 * sizeof(int)));
+  EXPECT_NE(more, moved);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(i, moved[i]);
+  }
+}
+
+
+TEST(ArenaTest, Clear)
+{
+  Arena arena(64);
+
+  for (int i = 0; i < 100; i++) {
+    arena.allocate(32);
+  }
+
+  arena.clear();
+
+  char* p = static_cast<char*>(arena.allocate(16));
+  memset(p, 0, 16);
+}
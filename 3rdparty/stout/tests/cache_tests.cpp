@@ -0,0 +1,270 @@
+#include <gtest/gtest.h>
+
+#include <gmock/gmock.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stout/cache.hpp>
+#include <stout/eviction.hpp>
+#include <stout/gtest.hpp>
+#include <stout/lambda.hpp>
+#include <stout/numify.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
+
+using std::string;
+using std::vector;
+
+
+TEST(CacheTest, LRU)
+{
+  cache<int, string> c(2);
+
+  c.put(1, "one");
+  c.put(2, "two");
+
+  EXPECT_EQ("one", c.get(1).get()); // Now 2 is least recently used.
+
+  c.put(3, "three");
+
+  EXPECT_EQ(2u, c.size());
+  EXPECT_TRUE(c.get(2).isNone());
+  EXPECT_EQ("one", c.get(1).get());
+  EXPECT_EQ("three", c.get(3).get());
+
+  c.put(1, "uno"); // Updating counts as a use too.
+  c.put(4, "four");
+
+  EXPECT_TRUE(c.get(3).isNone());
+  EXPECT_EQ("uno", c.get(1).get());
+  EXPECT_EQ("four", c.get(4).get());
+}
+
+
+TEST(CacheTest, Clock)
+{
+  cache<int, int, eviction::clock<int> > c(3);
+
+  c.put(1, 1);
+  c.put(2, 2);
+  c.put(3, 3);
+
+  c.get(1); // Gives 1 a second chance.
+  c.put(4, 4); // Evicts 2.
+
+  EXPECT_TRUE(c.get(2).isNone());
+  EXPECT_EQ(1, c.get(1).get());
+  EXPECT_EQ(3, c.get(3).get());
+  EXPECT_EQ(4, c.get(4).get());
+}
+
+
+// A clock for tests to move forward as they please.
+static uint64_t current(const uint64_t* now)
+{
+  return *now;
+}
+
+
+TEST(CacheTest, Expire)
+{
+  uint64_t now = 1000;
+  const cache<int, int>::clock clock = lambda::bind(&current, &now);
+
+  cache<int, int> c(10, clock);
+
+  c.put(1, 1, Milliseconds(10));
+  c.put(2, 2, Milliseconds(10));
+  c.put(3, 3, Seconds(60));
+  c.put(4, 4);
+
+  c.put(2, 2); // Putting again without a time-to-live never expires.
+
+  now += 9;
+
+  EXPECT_SOME_EQ(1, c.get(1));
+  EXPECT_EQ(4u, c.size());
+
+  now += 1;
+
+  EXPECT_TRUE(c.get(1).isNone());
+  EXPECT_SOME_EQ(2, c.get(2));
+  EXPECT_SOME_EQ(3, c.get(3));
+  EXPECT_SOME_EQ(4, c.get(4));
+  EXPECT_EQ(3u, c.size());
+
+  now += 60 * 1000;
+
+  EXPECT_TRUE(c.get(3).isNone());
+  EXPECT_SOME_EQ(4, c.get(4));
+  EXPECT_EQ(2u, c.size());
+
+  // Evicting an entry cancels its expiry.
+  cache<int, int> d(1, clock);
+  d.put(1, 1, Milliseconds(10));
+  d.put(2, 2);
+  d.put(1, 1, Seconds(60));
+
+  now += 20;
+
+  EXPECT_SOME_EQ(1, d.get(1));
+
+  // The monotonic clock is used by default.
+  cache<int, int> e(1);
+  e.put(1, 1, Seconds(60));
+  EXPECT_SOME_EQ(1, e.get(1));
+}
+
+
+// Fills a cache with many more keys than it can hold.
+template <typename Policy>
+static void fill()
+{
+  cache<int, int, Policy> c(100);
+
+  for (int i = 0; i < 1000; i++) {
+    c.put(i, i);
+    c.get(i % 10); // Some keys are used more often.
+    ASSERT_LE(c.size(), 100u);
+  }
+
+  EXPECT_EQ(100u, c.size());
+
+  for (int i = 0; i < 1000; i++) {
+    Option<int> value = c.get(i);
+    if (value.isSome()) {
+      EXPECT_EQ(i, value.get());
+    }
+  }
+}
+
+
+TEST(CacheTest, Fill)
+{
+  fill<eviction::lru<int> >();
+  fill<eviction::clock<int> >();
+  fill<eviction::s3fifo<int> >();
+  fill<eviction::tinylfu<int> >();
+}
+
+
+// Replays a trace of keys (putting the key on a miss), returns the
+// number of hits.
+template <typename Policy>
+static size_t replay(const vector<string>& trace, size_t capacity)
+{
+  cache<string, bool, Policy> c(capacity);
+
+  size_t hits = 0;
+  for (size_t i = 0; i < trace.size(); i++) {
+    if (c.get(trace[i]).isSome()) {
+      hits++;
+    } else {
+      c.put(trace[i], true);
+    }
+  }
+
+  return hits;
+}
+
+
+TEST(CacheTest, Scan)
+{
+  // A few keys used over and over, but every once in a while all of
+  // them get scanned (e.g., all children of a znode).
+  vector<string> trace;
+  for (int round = 0; round < 20; round++) {
+    for (int i = 0; i < 3; i++) {
+      for (int key = 0; key < 20; key++) {
+        trace.push_back("hot" + stringify(key));
+      }
+    }
+    for (int key = 0; key < 500; key++) {
+      trace.push_back("cold" + stringify(round * 500 + key));
+    }
+  }
+
+  // LRU loses all hot keys in every scan.
+  const size_t lru = replay<eviction::lru<string> >(trace, 100);
+  EXPECT_EQ(20u * 2 * 20, lru);
+
+  // Scan resistant policies keep (almost) all of them.
+  EXPECT_LT(lru, replay<eviction::s3fifo<string> >(trace, 100));
+  EXPECT_LT(lru, replay<eviction::tinylfu<string> >(trace, 100));
+}
+
+
+template <typename Policy>
+static void benchmark(
+    const string& name,
+    const vector<string>& trace,
+    size_t capacity)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  const size_t hits = replay<Policy>(trace, capacity);
+
+  const double secs = stopwatch.elapsed().secs();
+
+  std::cout << name << ": hit ratio "
+            << 100.0 * hits / trace.size() << "%, "
+            << static_cast<long>(trace.size() / secs) << " ops/sec"
+            << std::endl;
+}
+
+
+// Replays the trace in the file named by STOUT_CACHE_TRACE (a key per
+// line) or else a synthetic one (skewed key popularity with periodic
+// scans) against each policy, e.g.:
+//
+//   export STOUT_CACHE_TRACE=trace STOUT_CACHE_CAPACITY=10000
+//   ./stout-tests --gtest_filter=CacheTest.* --gtest_also_run_disabled_tests
+TEST(CacheTest, DISABLED_Benchmark)
+{
+  size_t capacity = 1000;
+
+  const char* value = ::getenv("STOUT_CACHE_CAPACITY");
+  if (value != NULL) {
+    Try<size_t> number = numify<size_t>(value);
+    ASSERT_TRUE(number.isSome()) << number.error();
+    capacity = number.get();
+  }
+
+  vector<string> trace;
+
+  const char* path = ::getenv("STOUT_CACHE_TRACE");
+  if (path != NULL) {
+    std::ifstream file(path);
+    ASSERT_TRUE(file.is_open()) << "Failed to open " << path;
+    string key;
+    while (std::getline(file, key)) {
+      trace.push_back(key);
+    }
+  } else {
+    // Key popularity roughly follows Zipf's law (i.e., the logarithm
+    // of a key is uniformly distributed).
+    unsigned seed = 42;
+    for (int i = 0; i < 1000000; i++) {
+      const double uniform = rand_r(&seed) / (RAND_MAX + 1.0);
+      trace.push_back(stringify(static_cast<long>(exp(uniform * log(1e6)))));
+      if (i % 100000 == 0) {
+        for (int key = 0; key < 10000; key++) {
+          trace.push_back("scan" + stringify(i + key));
+        }
+      }
+    }
+  }
+
+  benchmark<eviction::lru<string> >("lru", trace, capacity);
+  benchmark<eviction::clock<string> >("clock", trace, capacity);
+  benchmark<eviction::s3fifo<string> >("s3fifo", trace, capacity);
+  benchmark<eviction::tinylfu<string> >("tinylfu", trace, capacity);
+}
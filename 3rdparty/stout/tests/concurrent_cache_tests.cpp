@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+
+#include <gmock/gmock.h>
+
+#include <pthread.h>
+
+#include <string>
+
+#include <stout/concurrent_cache.hpp>
+#include <stout/gtest.hpp>
+
+using std::string;
+
+
+TEST(ConcurrentCacheTest, LeastRecentlyUsed)
+{
+  // A single shard so that the order of evictions is deterministic.
+  concurrent_cache<int, string> cache(2, 1);
+
+  cache.put(1, "one");
+  cache.put(2, "two");
+
+  EXPECT_EQ("one", cache.get(1).get()); // Now 2 is least recently used.
+
+  cache.put(3, "three");
+
+  EXPECT_TRUE(cache.get(2).isNone());
+  EXPECT_EQ("one", cache.get(1).get());
+  EXPECT_EQ("three", cache.get(3).get());
+
+  cache.put(1, "uno"); // Updating counts as a use too.
+  cache.put(4, "four");
+
+  EXPECT_TRUE(cache.get(3).isNone());
+  EXPECT_EQ("uno", cache.get(1).get());
+
+  EXPECT_TRUE(cache.erase(1));
+  EXPECT_FALSE(cache.erase(1));
+  EXPECT_TRUE(cache.get(1).isNone());
+
+  concurrent_cache<int, string>::statistics stats = cache.stats();
+  EXPECT_EQ(4, stats.hits);
+  EXPECT_EQ(3, stats.misses);
+  EXPECT_EQ(2, stats.evictions);
+  EXPECT_EQ(1u, stats.size);
+  EXPECT_EQ(1u, stats.weight);
+
+  cache.clear();
+  EXPECT_EQ(0u, cache.stats().size);
+  EXPECT_TRUE(cache.get(4).isNone());
+}
+
+
+static size_t length(const int&, const string& value)
+{
+  return value.size();
+}
+
+
+TEST(ConcurrentCacheTest, Weigh)
+{
+  concurrent_cache<int, string> cache(10, 1, length);
+
+  cache.put(1, "aaaa");
+  cache.put(2, "bbbb");
+  EXPECT_EQ(8u, cache.stats().weight);
+
+  cache.put(3, "cccc"); // Evicts 1.
+  EXPECT_TRUE(cache.get(1).isNone());
+  EXPECT_EQ(8u, cache.stats().weight);
+
+  cache.put(2, "bb"); // Now there is room for 1 again.
+  cache.put(1, "aaaa");
+  EXPECT_EQ(10u, cache.stats().weight);
+  EXPECT_EQ(3u, cache.stats().size);
+
+  // Too heavy to be cached, but leaves the other entries alone.
+  const long evictions = cache.stats().evictions;
+  cache.put(4, "dddddddddddd");
+  EXPECT_TRUE(cache.get(4).isNone());
+  EXPECT_EQ(evictions + 1, cache.stats().evictions);
+  EXPECT_EQ(3u, cache.stats().size);
+  EXPECT_EQ(10u, cache.stats().weight);
+  EXPECT_SOME_EQ("aaaa", cache.get(1));
+  EXPECT_SOME_EQ("bb", cache.get(2));
+  EXPECT_SOME_EQ("cccc", cache.get(3));
+
+  // Replacing an entry with one too heavy removes it.
+  cache.put(1, "dddddddddddd");
+  EXPECT_TRUE(cache.get(1).isNone());
+  EXPECT_EQ(2u, cache.stats().size);
+  EXPECT_EQ(6u, cache.stats().weight);
+  EXPECT_SOME_EQ("bb", cache.get(2));
+  EXPECT_SOME_EQ("cccc", cache.get(3));
+}
+
+
+TEST(ConcurrentCacheTest, Shards)
+{
+  concurrent_cache<int, int> cache(1024, 5); // Rounded up to 8 shards.
+
+  for (int i = 0; i < 512; i++) {
+    cache.put(i, i * i);
+  }
+
+  // Each shard gets 128, the keys spread across the shards well enough
+  // that none of them had to evict (this also exercises rehashing).
+  EXPECT_EQ(512u, cache.stats().size);
+  EXPECT_EQ(0, cache.stats().evictions);
+
+  for (int i = 0; i < 512; i++) {
+    ASSERT_EQ(i * i, cache.get(i).get(-1));
+  }
+
+  for (int i = 0; i < 4096; i++) {
+    cache.put(i, i);
+  }
+
+  const concurrent_cache<int, int>::statistics stats = cache.stats();
+  EXPECT_LE(stats.size, 1024u);
+  EXPECT_EQ(4096 - static_cast<long>(stats.size), stats.evictions);
+}
+
+
+static void* run(void* arg)
+{
+  concurrent_cache<int, int>* cache =
+    static_cast<concurrent_cache<int, int>*>(arg);
+
+  for (int i = 0; i < 10000; i++) {
+    const int key = i % 300;
+    Option<int> value = cache->get(key);
+    if (value.isSome()) {
+      EXPECT_EQ(key, value.get());
+    } else {
+      cache->put(key, key);
+    }
+  }
+
+  return NULL;
+}
+
+
+TEST(ConcurrentCacheTest, Threads)
+{
+  concurrent_cache<int, int> cache(256, 4);
+
+  pthread_t threads[4];
+
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(0, pthread_create(&threads[i], NULL, run, &cache));
+  }
+
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(0, pthread_join(threads[i], NULL));
+  }
+
+  concurrent_cache<int, int>::statistics stats = cache.stats();
+  EXPECT_EQ(40000, stats.hits + stats.misses);
+  EXPECT_LE(stats.size, 256u);
+}
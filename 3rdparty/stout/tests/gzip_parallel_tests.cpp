@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+
+#include <gmock/gmock.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+
+#include <iostream>
+#include <string>
+
+#include <stout/gtest.hpp>
+#include <stout/gzip.hpp>
+#include <stout/gzip_parallel.hpp>
+#include <stout/os.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
+
+using std::string;
+
+
+#ifdef HAVE_LIBZ
+// Returns some (somewhat compressible) data.
+static string data(size_t size)
+{
+  string s;
+  unsigned seed = 42;
+  while (s.size() < size) {
+    s += "line " + stringify(rand_r(&seed) % 1000) + "\n";
+  }
+  s.resize(size);
+  return s;
+}
+
+
+TEST(GzipParallelTest, CompressDecompressString)
+{
+  ASSERT_ERROR(gzip::parallel::compress("", -2));
+  ASSERT_ERROR(gzip::parallel::compress("", Z_BEST_COMPRESSION + 1));
+  ASSERT_ERROR(gzip::parallel::compress("", Z_DEFAULT_COMPRESSION, 4, 0));
+
+  const string s = data(1024 * 1024);
+
+  // Small blocks, more of them than threads, and a partial last one.
+  Try<string> compressed =
+    gzip::parallel::compress(s, Z_DEFAULT_COMPRESSION, 4, 10000);
+  ASSERT_SOME(compressed);
+
+  // The members can be decompressed in parallel, or sequentially by
+  // anything that reads (multi-member) gzip files.
+  EXPECT_SOME_EQ(s, gzip::parallel::decompress(compressed.get(), 4));
+  EXPECT_SOME_EQ(s, gzip::parallel::decompress(compressed.get(), 1));
+  EXPECT_SOME_EQ(s, gzip::decompress(compressed.get()));
+
+  // The default block size (and number of threads).
+  compressed = gzip::parallel::compress(s);
+  ASSERT_SOME(compressed);
+  EXPECT_SOME_EQ(s, gzip::parallel::decompress(compressed.get()));
+  EXPECT_SOME_EQ(s, gzip::decompress(compressed.get()));
+
+  // Empty data still compresses into a (valid) member.
+  compressed = gzip::parallel::compress("");
+  ASSERT_SOME(compressed);
+  EXPECT_SOME_EQ("", gzip::parallel::decompress(compressed.get()));
+  EXPECT_SOME_EQ("", gzip::decompress(compressed.get()));
+}
+
+
+TEST(GzipParallelTest, Members)
+{
+  Try<string> parallel =
+    gzip::parallel::compress("parallel,", Z_DEFAULT_COMPRESSION, 2, 4);
+  Try<string> sequential = gzip::compress("sequential,");
+  ASSERT_SOME(parallel);
+  ASSERT_SOME(sequential);
+
+  // Members which don't record their size (e.g., written by gzip)
+  // get decompressed sequentially.
+  EXPECT_SOME_EQ("sequential,",
+                 gzip::parallel::decompress(sequential.get()));
+  EXPECT_SOME_EQ("parallel,sequential,parallel,",
+                 gzip::parallel::decompress(
+                     parallel.get() + sequential.get() + parallel.get()));
+
+  // But not truncated ones, or trailing garbage.
+  const string truncated = parallel.get().substr(0, parallel.get().size() - 1);
+  EXPECT_ERROR(gzip::parallel::decompress(truncated));
+  EXPECT_ERROR(gzip::parallel::decompress(parallel.get() + "garbage"));
+  EXPECT_ERROR(gzip::parallel::decompress(""));
+  EXPECT_ERROR(gzip::parallel::decompress("not compressed"));
+
+  // Nor corrupted ones.
+  string corrupted = parallel.get();
+  corrupted[corrupted.size() - 5] ^= 1;
+  EXPECT_ERROR(gzip::parallel::decompress(corrupted));
+}
+
+
+TEST(GzipParallelTest, FileDescriptors)
+{
+  const string s = data(3 * 1024 * 1024 + 1);
+
+  Try<string> original = os::mktemp();
+  Try<string> compressed = os::mktemp();
+  Try<string> decompressed = os::mktemp();
+  ASSERT_SOME(original);
+  ASSERT_SOME(compressed);
+  ASSERT_SOME(decompressed);
+
+  ASSERT_SOME(os::write(original.get(), s));
+
+  Try<int> in = os::open(original.get(), O_RDONLY);
+  Try<int> out = os::open(compressed.get(), O_WRONLY | O_TRUNC);
+  ASSERT_SOME(in);
+  ASSERT_SOME(out);
+  EXPECT_SOME(gzip::parallel::compress(
+      in.get(), out.get(), Z_DEFAULT_COMPRESSION, 3, 100000));
+  ASSERT_SOME(os::close(in.get()));
+  ASSERT_SOME(os::close(out.get()));
+
+  in = os::open(compressed.get(), O_RDONLY);
+  out = os::open(decompressed.get(), O_WRONLY | O_TRUNC);
+  ASSERT_SOME(in);
+  ASSERT_SOME(out);
+  EXPECT_SOME(gzip::parallel::decompress(in.get(), out.get(), 3));
+  ASSERT_SOME(os::close(in.get()));
+  ASSERT_SOME(os::close(out.get()));
+
+  Try<string> read = os::read(compressed.get());
+  ASSERT_SOME(read);
+  EXPECT_LT(read.get().size(), s.size());
+  EXPECT_SOME_EQ(s, gzip::decompress(read.get()));
+
+  EXPECT_SOME_EQ(s, os::read(decompressed.get()));
+
+  // Files written by gzip (after one of ours) get decompressed too.
+  Try<string> sequential = gzip::compress(s);
+  ASSERT_SOME(sequential);
+  ASSERT_SOME(os::write(compressed.get(), read.get() + sequential.get()));
+
+  in = os::open(compressed.get(), O_RDONLY);
+  out = os::open(decompressed.get(), O_WRONLY | O_TRUNC);
+  ASSERT_SOME(in);
+  ASSERT_SOME(out);
+  EXPECT_SOME(gzip::parallel::decompress(in.get(), out.get()));
+  ASSERT_SOME(os::close(in.get()));
+  ASSERT_SOME(os::close(out.get()));
+
+  EXPECT_SOME_EQ(s + s, os::read(decompressed.get()));
+
+  ASSERT_SOME(os::rm(original.get()));
+  ASSERT_SOME(os::rm(compressed.get()));
+  ASSERT_SOME(os::rm(decompressed.get()));
+}
+
+
+// Compares compressing (and decompressing) on one thread against one
+// thread per cpu, and the ratio against a single member.
+TEST(GzipParallelTest, DISABLED_Benchmark)
+{
+  const string s = data(64 * 1024 * 1024);
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  Try<string> sequential = gzip::compress(s);
+  ASSERT_SOME(sequential);
+
+  const double single = stopwatch.elapsed().secs();
+
+  stopwatch.start();
+
+  Try<string> compressed =
+    gzip::parallel::compress(s, Z_DEFAULT_COMPRESSION, 1);
+  ASSERT_SOME(compressed);
+
+  const double one = stopwatch.elapsed().secs();
+
+  stopwatch.start();
+
+  compressed = gzip::parallel::compress(s);
+  ASSERT_SOME(compressed);
+
+  const double all = stopwatch.elapsed().secs();
+
+  stopwatch.start();
+
+  EXPECT_SOME_EQ(s, gzip::parallel::decompress(compressed.get()));
+
+  const double decompressed = stopwatch.elapsed().secs();
+
+  std::cout << "Compressed " << s.size() << " bytes into "
+            << compressed.get().size() << " (a single member "
+            << sequential.get().size() << ") in " << all << " secs on "
+            << gzip::parallel::internal::threads() << " threads (" << one
+            << " secs on one, a single member " << single << " secs), "
+            << "decompressed in " << decompressed << " secs" << std::endl;
+}
+#endif // HAVE_LIBZ
@@ -2,10 +2,15 @@
 
 #include <gmock/gmock.h>
 
+#include <fcntl.h>
+#include <stdlib.h>
+
 #include <string>
 
 #include <stout/gtest.hpp>
 #include <stout/gzip.hpp>
+#include <stout/lambda.hpp>
+#include <stout/os.hpp>
 
 using std::string;
 
@@ -50,4 +55,128 @@ TEST(GzipTest, CompressDecompressString)
   ASSERT_SOME(decompressed);
   ASSERT_EQ(s, decompressed.get());
 }
+
+
+// Returns some (somewhat compressible) data.
+static string data(size_t size)
+{
+  string s;
+  unsigned seed = 42;
+  while (s.size() < size) {
+    s += "line " + stringify(rand_r(&seed) % 1000) + "\n";
+  }
+  s.resize(size);
+  return s;
+}
+
+
+TEST(GzipTest, CompressorDecompressor)
+{
+  const string s = data(1024 * 1024);
+
+  // Feed in odd sized chunks and read into a small buffer.
+  string compressed;
+  {
+    gzip::Compressor compressor(Z_BEST_SPEED);
+    char buffer[7];
+    for (size_t offset = 0; !compressor.done(); offset += 1001) {
+      if (offset < s.size()) {
+        compressor.feed(
+            s.data() + offset, std::min<size_t>(1001, s.size() - offset));
+      } else {
+        compressor.finish();
+      }
+
+      while (true) {
+        Try<size_t> length = compressor.read(buffer, sizeof(buffer));
+        ASSERT_SOME(length);
+        if (length.get() == 0) {
+          break;
+        }
+        compressed.append(buffer, length.get());
+      }
+    }
+    EXPECT_TRUE(compressor.done());
+  }
+
+  EXPECT_SOME_EQ(s, gzip::decompress(compressed));
+
+  // Decompress a byte at a time, with a sink.
+  string decompressed;
+  const gzip::Sink sink =
+    lambda::bind(&gzip::internal::append, &decompressed, lambda::_1,
+                 lambda::_2);
+
+  gzip::Decompressor decompressor;
+  for (size_t i = 0; i < compressed.size(); i++) {
+    ASSERT_SOME(decompressor.decompress(&compressed[i], 1, sink));
+  }
+  ASSERT_SOME(decompressor.finish(sink));
+  EXPECT_TRUE(decompressor.done());
+  EXPECT_EQ(s, decompressed);
+}
+
+
+TEST(GzipTest, Members)
+{
+  // Concatenated gzip members decompress into the concatenation.
+  Try<string> first = gzip::compress("first,");
+  Try<string> second = gzip::compress("");
+  Try<string> third = gzip::compress("third");
+  ASSERT_SOME(first);
+  ASSERT_SOME(second);
+  ASSERT_SOME(third);
+
+  EXPECT_SOME_EQ("first,third",
+                 gzip::decompress(first.get() + second.get() + third.get()));
+
+  // But not truncated ones, or trailing garbage.
+  const string truncated = first.get().substr(0, first.get().size() - 1);
+  EXPECT_ERROR(gzip::decompress(truncated));
+  EXPECT_ERROR(gzip::decompress(first.get() + "garbage"));
+  EXPECT_ERROR(gzip::decompress(""));
+  EXPECT_ERROR(gzip::decompress("not compressed"));
+}
+
+
+TEST(GzipTest, FileDescriptors)
+{
+  const string s = data(3 * 1024 * 1024);
+
+  Try<string> original = os::mktemp();
+  Try<string> compressed = os::mktemp();
+  Try<string> decompressed = os::mktemp();
+  ASSERT_SOME(original);
+  ASSERT_SOME(compressed);
+  ASSERT_SOME(decompressed);
+
+  ASSERT_SOME(os::write(original.get(), s));
+
+  Try<int> in = os::open(original.get(), O_RDONLY);
+  Try<int> out = os::open(compressed.get(), O_WRONLY | O_TRUNC);
+  ASSERT_SOME(in);
+  ASSERT_SOME(out);
+  EXPECT_SOME(gzip::compress(in.get(), out.get()));
+  ASSERT_SOME(os::close(in.get()));
+  ASSERT_SOME(os::close(out.get()));
+
+  in = os::open(compressed.get(), O_RDONLY);
+  out = os::open(decompressed.get(), O_WRONLY | O_TRUNC);
+  ASSERT_SOME(in);
+  ASSERT_SOME(out);
+  EXPECT_SOME(gzip::decompress(in.get(), out.get()));
+  ASSERT_SOME(os::close(in.get()));
+  ASSERT_SOME(os::close(out.get()));
+
+  Try<string> read = os::read(compressed.get());
+  ASSERT_SOME(read);
+  EXPECT_LT(read.get().size(), s.size());
+  EXPECT_SOME_EQ(s, gzip::decompress(read.get()));
+
+  EXPECT_SOME_EQ(s, os::read(decompressed.get()));
+
+  ASSERT_SOME(os::rm(original.get()));
+  ASSERT_SOME(os::rm(compressed.get()));
+  ASSERT_SOME(os::rm(decompressed.get()));
+}
 #endif // HAVE_LIBZ
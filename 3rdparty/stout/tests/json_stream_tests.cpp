@@ -0,0 +1,264 @@
+#include <gtest/gtest.h>
+
+#include <gmock/gmock.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <stout/gtest.hpp>
+#include <stout/json.hpp>
+#include <stout/json_stream.hpp>
+#include <stout/os.hpp>
+#include <stout/result.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+
+using std::string;
+
+
+TEST(JsonStreamTest, Writer)
+{
+  JSON::Writer writer;
+
+  writer.beginObject();
+  writer.key("name");
+  writer.value("/zookeeper/\"quoted\"");
+  writer.key("version");
+  writer.value(3);
+  writer.key("latency");
+  writer.value(0.25);
+  writer.key("ephemeral");
+  writer.value(false);
+  writer.key("owner");
+  writer.null();
+  writer.key("children");
+  writer.beginArray();
+  writer.value("a");
+  writer.beginArray();
+  writer.endArray();
+  writer.beginObject();
+  writer.endObject();
+  writer.endArray();
+  writer.key("stats");
+
+  JSON::Object stats;
+  stats.values["count"] = JSON::Number(42);
+  writer.value(stats);
+
+  EXPECT_FALSE(writer.finished());
+  writer.endObject();
+  EXPECT_TRUE(writer.finished());
+
+  EXPECT_EQ("{\"name\":\"\\/zookeeper\\/\\\"quoted\\\"\",\"version\":3,"
+            "\"latency\":0.25,\"ephemeral\":false,\"owner\":null,"
+            "\"children\":[\"a\",[],{}],\"stats\":{\"count\":42}}",
+            writer.data());
+
+  EXPECT_SOME(JSON::parse(writer.data()));
+}
+
+
+TEST(JsonStreamTest, WriterFileDescriptor)
+{
+  Try<string> path = os::mktemp();
+  ASSERT_SOME(path);
+
+  Try<int> fd = os::open(path.get(), O_WRONLY | O_TRUNC);
+  ASSERT_SOME(fd);
+
+  string expected = "[";
+
+  {
+    // Only buffers 16 bytes at a time.
+    JSON::Writer writer(fd.get(), 16);
+    writer.beginArray();
+    for (int i = 0; i < 100; i++) {
+      writer.value(i);
+      expected += (i > 0 ? "," : "") + stringify(i);
+      EXPECT_LT(writer.data().size(), 16u);
+    }
+    writer.endArray();
+    EXPECT_SOME(writer.flush());
+
+    expected += "]";
+  }
+
+  ASSERT_SOME(os::close(fd.get()));
+
+  Try<string> read = os::read(path.get());
+  ASSERT_SOME(read);
+  EXPECT_EQ(expected, read.get());
+
+  ASSERT_SOME(os::rm(path.get()));
+}
+
+
+TEST(JsonStreamTest, WriterError)
+{
+  // Write into a pipe without a reader (which fails with EPIPE rather
+  // than raising SIGPIPE while it's ignored).
+  int pipes[2];
+  ASSERT_NE(-1, ::pipe(pipes));
+  ASSERT_SOME(os::close(pipes[0]));
+
+  void (*handler)(int) = ::signal(SIGPIPE, SIG_IGN);
+  ASSERT_NE(SIG_ERR, handler);
+
+  {
+    // Writing errors are reported by the next flush.
+    JSON::Writer writer(pipes[1], 16);
+    writer.value("a string longer than 16 bytes");
+    EXPECT_ERROR(writer.flush());
+  }
+
+  ASSERT_NE(SIG_ERR, ::signal(SIGPIPE, handler));
+  ASSERT_SOME(os::close(pipes[1]));
+}
+
+
+// Returns the events of reading the input fed in chunks of the given
+// size, rendered as JSON again (or the error).
+static string events(const string& input, size_t chunk)
+{
+  JSON::Reader reader;
+  JSON::Writer writer;
+
+  size_t fed = 0;
+  while (true) {
+    Try<JSON::Reader::Event> event = reader.next();
+    if (event.isError()) {
+      return "error: " + event.error();
+    }
+
+    switch (event.get()) {
+      case JSON::Reader::MORE:
+        if (fed < input.size()) {
+          reader.feed(input.substr(fed, chunk));
+          fed += chunk;
+        } else {
+          reader.finish();
+        }
+        break;
+      case JSON::Reader::BEGIN_OBJECT: writer.beginObject(); break;
+      case JSON::Reader::END_OBJECT: writer.endObject(); break;
+      case JSON::Reader::BEGIN_ARRAY: writer.beginArray(); break;
+      case JSON::Reader::END_ARRAY: writer.endArray(); break;
+      case JSON::Reader::KEY: writer.key(reader.string()); break;
+      case JSON::Reader::STRING: writer.value(reader.string()); break;
+      case JSON::Reader::NUMBER: writer.value(reader.number()); break;
+      case JSON::Reader::BOOLEAN: writer.value(reader.boolean()); break;
+      case JSON::Reader::NIL: writer.null(); break;
+      case JSON::Reader::END: return writer.data();
+    }
+  }
+}
+
+
+TEST(JsonStreamTest, Reader)
+{
+  const string input =
+    " {\"a\": [1, -2.5e3, true, false, null, \"\", {}, []],\n"
+    "  \"b\" : {\"c\\u00e9\\ud83d\\ude00\":\"\xE2\x82\xAC\\n\\\\\"},"
+    "  \"d\": 12345678901234567890} ";
+
+  Try<JSON::Value> value = JSON::parse(input);
+  ASSERT_SOME(value);
+
+  const string expected = stringify(value.get());
+
+  // Everything at once, and in chunks splitting up every token.
+  for (size_t chunk = 1; chunk <= input.size(); chunk++) {
+    EXPECT_EQ(expected, events(input, chunk)) << "chunk " << chunk;
+  }
+
+  EXPECT_EQ("\"string\"", events("\"string\"", 3));
+  EXPECT_EQ("42", events("42", 1));
+  EXPECT_EQ("null", events(" null ", 2));
+}
+
+
+TEST(JsonStreamTest, ReaderFileDescriptor)
+{
+  JSON::Array array;
+  for (int i = 0; i < 1000; i++) {
+    JSON::Object object;
+    object.values["path"] = JSON::String("/zookeeper/" + stringify(i));
+    object.values["version"] = JSON::Number(i);
+    array.values.push_back(object);
+  }
+
+  Try<string> path = os::mktemp();
+  ASSERT_SOME(path);
+  ASSERT_SOME(os::write(path.get(), stringify(array)));
+
+  Try<int> fd = os::open(path.get(), O_RDONLY);
+  ASSERT_SOME(fd);
+
+  // Reads like the example in json_stream.hpp, including the tail
+  // of the file that doesn't fill up the buffer.
+  JSON::Reader reader;
+  char buffer[100];
+  int objects = 0;
+  int versions = 0;
+  while (true) {
+    Try<JSON::Reader::Event> event = reader.next();
+    ASSERT_SOME(event);
+    if (event.get() == JSON::Reader::MORE) {
+      ssize_t length = ::read(fd.get(), buffer, sizeof(buffer));
+      if (length > 0) {
+        reader.feed(buffer, length);
+      } else if (length == 0) {
+        reader.finish();
+      } else {
+        ASSERT_EQ(EINTR, errno);
+      }
+    } else if (event.get() == JSON::Reader::END) {
+      break;
+    } else if (event.get() == JSON::Reader::END_OBJECT) {
+      objects++;
+    } else if (event.get() == JSON::Reader::NUMBER) {
+      versions += static_cast<int>(reader.number());
+    }
+  }
+
+  EXPECT_EQ(1000, objects);
+  EXPECT_EQ(999 * 1000 / 2, versions);
+
+  ASSERT_SOME(os::close(fd.get()));
+  ASSERT_SOME(os::rm(path.get()));
+}
+
+
+TEST(JsonStreamTest, ReaderInvalid)
+{
+  const char* invalid[] = {
+    "", " ", "{", "[1,]", "[1 2]", "{\"a\" 1}", "{\"a\":}", "{1:2}",
+    "{\"a\":1,}", "[}", "{]", "]", "[1]]", "[1] 2", "tru", "nul",
+    "01", "1.", "-", "1e", "+1", "1e400", "\"abc", "\"\\x\"",
+    "\"\\ud83d\"", "\"\t\"", "\"\xFF\"", "[\"a\":1]", "{\"a\":1 \"b\":2}"
+  };
+
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+    EXPECT_EQ(0u, events(invalid[i], 1).find("error: "))
+      << "'" << invalid[i] << "'";
+    EXPECT_EQ(0u, events(invalid[i], 1024).find("error: "))
+      << "'" << invalid[i] << "'";
+  }
+
+  JSON::Reader reader;
+  reader.feed("[1,\n  x]");
+  EXPECT_SOME_EQ(JSON::Reader::BEGIN_ARRAY, reader.next());
+  EXPECT_SOME_EQ(JSON::Reader::NUMBER, reader.next());
+  EXPECT_EQ(1u, reader.depth());
+
+  Try<JSON::Reader::Event> event = reader.next();
+  ASSERT_ERROR(event);
+  EXPECT_EQ("Unexpected character 'x' at offset 6", event.error());
+
+  // Errors stick.
+  EXPECT_ERROR(reader.next());
+}
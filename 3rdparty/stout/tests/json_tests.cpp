@@ -2,9 +2,17 @@
 
 #include <gmock/gmock.h>
 
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+#include <list>
+#include <sstream>
 #include <string>
 
 #include <stout/json.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/stringify.hpp>
 
 using std::string;
@@ -17,3 +25,312 @@ TEST(JsonTest, BinaryData)
   EXPECT_EQ("\"\\\"\\\\\\/\\b\\f\\n\\r\\t\\u0000\\u0019 !#[]\\u007F\\u00FF\"",
             stringify(s));
 }
+
+
+TEST(JsonTest, Render)
+{
+  JSON::Object object;
+  object.values["key \"quoted\""] = JSON::String("value");
+  object.values["utf8"] = JSON::String("\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80");
+  object.values["invalid"] = JSON::String("\xC3(\xED\xA0\x80\xF0\x9F\x98");
+
+  EXPECT_EQ("{\"invalid\":\"\\u00C3(\\u00ED\\u00A0\\u0080\\u00F0\\u009F"
+            "\\u0098\",\"key \\\"quoted\\\"\":\"value\","
+            "\"utf8\":\"\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\"}",
+            stringify(object));
+
+  // Long enough for runs of 16 characters.
+  const string s = string(40, 'x') + "\n" + string(20, 'y') + "\"";
+  EXPECT_EQ("\"" + string(40, 'x') + "\\n" + string(20, 'y') + "\\\"\"",
+            stringify(JSON::String(s)));
+
+  EXPECT_EQ("0", stringify(JSON::Number(0)));
+  EXPECT_EQ("-0", stringify(JSON::Number(-0.0)));
+  EXPECT_EQ("-42", stringify(JSON::Number(-42)));
+  EXPECT_EQ("123456789012345", stringify(JSON::Number(123456789012345.0)));
+  EXPECT_EQ("1e+20", stringify(JSON::Number(1e20)));
+  EXPECT_EQ("0.1", stringify(JSON::Number(0.1)));
+  EXPECT_EQ("-1234.5678", stringify(JSON::Number(-1234.5678)));
+  EXPECT_EQ("0.000125", stringify(JSON::Number(0.000125)));
+  EXPECT_EQ("0.3333333333333333", stringify(JSON::Number(1.0 / 3)));
+  EXPECT_EQ("1.5e-07", stringify(JSON::Number(1.5e-7)));
+  EXPECT_EQ("null", stringify(JSON::Number(NAN)));
+  EXPECT_EQ("null", stringify(JSON::Number(INFINITY)));
+
+  // Numbers round-trip.
+  const double numbers[] = { 1.0 / 3, 2.0 / 3, 1e-300, 1.7976931348623157e308,
+                             5e-324, 0.30000000000000004, 0.1 + 0.2,
+                             1e15 + 0.5, 123456.7890123 };
+  for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++) {
+    const string json = stringify(JSON::Number(numbers[i]));
+    EXPECT_EQ(numbers[i], strtod(json.c_str(), NULL)) << json;
+  }
+
+  // Appending to a string renders the same as the ostream does (and
+  // doesn't leave formatting flags behind).
+  JSON::Array array;
+  array.values.push_back(JSON::Number(255));
+  array.values.push_back(JSON::String("\x01"));
+  array.values.push_back(JSON::True());
+
+  string buffer = "prefix";
+  JSON::render(&buffer, array);
+  EXPECT_EQ("prefix" + stringify(array), buffer);
+
+  std::ostringstream out;
+  out << array << " " << 255;
+  EXPECT_EQ("[255,\"\\u0001\",true] 255", out.str());
+}
+
+
+TEST(JsonTest, Parse)
+{
+  Try<JSON::Value> value = JSON::parse(
+      " {\"a\": [1, -2.5e3, true, false, null, \"\"],"
+      "  \"b\" : {\"c\":{}, \"d\":[]}, \"e\": \"f\\\"g\"} ");
+
+  ASSERT_TRUE(value.isSome()) << value.error();
+
+  // Note that Try::get returns a copy.
+  const JSON::Value root = value.get();
+  const JSON::Object& object = boost::get<JSON::Object>(root);
+  ASSERT_EQ(3u, object.values.size());
+
+  const JSON::Array& a =
+    boost::get<JSON::Array>(object.values.find("a")->second);
+  ASSERT_EQ(6u, a.values.size());
+
+  std::list<JSON::Value>::const_iterator i = a.values.begin();
+  EXPECT_EQ(1.0, boost::get<JSON::Number>(*i++).value);
+  EXPECT_EQ(-2500.0, boost::get<JSON::Number>(*i++).value);
+  EXPECT_NO_THROW(boost::get<JSON::True>(*i++));
+  EXPECT_NO_THROW(boost::get<JSON::False>(*i++));
+  EXPECT_NO_THROW(boost::get<JSON::Null>(*i++));
+  EXPECT_EQ("", boost::get<JSON::String>(*i++).value);
+
+  EXPECT_EQ("f\"g",
+            boost::get<JSON::String>(object.values.find("e")->second).value);
+
+  // Render and parse again.
+  Try<JSON::Value> again = JSON::parse(stringify(root));
+  ASSERT_TRUE(again.isSome()) << again.error();
+  EXPECT_EQ(stringify(root), stringify(again.get()));
+
+  // Any value is a JSON text.
+  EXPECT_EQ(42.0, boost::get<JSON::Number>(JSON::parse("42").get()).value);
+  EXPECT_NO_THROW(boost::get<JSON::Null>(JSON::parse(" null ").get()));
+}
+
+
+TEST(JsonTest, ParseStrings)
+{
+  Try<JSON::Value> value = JSON::parse(
+      "\"\\\"\\\\\\/\\b\\f\\n\\r\\t\\u0041\\u00e9\\u20AC\\ud83d\\ude00"
+      "\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\"");
+
+  ASSERT_TRUE(value.isSome()) << value.error();
+  EXPECT_EQ("\"\\/\b\f\n\r\tA"
+            "\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80"
+            "\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80",
+            boost::get<JSON::String>(value.get()).value);
+
+  // Escaped quotes and backslashes at every offset of a (16 byte)
+  // block, including across blocks.
+  for (size_t i = 0; i < 40; i++) {
+    for (size_t n = 1; n <= 3; n++) {
+      const string escaped = string(2 * n, '\\') + "\\\"";
+      const string json =
+        "[\"" + string(i, 'x') + escaped + "\", \"]\", [" +
+        string(i, ' ') + "0]]";
+
+      Try<JSON::Value> value = JSON::parse(json);
+      ASSERT_TRUE(value.isSome()) << json << ": " << value.error();
+
+      const JSON::Value root = value.get();
+      const JSON::Array& array = boost::get<JSON::Array>(root);
+      ASSERT_EQ(3u, array.values.size()) << json;
+      EXPECT_EQ(string(i, 'x') + string(n, '\\') + "\"",
+                boost::get<JSON::String>(array.values.front()).value);
+    }
+  }
+}
+
+
+TEST(JsonTest, ParseInvalid)
+{
+  const char* invalid[] = {
+    "", " ", "{", "}", "[", "[1,]", "[,1]", "{\"a\"}", "{\"a\":}",
+    "{\"a\":1,}", "{a:1}", "{\"a\" 1}", "[1 2]", "[1]]", "[1] x",
+    "tru", "truex", "True", "nul", "-", "+1", "01", "1.", ".1", "1e",
+    "1e+", "0x1", "NaN", "Infinity", "1e999", "\"abc", "\"\\\"",
+    "\"\\x\"", "\"\\u12\"", "\"\\u12G4\"", "\"\\ud83d\"",
+    "\"\\ude00\"", "\"\\ud83d\\u0041\"", "\"\t\"", "\"\x01\"",
+    "\"\xff\"", "\"\xc0\xaf\"", "\"\xe0\x80\xaf\"", "\"\xed\xa0\x80\"",
+    "\"\xf4\x90\x80\x80\"", "\"\xc3\"", "[\"a\" \"b\"]", "1 2",
+    "[\f1]",
+  };
+
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+    EXPECT_TRUE(JSON::parse(invalid[i]).isError()) << invalid[i];
+  }
+
+  // Nesting is limited (rather than overflowing the stack).
+  EXPECT_TRUE(JSON::parse(string(100000, '[')).isError());
+  EXPECT_TRUE(JSON::parse(string(500, '[') + string(500, ']')).isSome());
+}
+
+
+// A (large) document like those of our statistics endpoints.
+static JSON::Value document(size_t count)
+{
+  JSON::Array array;
+  for (size_t i = 0; i < count; i++) {
+    JSON::Object object;
+    object.values["name"] = JSON::String("/zookeeper/node/" + stringify(i));
+    object.values["timestamp"] = JSON::Number(1.3e9 + i);
+    object.values["latency"] = JSON::Number(i * 0.25);
+    object.values["active"] = JSON::True();
+    object.values["comment"] = JSON::String("escaped \"quotes\"\n");
+    JSON::Array values;
+    for (int j = 0; j < 8; j++) {
+      values.values.push_back(JSON::Number(i * j));
+    }
+    object.values["values"] = values;
+    array.values.push_back(object);
+  }
+  return array;
+}
+
+
+// Compares parsing against rendering (i.e., the other half of a
+// round trip), e.g.:
+//
+//   ./stout-tests --gtest_filter=JsonTest.* --gtest_also_run_disabled_tests
+TEST(JsonTest, DISABLED_ParseBenchmark)
+{
+  const JSON::Value value = document(100000);
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  string json;
+  JSON::render(&json, value);
+
+  const double rendered = stopwatch.elapsed().secs();
+
+  stopwatch.start();
+
+  Try<JSON::Value> parsed = JSON::parse(json);
+
+  const double parsing = stopwatch.elapsed().secs();
+
+  ASSERT_TRUE(parsed.isSome()) << parsed.error();
+
+  const double mb = json.size() / 1e6;
+
+  std::cout << "Rendered " << mb << " MB in " << rendered << " secs ("
+            << mb / rendered << " MB/s), parsed in " << parsing
+            << " secs (" << mb / parsing << " MB/s)" << std::endl;
+}
+
+
+TEST(JsonTest, Document)
+{
+  JSON::Document document;
+
+  JSON::Node& object = document.root().object();
+  object.add("timestamp", document).number(1.5);
+  object.add("name", document).string("a \"name\"", document);
+  object.add("active", document).boolean(true);
+  object.add("none", document);
+
+  JSON::Node& array = object.add("values", document).array();
+  for (int i = 0; i < 100; i++) {
+    array.append(document).number(i);
+  }
+
+  JSON::Node& nested = object.add("nested", document).object();
+  nested.add("empty", document).array();
+
+  EXPECT_EQ(6u, document.root().size());
+  EXPECT_EQ(100u, document.root().find("values")->size());
+  EXPECT_EQ(42.0, (*document.root().find("values"))[42].number());
+  EXPECT_EQ("a \"name\"", document.root().find("name")->string());
+  EXPECT_TRUE(document.root().find("missing") == NULL);
+
+  // Renders like the equivalent JSON::Object (in insertion order).
+  const string json = stringify(document.root());
+  EXPECT_EQ(0u, json.find("{\"timestamp\":1.5,\"name\":\"a \\\"name\\\"\","
+                          "\"active\":true,\"none\":null,\"values\":[0,1,"));
+  EXPECT_EQ(json.size() - strlen("98,99],\"nested\":{\"empty\":[]}}"),
+            json.find("98,99],\"nested\":{\"empty\":[]}}"));
+
+  Try<JSON::Value> parsed = JSON::parse(json);
+  ASSERT_TRUE(parsed.isSome()) << parsed.error();
+
+  document.clear();
+  EXPECT_EQ(JSON::Node::NIL, document.root().type());
+
+  document.root().array().append(document).string("again", document);
+  EXPECT_EQ("[\"again\"]", stringify(document.root()));
+}
+
+
+// Compares building (and destroying) a document like those of our
+// statistics endpoints as a JSON::Object against a JSON::Document.
+TEST(JsonTest, DISABLED_DocumentBenchmark)
+{
+  const int count = 1000;
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  for (int n = 0; n < count; n++) {
+    JSON::Object object;
+    object.values["timestamp"] = JSON::Number(n);
+    JSON::Object collectors;
+    for (int i = 0; i < 10; i++) {
+      JSON::Object collector;
+      collector.values["count"] = JSON::Number(i);
+      collector.values["time"] = JSON::Number(i);
+      collector.values["count_delta"] = JSON::Number(i);
+      collector.values["time_delta"] = JSON::Number(i);
+      collectors.values["collector" + stringify(i)] = collector;
+    }
+    object.values["collectors"] = collectors;
+    JSON::Array history;
+    for (int i = 0; i < 100; i++) {
+      history.values.push_back(JSON::Number(i));
+    }
+    object.values["history"] = history;
+  }
+
+  const double objects = stopwatch.elapsed().secs();
+
+  stopwatch.start();
+
+  JSON::Document document;
+  for (int n = 0; n < count; n++) {
+    document.clear();
+    JSON::Node& object = document.root().object();
+    object.add("timestamp", document).number(n);
+    JSON::Node& collectors = object.add("collectors", document).object();
+    for (int i = 0; i < 10; i++) {
+      JSON::Node& collector =
+        collectors.add("collector" + stringify(i), document).object();
+      collector.add("count", document).number(i);
+      collector.add("time", document).number(i);
+      collector.add("count_delta", document).number(i);
+      collector.add("time_delta", document).number(i);
+    }
+    JSON::Node& history = object.add("history", document).array();
+    for (int i = 0; i < 100; i++) {
+      history.append(document).number(i);
+    }
+  }
+
+  const double documents = stopwatch.elapsed().secs();
+
+  std::cout << "Built " << count << " objects in " << objects
+            << " secs, documents in " << documents << " secs" << std::endl;
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <gmock/gmock.h>
+
+#include <string>
+
+#if __cplusplus >= 201103L
+#include <utility>
+#endif
+
+#include <stout/none.hpp>
+#include <stout/option.hpp>
+
+using std::string;
+
+
+// Counts live instances to check that values get destroyed exactly
+// once (and that there is no default constructor to rely on).
+class Counted
+{
+public:
+  explicit Counted(const string& _value) : value(_value) { live++; }
+  Counted(const Counted& that) : value(that.value) { live++; }
+  ~Counted() { live--; }
+
+  bool operator == (const Counted& that) const { return value == that.value; }
+
+  static int live;
+
+  string value;
+};
+
+
+int Counted::live = 0;
+
+
+TEST(OptionTest, Some)
+{
+  {
+    Option<Counted> o = Counted("hello");
+    EXPECT_TRUE(o.isSome());
+    EXPECT_EQ("hello", o.get().value);
+    EXPECT_EQ(1, Counted::live);
+
+    Option<Counted> copy = o;
+    EXPECT_EQ(o, copy);
+    EXPECT_EQ(2, Counted::live);
+
+    copy = Option<Counted>::none();
+    EXPECT_TRUE(copy.isNone());
+    EXPECT_NE(o, copy);
+    EXPECT_EQ(1, Counted::live);
+
+    copy = o;
+    EXPECT_EQ("hello", copy.get().value);
+    EXPECT_EQ(2, Counted::live);
+  }
+
+  EXPECT_EQ(0, Counted::live);
+}
+
+
+TEST(OptionTest, SelfAssignment)
+{
+  Option<string> o = string("hello");
+  Option<string>& alias = o;
+  o = alias;
+  EXPECT_EQ("hello", o.get());
+
+  Option<string> none = None();
+  Option<string>& other = none;
+  none = other;
+  EXPECT_TRUE(none.isNone());
+}
+
+
+TEST(OptionTest, Default)
+{
+  Option<string> o = None();
+  EXPECT_EQ("default", o.get("default"));
+
+  o = string("value");
+  EXPECT_EQ("value", o.get("default"));
+}
+
+
+#if __cplusplus >= 201103L
+TEST(OptionTest, Move)
+{
+  string s(100, 'x');
+  Option<string> o = std::move(s);
+  EXPECT_EQ(string(100, 'x'), o.get());
+
+  Option<string> moved = std::move(o);
+  EXPECT_EQ(string(100, 'x'), moved.get());
+
+  Option<string> assigned;
+  assigned = std::move(moved);
+  EXPECT_EQ(string(100, 'x'), assigned.get());
+}
+#endif // __cplusplus >= 201103L
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include <gmock/gmock.h>
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <stout/timerwheel.hpp>
+
+using std::vector;
+
+
+TEST(TimerWheelTest, Expire)
+{
+  timerwheel<int> wheel(1000);
+
+  wheel.schedule(1, 1001);
+  wheel.schedule(2, 1063);
+  wheel.schedule(3, 1064); // Needs a cascade.
+  wheel.schedule(4, 1000 + 64 * 64 + 1); // Needs two cascades.
+  wheel.schedule(5, 999); // Already passed.
+
+  EXPECT_EQ(5u, wheel.size());
+
+  vector<int> expired;
+
+  wheel.advance(1000, &expired);
+  EXPECT_TRUE(expired.empty());
+
+  wheel.advance(1001, &expired);
+  ASSERT_EQ(2u, expired.size());
+  EXPECT_EQ(1, expired[0]);
+  EXPECT_EQ(5, expired[1]);
+
+  expired.clear();
+  wheel.advance(1062, &expired);
+  EXPECT_TRUE(expired.empty());
+
+  wheel.advance(1064, &expired);
+  ASSERT_EQ(2u, expired.size());
+  EXPECT_EQ(2, expired[0]);
+  EXPECT_EQ(3, expired[1]);
+
+  expired.clear();
+  wheel.advance(1000 + 64 * 64, &expired);
+  EXPECT_TRUE(expired.empty());
+
+  wheel.advance(1000 + 64 * 64 + 1, &expired);
+  ASSERT_EQ(1u, expired.size());
+  EXPECT_EQ(4, expired[0]);
+
+  EXPECT_EQ(0u, wheel.size());
+}
+
+
+TEST(TimerWheelTest, Cancel)
+{
+  timerwheel<int> wheel;
+
+  timerwheel<int>::handle h1 = wheel.schedule(1, 10);
+  wheel.schedule(2, 10);
+  timerwheel<int>::handle h3 = wheel.schedule(3, 100000);
+
+  EXPECT_EQ(10u, wheel.deadline(h1));
+
+  wheel.cancel(h1);
+  wheel.cancel(h3);
+  EXPECT_EQ(1u, wheel.size());
+
+  vector<int> expired;
+  wheel.advance(200000, &expired);
+  ASSERT_EQ(1u, expired.size());
+  EXPECT_EQ(2, expired[0]);
+}
+
+
+TEST(TimerWheelTest, Exact)
+{
+  // Every deadline, including ones beyond what the wheel covers
+  // (2^24 ticks), expires exactly on its tick.
+  const uint64_t start = 12345;
+  const uint64_t deadlines[] = {
+    start + 1, start + 63, start + 64, start + 4095, start + 4096,
+    start + 262143, start + 262144, (1 << 24) - 1, 1 << 24,
+    start + (1 << 24), start + 3 * (1 << 24) + 17,
+  };
+  const size_t count = sizeof(deadlines) / sizeof(deadlines[0]);
+
+  timerwheel<uint64_t> wheel(start);
+  for (size_t i = 0; i < count; i++) {
+    wheel.schedule(deadlines[i], deadlines[i]);
+  }
+
+  vector<uint64_t> expired;
+  for (size_t i = 0; i < count; i++) {
+    wheel.advance(deadlines[i] - 1, &expired);
+    EXPECT_EQ(i, expired.size());
+    wheel.advance(deadlines[i], &expired);
+    ASSERT_EQ(i + 1, expired.size());
+    EXPECT_EQ(deadlines[i], expired.back());
+  }
+}
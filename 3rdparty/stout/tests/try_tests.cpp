@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include <gmock/gmock.h>
+
+#include <string>
+#include <vector>
+
+#if __cplusplus >= 201103L
+#include <utility>
+#endif
+
+#include <stout/error.hpp>
+#include <stout/none.hpp>
+#include <stout/result.hpp>
+#include <stout/try.hpp>
+
+using std::string;
+using std::vector;
+
+
+Try<vector<string> > split(const string& s)
+{
+  if (s.empty()) {
+    return Error("Empty");
+  }
+  return vector<string>(1, s);
+}
+
+
+TEST(TryTest, Test)
+{
+  Try<vector<string> > t = split("hello");
+  ASSERT_TRUE(t.isSome());
+  EXPECT_EQ(1u, t.get().size());
+
+  t = split("");
+  ASSERT_TRUE(t.isError());
+  EXPECT_EQ("Empty", t.error());
+
+  t = split("world");
+  ASSERT_TRUE(t.isSome());
+  EXPECT_EQ("world", t.get().front());
+
+  Try<vector<string> >& alias = t;
+  t = alias;
+  ASSERT_TRUE(t.isSome());
+  EXPECT_EQ("world", t.get().front());
+}
+
+
+TEST(ResultTest, Test)
+{
+  Result<string> r = string("hello");
+  ASSERT_TRUE(r.isSome());
+  EXPECT_EQ("hello", r.get());
+
+  Result<string> copy = r;
+  r = None();
+  ASSERT_TRUE(r.isNone());
+  EXPECT_EQ("hello", copy.get());
+
+  r = Error("error");
+  ASSERT_TRUE(r.isError());
+  EXPECT_EQ("error", r.error());
+
+  copy = r;
+  ASSERT_TRUE(copy.isError());
+  EXPECT_EQ("error", copy.error());
+}
+
+
+#if __cplusplus >= 201103L
+TEST(TryTest, Move)
+{
+  Try<string> t = string(100, 'x');
+  Try<string> moved = std::move(t);
+  EXPECT_EQ(string(100, 'x'), moved.get());
+
+  Result<string> r = string(100, 'y');
+  Result<string> assigned = None();
+  assigned = std::move(r);
+  EXPECT_EQ(string(100, 'y'), assigned.get());
+}
+#endif // __cplusplus >= 201103L
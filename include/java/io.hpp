@@ -1,6 +1,9 @@
 #ifndef __JAVA_IO_HPP__
 #define __JAVA_IO_HPP__
 
+#include <string>
+#include <vector>
+
 #include <jvm.hpp>
 
 #include <java/lang.hpp>
@@ -18,9 +21,13 @@ public:
         .constructor()
         .parameter(Jvm::Class::STRING));
 
-    object = Jvm::get()->invoke(constructor, Jvm::get()->string(pathname));
+    reset(Jvm::get()->invoke(constructor, Jvm::get()->string(pathname)));
   }
 
+  // Wraps an existing 'java.io.File' instance (e.g., an element of the
+  // array returned from 'listFiles').
+  explicit File(jobject file) : java::lang::Object(file) {}
+
   void deleteOnExit()
   {
     static Jvm::Method method = Jvm::get()->findMethod(
@@ -38,7 +45,77 @@ public:
         .method("exists")
         .returns(Jvm::Class::BOOLEAN));
 
-    Jvm::get()->invoke<bool>(object, method);
+    return Jvm::get()->invoke<bool>(object, method);
+  }
+
+  bool isDirectory()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/io/File")
+        .method("isDirectory")
+        .returns(Jvm::Class::BOOLEAN));
+
+    return Jvm::get()->invoke<bool>(object, method);
+  }
+
+  long length()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/io/File")
+        .method("length")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  long lastModified()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/io/File")
+        .method("lastModified")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  // Returns the names of the files in this directory (empty if this
+  // is not a directory or an I/O error occurs).
+  std::vector<std::string> list()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/io/File")
+        .method("list")
+        .returns(Jvm::Class::STRING.arrayOf()));
+
+    jobject array = Jvm::get()->invoke<jobject>(object, method);
+
+    const std::vector<std::string> result =
+      Jvm::get()->strings(static_cast<jobjectArray>(array));
+
+    JNI::Env env;
+    env->DeleteLocalRef(array);
+
+    return result;
+  }
+
+  // Returns the files in this directory (empty if this is not a
+  // directory or an I/O error occurs).
+  std::vector<File> listFiles()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/io/File")
+        .method("listFiles")
+        .returns(Jvm::Class::named("java/io/File").arrayOf()));
+
+    jobject array = Jvm::get()->invoke<jobject>(object, method);
+
+    const std::vector<File> result =
+      Jvm::get()->objects<File>(static_cast<jobjectArray>(array));
+
+    JNI::Env env;
+    env->DeleteLocalRef(array);
+
+    return result;
   }
 };
 
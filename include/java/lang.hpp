@@ -1,6 +1,8 @@
 #ifndef __JAVA_LANG_HPP__
 #define __JAVA_LANG_HPP__
 
+#include <stout/option.hpp>
+
 #include <jvm.hpp>
 
 namespace java {
@@ -31,10 +33,13 @@ public:
 
   Object& operator = (const Object& that)
   {
-    if (object != NULL) {
-      Jvm::get()->deleteGlobalRef(object);
-    }
+    // Create the new reference before deleting the old one since they
+    // refer to the same object on self-assignment.
+    jobject previous = object;
     object = Jvm::get()->newGlobalRef(that.object);
+    if (previous != NULL) {
+      Jvm::get()->deleteGlobalRef(previous);
+    }
     return *this;
   }
 
@@ -46,10 +51,140 @@ public:
 protected:
   friend void Jvm::check(JNIEnv* env); // For manipulating object.
 
+  // Replaces the object with (a global reference to) the object of a
+  // local reference (e.g., as returned from Jvm::invoke) and deletes
+  // the local reference, which would otherwise linger until the
+  // thread returns to Java or detaches.
+  void reset(jobject local)
+  {
+    jobject previous = object;
+    object = Jvm::get()->newGlobalRef(local);
+    Jvm::get()->deleteLocalRef(local);
+    if (previous != NULL) {
+      Jvm::get()->deleteGlobalRef(previous);
+    }
+  }
+
   jobject object;
 };
 
 
+// A weak global reference to an object, i.e., one that does not keep
+// the object from being garbage collected. Use it to associate state
+// with Java objects (e.g., in a cache) without pinning them in the
+// heap. T must be constructible from a jobject.
+template <typename T = Object>
+class Weak
+{
+public:
+  Weak() : reference(NULL) {}
+
+  explicit Weak(const T& t)
+    : reference(Jvm::get()->newWeakGlobalRef(t)) {}
+
+  Weak(const Weak<T>& that)
+    : reference(Jvm::get()->newWeakGlobalRef(that.reference)) {}
+
+  ~Weak()
+  {
+    if (reference != NULL) {
+      Jvm::get()->deleteWeakGlobalRef(reference);
+    }
+  }
+
+  Weak<T>& operator = (const Weak<T>& that)
+  {
+    jweak previous = reference;
+    reference = Jvm::get()->newWeakGlobalRef(that.reference);
+    if (previous != NULL) {
+      Jvm::get()->deleteWeakGlobalRef(previous);
+    }
+    return *this;
+  }
+
+  // Returns the object (i.e., a strong reference to it which keeps
+  // it from being collected for as long as it's around) or none if
+  // it has been collected. Note that checking 'collected' first is
+  // not enough since the object might get collected right after.
+  Option<T> get() const
+  {
+    jobject local = Jvm::get()->newLocalRef(reference);
+    if (local == NULL) {
+      return Option<T>::none();
+    }
+    T t(local);
+    Jvm::get()->deleteLocalRef(local);
+    return t;
+  }
+
+  // Returns true if the object has been collected (or there is none).
+  bool collected() const
+  {
+    return Jvm::get()->collected(reference);
+  }
+
+private:
+  jweak reference;
+};
+
+
+class Long : public Object
+{
+public:
+  Long(long value)
+  {
+    static Jvm::Constructor constructor = Jvm::get()->findConstructor(
+        Jvm::Class::named("java/lang/Long")
+        .constructor()
+        .parameter(Jvm::Class::LONG));
+
+    reset(Jvm::get()->invoke(constructor, (jlong) value));
+  }
+};
+
+
+class System
+{
+public:
+  // Returns the value of the property (or the empty string).
+  static std::string getProperty(const std::string& key)
+  {
+    static Jvm::Method method = Jvm::get()->findStaticMethod(
+        Jvm::Class::named("java/lang/System")
+        .method("getProperty")
+        .parameter(Jvm::Class::STRING)
+        .returns(Jvm::Class::STRING));
+
+    return Jvm::get()->string(
+        static_cast<jstring>(Jvm::get()->invokeStatic<jobject>(
+            method,
+            Jvm::get()->string(key))));
+  }
+
+  // Returns the previous value of the property (or the empty string).
+  static std::string setProperty(
+      const std::string& key,
+      const std::string& value)
+  {
+    static Jvm::Method method = Jvm::get()->findStaticMethod(
+        Jvm::Class::named("java/lang/System")
+        .method("setProperty")
+        .parameter(Jvm::Class::STRING)
+        .parameter(Jvm::Class::STRING)
+        .returns(Jvm::Class::STRING));
+
+    return Jvm::get()->string(
+        static_cast<jstring>(Jvm::get()->invokeStatic<jobject>(
+            method,
+            Jvm::get()->string(key),
+            Jvm::get()->string(value))));
+  }
+
+private:
+  System() {} // Static methods only.
+};
+
+
 class Throwable : public Object
 {
 public:
@@ -60,7 +195,7 @@ public:
         .constructor()
         .parameter(Jvm::Class::STRING));
 
-    object = Jvm::get()->invoke(constructor, Jvm::get()->string(message));
+    reset(Jvm::get()->invoke(constructor, Jvm::get()->string(message)));
   }
 
 private:
@@ -0,0 +1,301 @@
+#ifndef __JAVA_LANG_MANAGEMENT_HPP__
+#define __JAVA_LANG_MANAGEMENT_HPP__
+
+#include <string>
+#include <vector>
+
+#include <jvm.hpp>
+
+#include <java/lang.hpp>
+
+namespace java {
+namespace lang {
+namespace management {
+
+class MemoryUsage : public java::lang::Object
+{
+public:
+  explicit MemoryUsage(jobject usage) : java::lang::Object(usage) {}
+
+  // All sizes are in bytes, 'getInit' and 'getMax' return -1 if
+  // undefined.
+  long getInit()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/MemoryUsage")
+        .method("getInit")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  long getUsed()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/MemoryUsage")
+        .method("getUsed")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  long getCommitted()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/MemoryUsage")
+        .method("getCommitted")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  long getMax()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/MemoryUsage")
+        .method("getMax")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+};
+
+
+class MemoryMXBean : public java::lang::Object // Interface.
+{
+public:
+  explicit MemoryMXBean(jobject bean) : java::lang::Object(bean) {}
+
+  MemoryUsage getHeapMemoryUsage()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/MemoryMXBean")
+        .method("getHeapMemoryUsage")
+        .returns(Jvm::Class::named("java/lang/management/MemoryUsage")));
+
+    return MemoryUsage(Jvm::get()->invoke<jobject>(object, method));
+  }
+
+  MemoryUsage getNonHeapMemoryUsage()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/MemoryMXBean")
+        .method("getNonHeapMemoryUsage")
+        .returns(Jvm::Class::named("java/lang/management/MemoryUsage")));
+
+    return MemoryUsage(Jvm::get()->invoke<jobject>(object, method));
+  }
+
+  int getObjectPendingFinalizationCount()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/MemoryMXBean")
+        .method("getObjectPendingFinalizationCount")
+        .returns(Jvm::Class::INT));
+
+    return Jvm::get()->invoke<int>(object, method);
+  }
+};
+
+
+class GarbageCollectorMXBean : public java::lang::Object // Interface.
+{
+public:
+  explicit GarbageCollectorMXBean(jobject bean)
+    : java::lang::Object(bean) {}
+
+  // The name of the collector (e.g., "PS Scavenge").
+  std::string getName()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/MemoryManagerMXBean")
+        .method("getName")
+        .returns(Jvm::Class::STRING));
+
+    return Jvm::get()->string(
+        static_cast<jstring>(Jvm::get()->invoke<jobject>(object, method)));
+  }
+
+  // Total number of collections (or -1 if undefined).
+  long getCollectionCount()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/GarbageCollectorMXBean")
+        .method("getCollectionCount")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  // Accumulated collection time in milliseconds (or -1 if undefined).
+  long getCollectionTime()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/GarbageCollectorMXBean")
+        .method("getCollectionTime")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+};
+
+
+class ThreadMXBean : public java::lang::Object // Interface.
+{
+public:
+  explicit ThreadMXBean(jobject bean) : java::lang::Object(bean) {}
+
+  int getThreadCount()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/ThreadMXBean")
+        .method("getThreadCount")
+        .returns(Jvm::Class::INT));
+
+    return Jvm::get()->invoke<int>(object, method);
+  }
+
+  int getPeakThreadCount()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/ThreadMXBean")
+        .method("getPeakThreadCount")
+        .returns(Jvm::Class::INT));
+
+    return Jvm::get()->invoke<int>(object, method);
+  }
+
+  int getDaemonThreadCount()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/ThreadMXBean")
+        .method("getDaemonThreadCount")
+        .returns(Jvm::Class::INT));
+
+    return Jvm::get()->invoke<int>(object, method);
+  }
+
+  long getTotalStartedThreadCount()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/ThreadMXBean")
+        .method("getTotalStartedThreadCount")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+};
+
+
+class RuntimeMXBean : public java::lang::Object // Interface.
+{
+public:
+  explicit RuntimeMXBean(jobject bean) : java::lang::Object(bean) {}
+
+  // Milliseconds since the JVM started.
+  long getUptime()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/RuntimeMXBean")
+        .method("getUptime")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  // Milliseconds since the epoch when the JVM started.
+  long getStartTime()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/RuntimeMXBean")
+        .method("getStartTime")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  std::string getVmName()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/RuntimeMXBean")
+        .method("getVmName")
+        .returns(Jvm::Class::STRING));
+
+    return Jvm::get()->string(
+        static_cast<jstring>(Jvm::get()->invoke<jobject>(object, method)));
+  }
+
+  std::string getVmVersion()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/management/RuntimeMXBean")
+        .method("getVmVersion")
+        .returns(Jvm::Class::STRING));
+
+    return Jvm::get()->string(
+        static_cast<jstring>(Jvm::get()->invoke<jobject>(object, method)));
+  }
+};
+
+
+class ManagementFactory
+{
+public:
+  static MemoryMXBean getMemoryMXBean()
+  {
+    static Jvm::Method method = Jvm::get()->findStaticMethod(
+        Jvm::Class::named("java/lang/management/ManagementFactory")
+        .method("getMemoryMXBean")
+        .returns(Jvm::Class::named("java/lang/management/MemoryMXBean")));
+
+    return MemoryMXBean(Jvm::get()->invokeStatic<jobject>(method));
+  }
+
+  static std::vector<GarbageCollectorMXBean> getGarbageCollectorMXBeans()
+  {
+    static Jvm::Method method = Jvm::get()->findStaticMethod(
+        Jvm::Class::named("java/lang/management/ManagementFactory")
+        .method("getGarbageCollectorMXBeans")
+        .returns(Jvm::Class::named("java/util/List")));
+
+    static Jvm::Method toArray = Jvm::get()->findMethod(
+        Jvm::Class::named("java/util/List")
+        .method("toArray")
+        .returns(Jvm::Class::named("java/lang/Object").arrayOf()));
+
+    Jvm* jvm = Jvm::get();
+
+    return jvm->objects<GarbageCollectorMXBean>(
+        static_cast<jobjectArray>(jvm->invoke<jobject>(
+            jvm->invokeStatic<jobject>(method), toArray)));
+  }
+
+  static ThreadMXBean getThreadMXBean()
+  {
+    static Jvm::Method method = Jvm::get()->findStaticMethod(
+        Jvm::Class::named("java/lang/management/ManagementFactory")
+        .method("getThreadMXBean")
+        .returns(Jvm::Class::named("java/lang/management/ThreadMXBean")));
+
+    return ThreadMXBean(Jvm::get()->invokeStatic<jobject>(method));
+  }
+
+  static RuntimeMXBean getRuntimeMXBean()
+  {
+    static Jvm::Method method = Jvm::get()->findStaticMethod(
+        Jvm::Class::named("java/lang/management/ManagementFactory")
+        .method("getRuntimeMXBean")
+        .returns(Jvm::Class::named("java/lang/management/RuntimeMXBean")));
+
+    return RuntimeMXBean(Jvm::get()->invokeStatic<jobject>(method));
+  }
+
+private:
+  ManagementFactory() {} // Static methods only.
+};
+
+} // namespace management {
+} // namespace lang {
+} // namespace java {
+
+#endif // __JAVA_LANG_MANAGEMENT_HPP__
@@ -1,6 +1,8 @@
 #ifndef __JAVA_NET_HPP__
 #define __JAVA_NET_HPP__
 
+#include <string>
+
 #include <jvm.hpp>
 
 #include <java/lang.hpp>
@@ -25,7 +27,19 @@ public:
         .constructor()
         .parameter(Jvm::Class::INT));
 
-    object = Jvm::get()->invoke(constructor, port);
+    reset(Jvm::get()->invoke(constructor, port));
+  }
+
+  InetSocketAddress(const std::string& hostname, int port)
+  {
+    static Jvm::Constructor constructor = Jvm::get()->findConstructor(
+        Jvm::Class::named("java/net/InetSocketAddress")
+        .constructor()
+        .parameter(Jvm::Class::STRING)
+        .parameter(Jvm::Class::INT));
+
+    reset(Jvm::get()->invoke(
+        constructor, Jvm::get()->string(hostname), port));
   }
 };
 
@@ -0,0 +1,47 @@
+#ifndef __JAVA_UTIL_HPP__
+#define __JAVA_UTIL_HPP__
+
+#include <jvm.hpp>
+
+#include <java/lang.hpp>
+
+namespace java {
+namespace util {
+
+class Map : public java::lang::Object
+{
+public:
+  void put(const java::lang::Object& key, const java::lang::Object& value)
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/util/Map")
+        .method("put")
+        .parameter(Jvm::Class::named("java/lang/Object"))
+        .parameter(Jvm::Class::named("java/lang/Object"))
+        .returns(Jvm::Class::named("java/lang/Object")));
+
+    Jvm::get()->invoke<jobject>(object, method, (jobject) key, (jobject) value);
+  }
+
+protected:
+  Map() {} // Interface, necessary for subclasses.
+};
+
+
+class HashMap : public Map
+{
+public:
+  HashMap()
+  {
+    static Jvm::Constructor constructor = Jvm::get()->findConstructor(
+        Jvm::Class::named("java/util/HashMap")
+        .constructor());
+
+    reset(Jvm::get()->invoke(constructor));
+  }
+};
+
+} // namespace util {
+} // namespace java {
+
+#endif // __JAVA_UTIL_HPP__
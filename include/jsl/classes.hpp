@@ -0,0 +1,90 @@
+#ifndef __JSL_CLASSES_HPP__
+#define __JSL_CLASSES_HPP__
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
+#include <stout/nothing.hpp>
+#include <stout/try.hpp>
+
+#include <java/lang.hpp>
+
+namespace jsl {
+namespace classes {
+
+// Defines classes from bytecode in memory rather than having the JVM
+// find them on the classpath, e.g., to bundle jars into a binary (no
+// disk I/O or zip scanning when resolving classes, and no jars to
+// ship alongside). For example, with a jar linked in as a data
+// section via 'ld -r -b binary -o classes.o classes.jar':
+//
+//   extern const char _binary_classes_jar_start[];
+//   extern const char _binary_classes_jar_end[];
+//
+//   jsl::classes::Embedded embedded;
+//   embedded.addJar(
+//       _binary_classes_jar_start,
+//       _binary_classes_jar_end - _binary_classes_jar_start);
+//   embedded.define();
+//
+// Classes get defined in the system class loader so that they are
+// found like any class on the classpath (e.g., by Jvm::findClass or
+// by classes on the classpath that depend on them). Note that only
+// classes are supported, not resources (e.g., properties files).
+class Embedded
+{
+public:
+  Embedded();
+
+  // Adds the bytecode of a class, named by its fully-qualified name
+  // (e.g., 'jsl/io/Files'). The bytes are not copied, i.e., they must
+  // stay around until the class is defined.
+  void add(const std::string& name, const char* data, size_t size);
+
+  // Adds the classes in a jar (or zip) in memory. This only indexes
+  // its entries, each gets inflated when its class is defined. The
+  // bytes are not copied (see above).
+  Try<Nothing> addJar(const char* data, size_t size);
+
+  bool contains(const std::string& name) const;
+
+  // Returns the names of all classes added.
+  std::vector<std::string> names() const;
+
+  // Defines the class (after its superclass and interfaces if they
+  // have been added too) unless it has already been defined or loaded
+  // (e.g., from the classpath).
+  Try<Nothing> define(const std::string& name);
+
+  // Defines all classes added.
+  Try<Nothing> define();
+
+private:
+  struct Entry
+  {
+    const char* data;
+    size_t size; // As stored, i.e., possibly compressed.
+    size_t length; // Of the class file.
+    bool deflated;
+  };
+
+  // Not copyable, not assignable.
+  Embedded(const Embedded&);
+  Embedded& operator = (const Embedded&);
+
+  bool loaded(const std::string& name);
+
+  const java::lang::Object loader; // The system class loader.
+
+  hashmap<std::string, Entry> entries;
+  hashset<std::string> defined;
+};
+
+} // namespace classes {
+} // namespace jsl {
+
+#endif // __JSL_CLASSES_HPP__
@@ -0,0 +1,102 @@
+#ifndef __JSL_IO_HPP__
+#define __JSL_IO_HPP__
+
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <jvm.hpp>
+
+// Wrappers for the Java helpers in package 'jsl.io' (see
+// src/java/jsl/io). These classes are bundled in jsl.jar which must
+// be on the classpath of the JVM.
+
+namespace jsl {
+namespace io {
+
+class Files
+{
+public:
+  // Snapshot of a path as seen by 'java.io.File'.
+  struct Status
+  {
+    Status(const std::string& _path,
+           bool _exists,
+           bool _directory,
+           bool _file,
+           long _length,
+           long _lastModified)
+      : path(_path),
+        exists(_exists),
+        directory(_directory),
+        file(_file),
+        length(_length),
+        lastModified(_lastModified) {}
+
+    std::string path;
+    bool exists;
+    bool directory;
+    bool file;
+    long length;
+    long lastModified; // Milliseconds since the epoch.
+  };
+
+  // Returns the status of each of the paths (in order) using a single
+  // call into the JVM rather than a call per path and query.
+  static std::vector<Status> stat(const std::vector<std::string>& paths)
+  {
+    static Jvm::Method method = Jvm::get()->findStaticMethod(
+        Jvm::Class::named("jsl/io/Files")
+        .method("stat")
+        .parameter(Jvm::Class::STRING.arrayOf())
+        .returns(Jvm::Class::LONG.arrayOf()));
+
+    JNI::Env env;
+
+    jobjectArray strings = Jvm::get()->strings(paths);
+
+    jobject array = Jvm::get()->invokeStatic<jobject>(method, strings);
+
+    env->DeleteLocalRef(strings);
+
+    const std::vector<long> fields =
+      Jvm::get()->longs(static_cast<jlongArray>(array));
+
+    env->DeleteLocalRef(array);
+
+    CHECK_EQ(fields.size(), paths.size() * STAT_FIELDS);
+
+    std::vector<Status> result;
+    result.reserve(paths.size());
+
+    for (size_t i = 0; i < paths.size(); i++) {
+      const long flags = fields[i * STAT_FIELDS];
+      result.push_back(Status(
+          paths[i],
+          (flags & EXISTS) != 0,
+          (flags & DIRECTORY) != 0,
+          (flags & FILE) != 0,
+          fields[i * STAT_FIELDS + 1],
+          fields[i * STAT_FIELDS + 2]));
+    }
+
+    return result;
+  }
+
+private:
+  // Layout of the array returned by 'jsl.io.Files.stat', these must
+  // be kept in sync with the constants in Files.java.
+  enum
+  {
+    EXISTS = 1,
+    DIRECTORY = 2,
+    FILE = 4,
+    STAT_FIELDS = 3
+  };
+};
+
+} // namespace io {
+} // namespace jsl {
+
+#endif // __JSL_IO_HPP__
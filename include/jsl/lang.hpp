@@ -0,0 +1,52 @@
+#ifndef __JSL_LANG_HPP__
+#define __JSL_LANG_HPP__
+
+#include <string>
+#include <vector>
+
+#include <jvm.hpp>
+
+#include <java/lang.hpp>
+
+// Wrappers for the Java helpers in package 'jsl.lang' (see
+// src/java/jsl/lang). These classes are bundled in jsl.jar which must
+// be on the classpath of the JVM.
+
+namespace jsl {
+namespace lang {
+
+// Base class for implementing Java interfaces in C++. A subclass
+// creates a Java object via 'proxy' which forwards calls of the named
+// methods to 'invoke' (on the calling Java thread). All other methods
+// of the interface return null, false or zero. Note that the handler
+// must outlive any proxies that were created from it.
+class NativeInvocationHandler
+{
+public:
+  virtual ~NativeInvocationHandler() {}
+
+  // Invoked with the index of the method (in the list passed to
+  // 'proxy') and its arguments (boxed if primitive). Returns the
+  // result as a local reference (or NULL for the default value). A
+  // java::lang::Throwable thrown from here is rethrown in Java.
+  virtual jobject invoke(JNIEnv* env, int method, jobjectArray args) = 0;
+
+protected:
+  // Returns a new proxy implementing the interface, named by its
+  // fully-qualified class name (e.g., 'org/apache/log4j/Appender').
+  java::lang::Object proxy(
+      const std::string& interface,
+      const std::vector<std::string>& methods);
+
+  // Returns a new proxy implementing all of the interfaces. Note that
+  // methods are matched by name only, so same-named methods of
+  // different interfaces share an index.
+  java::lang::Object proxy(
+      const std::vector<std::string>& interfaces,
+      const std::vector<std::string>& methods);
+};
+
+} // namespace lang {
+} // namespace jsl {
+
+#endif // __JSL_LANG_HPP__
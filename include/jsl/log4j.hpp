@@ -0,0 +1,91 @@
+#ifndef __JSL_LOG4J_HPP__
+#define __JSL_LOG4J_HPP__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <string>
+
+#include <jvm.hpp>
+
+#include <jsl/lang.hpp>
+#include <jsl/ringbuffer.hpp>
+
+#include <org/apache/log4j.hpp>
+
+namespace jsl {
+namespace log4j {
+
+// A log4j appender implemented in C++ that funnels events from Java
+// loggers into glog. Appending only copies the level, logger name and
+// message of an event into a bounded lock-free ring buffer (dropping
+// the event if the buffer is full) so Java threads never block on
+// I/O. A dedicated thread drains the buffer into glog in batches.
+// Note that log4j itself still synchronizes on the logger while
+// calling its appenders. Usage:
+//
+//   jsl::log4j::GlogAppender appender;
+//   Logger logger = Logger::getRootLogger();
+//   logger.addAppender(appender.appender());
+//
+// The GlogAppender must be removed from all loggers before it is
+// destroyed.
+class GlogAppender : public jsl::lang::NativeInvocationHandler
+{
+public:
+  struct Statistics
+  {
+    uint64_t appended; // Events copied into the buffer.
+    uint64_t dropped;  // Events dropped because the buffer was full.
+    uint64_t logged;   // Events written to glog.
+  };
+
+  // The capacity (number of buffered events) must be a power of two.
+  explicit GlogAppender(size_t capacity = 8192);
+  virtual ~GlogAppender();
+
+  // Returns the 'org.apache.log4j.Appender' for this appender.
+  org::apache::log4j::Appender appender() const { return _appender; }
+
+  Statistics statistics() const;
+
+  virtual jobject invoke(JNIEnv* env, int method, jobjectArray args);
+
+private:
+  // Not copyable, not assignable.
+  GlogAppender(const GlogAppender&);
+  GlogAppender& operator = (const GlogAppender&);
+
+  struct Event
+  {
+    int level; // See 'org.apache.log4j.Priority.toInt()'.
+    std::string logger;
+    std::string message;
+  };
+
+  void append(jobject event);
+
+  // Drains the buffer into glog until stopped.
+  static void* drain(void* that);
+
+  // Writes up to 'limit' buffered events to glog, returns how many
+  // were written.
+  size_t flush(size_t limit);
+
+  RingBuffer<Event> events;
+
+  org::apache::log4j::Appender _appender;
+
+  pthread_t thread;
+  volatile bool running;
+  volatile bool closed;
+
+  volatile uint64_t appended;
+  volatile uint64_t dropped;
+  volatile uint64_t logged;
+};
+
+} // namespace log4j {
+} // namespace jsl {
+
+#endif // __JSL_LOG4J_HPP__
@@ -0,0 +1,121 @@
+#ifndef __JSL_MANAGEMENT_HPP__
+#define __JSL_MANAGEMENT_HPP__
+
+#include <pthread.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <stout/duration.hpp>
+#include <stout/json.hpp>
+#include <stout/option.hpp>
+
+#include <java/lang/management.hpp>
+
+namespace jsl {
+namespace management {
+
+// Returns the current time in seconds since the epoch, i.e., the
+// clock used for the timestamps of the statistics below (and those of
+// jsl::zookeeper::Statistics). Use it to timestamp native latency
+// measurements so they can be lined up with JVM samples (e.g., to
+// attribute tail latency to GC pauses).
+double now();
+
+
+// Point-in-time statistics of the JVM.
+struct Statistics
+{
+  double timestamp; // Seconds since the epoch, see 'now'.
+  long uptime; // Milliseconds since the JVM started.
+
+  // Memory usage in bytes ('max' is -1 if undefined).
+  struct Usage
+  {
+    long used;
+    long committed;
+    long max;
+  };
+
+  Usage heap;
+  Usage nonHeap;
+
+  struct Collector
+  {
+    std::string name; // E.g., "PS Scavenge" or "PS MarkSweep".
+
+    // Totals since the JVM started.
+    long count;
+    long time; // In milliseconds.
+
+    // Since the previous sample (zero for the first one). Note that
+    // pauses shorter than a millisecond might not add to 'time'.
+    long countDelta;
+    long timeDelta;
+  };
+
+  std::vector<Collector> collectors;
+
+  int threads;
+  int peakThreads;
+  int daemonThreads;
+  long startedThreads;
+};
+
+
+// Returns the statistics as a JSON object (keyed by field name, with
+// collectors keyed by their name).
+JSON::Object json(const Statistics& statistics);
+
+
+// Samples the statistics of the JVM every 'interval' on a dedicated
+// thread (which stays attached to the JVM), keeping the most recent
+// 'capacity' samples. Each sample costs a few dozen JNI calls and the
+// (small) allocations of the MemoryUsage objects in the JVM.
+class Sampler
+{
+public:
+  explicit Sampler(
+      const Duration& interval = Seconds(1),
+      size_t capacity = 60);
+
+  ~Sampler();
+
+  // Returns the most recent sample, if any.
+  Option<Statistics> latest();
+
+  // Returns the retained samples, oldest first.
+  JSON::Array history();
+
+private:
+  // Not copyable, not assignable.
+  Sampler(const Sampler&);
+  Sampler& operator = (const Sampler&);
+
+  static void* run(void* that);
+
+  Statistics sample(const Option<Statistics>& previous);
+
+  java::lang::management::MemoryMXBean memory;
+  std::vector<java::lang::management::GarbageCollectorMXBean> collectors;
+  java::lang::management::ThreadMXBean threads;
+  java::lang::management::RuntimeMXBean runtime;
+
+  // Names of the collectors (which never change).
+  std::vector<std::string> names;
+
+  const Duration interval;
+  const size_t capacity;
+
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  bool running; // Protected by 'mutex'.
+  std::deque<Statistics> samples; // Protected by 'mutex'.
+};
+
+} // namespace management {
+} // namespace jsl {
+
+#endif // __JSL_MANAGEMENT_HPP__
@@ -0,0 +1,93 @@
+#ifndef __JSL_PROFILER_HPP__
+#define __JSL_PROFILER_HPP__
+
+#include <stddef.h>
+
+#include <string>
+
+#include <stout/duration.hpp>
+#include <stout/nothing.hpp>
+#include <stout/try.hpp>
+
+namespace jsl {
+namespace profiler {
+
+// A sampling CPU profiler that sees both sides of the JNI boundary.
+// A profiling timer (ITIMER_PROF, i.e., per consumed CPU time)
+// interrupts whichever thread is running, which then records its
+// Java frames via the JVM's (unofficial) 'AsyncGetCallTrace' and its
+// native frames via 'backtrace' into a buffer of its own, without
+// taking any locks. The samples can be dumped in the "collapsed
+// stack" format consumed by flamegraph.pl, with Java frames suffixed
+// by "_[j]" (see its '--color=java').
+//
+// The profiler gets started automatically when the JVM is created or
+// injected with the system property 'jsl.profiler' set to the path
+// of a file, to which it dumps the samples at exit. E.g.:
+//
+//   std::vector<std::string> options;
+//   options.push_back("-Djsl.profiler=/tmp/profile.collapsed");
+//   Jvm::create(options);
+//
+// Note that native frames are unwound in the signal handler, which
+// can deadlock if a thread is interrupted while the dynamic loader
+// holds its lock (e.g., during 'dlopen'); disable 'native' if that
+// is a concern.
+
+struct Options
+{
+  Options()
+    : interval(Milliseconds(10)),
+      threads(32),
+      samples(1024),
+      depth(64),
+      native(true) {}
+
+  // CPU time between samples (of the process, not of each thread).
+  Duration interval;
+
+  // Maximum number of threads that get sampled, each gets its own
+  // buffer (of 'samples' samples of up to 'depth' frames) when first
+  // interrupted. Samples of other threads, or of threads whose buffer
+  // is full, are dropped. The buffers are allocated up front.
+  size_t threads;
+  size_t samples;
+  size_t depth;
+
+  // Whether to record native frames as well as Java frames.
+  bool native;
+};
+
+
+struct Statistics
+{
+  long samples; // Recorded.
+  long dropped; // Because there was no space for them.
+  long failed; // Java frames could not be walked (e.g., during GC).
+};
+
+
+// Starts sampling, discarding any previous samples. Requires a JVM
+// (which must export 'AsyncGetCallTrace', as HotSpot does).
+Try<Nothing> start(const Options& options = Options());
+
+// Stops sampling, the samples are kept until the next 'start'.
+Try<Nothing> stop();
+
+bool running();
+
+Statistics statistics();
+
+// Returns the samples recorded so far in collapsed stack format: one
+// line per distinct stack consisting of its frames, root first and
+// separated by ';', followed by a space and the number of samples.
+std::string collapsed();
+
+// Starts the profiler if the 'jsl.profiler' system property is set,
+// see above. Invoked by Jvm::create and Jvm::inject.
+void initialize();
+
+} // namespace profiler {
+} // namespace jsl {
+
+#endif // __JSL_PROFILER_HPP__
@@ -0,0 +1,91 @@
+#ifndef __JSL_REFERENCES_HPP__
+#define __JSL_REFERENCES_HPP__
+
+#include <jni.h>
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+namespace jsl {
+namespace references {
+
+// Tracks the global references created via Jvm::newGlobalRef (i.e.,
+// by every java::lang::Object), as well as weak global references
+// (i.e., java::lang::Weak), along with where they were created, to
+// find the wrappers that leak them. When not tracking the only
+// cost is testing a flag per created or deleted reference. When
+// tracking, each created reference costs a 'backtrace' of 'depth'
+// frames and a lock, so it's cheap enough for production use at
+// moderate rates of object creation.
+//
+// Tracking gets started automatically when the JVM is created or
+// injected with the system property 'jsl.references' set to the path
+// of a file, to which a report of the references still alive is
+// written at exit (i.e., before the JVM gets torn down). E.g.:
+//
+//   std::vector<std::string> options;
+//   options.push_back("-Djsl.references=/tmp/references.txt");
+//   Jvm::create(options);
+//
+// Sites are named after the (demangled) functions that created the
+// references, which requires symbols to be exported (e.g., link
+// executables with '-rdynamic'), otherwise they are named by library
+// and offset (see 'addr2line').
+
+// A distinct call stack that created global references.
+struct Site
+{
+  // The function that created the references, i.e., the innermost
+  // frame outside of Jvm and java::lang::Object (typically a
+  // constructor or method of a wrapper), followed by its callers.
+  std::string name;
+  std::vector<std::string> callers;
+
+  long live; // Created but not yet deleted.
+  long created; // Since tracking was started.
+};
+
+
+// Starts tracking references created from now on, recording up to
+// 'depth' frames of each. References that were created before are
+// not accounted for (even if deleted while tracking).
+void start(size_t depth = 8);
+
+// Stops tracking and discards everything tracked so far.
+void stop();
+
+long live();
+
+// Returns the sites that created references (merging those with the
+// same names), most live references first.
+std::vector<Site> sites();
+
+// Returns a human readable report of the sites with live references.
+std::string report();
+
+// Starts tracking if the 'jsl.references' system property is set, see
+// above. Invoked by Jvm::create and Jvm::inject.
+void initialize();
+
+
+namespace internal {
+
+// Hooks for Jvm::newGlobalRef and Jvm::deleteGlobalRef.
+extern volatile bool tracking;
+
+void created(jobject reference);
+void deleted(jobject reference);
+
+} // namespace internal {
+
+
+inline bool tracking()
+{
+  return internal::tracking;
+}
+
+} // namespace references {
+} // namespace jsl {
+
+#endif // __JSL_REFERENCES_HPP__
@@ -0,0 +1,142 @@
+#ifndef __JSL_RINGBUFFER_HPP__
+#define __JSL_RINGBUFFER_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <glog/logging.h>
+
+namespace jsl {
+
+// A bounded, lock-free, multi-producer/multi-consumer queue (based on
+// Dmitry Vyukov's "bounded MPMC queue"). Each slot carries a sequence
+// number which tells producers and consumers whether it is free or
+// full for their current position, so the only contention is a
+// compare-and-swap on the respective position. Neither 'put' nor
+// 'take' ever block: 'put' fails when the queue is full and 'take'
+// fails when the queue is empty. Values are copied in and out of
+// preallocated slots (so e.g. strings reuse their capacity). We rely
+// on the gcc atomic builtins (see configure.ac).
+template <typename T>
+class RingBuffer
+{
+public:
+  // The capacity must be a power of two.
+  explicit RingBuffer(size_t _capacity)
+    : capacity(_capacity),
+      mask(_capacity - 1),
+      slots(new Slot[_capacity]),
+      head(0),
+      tail(0)
+  {
+    CHECK(capacity >= 2 && (capacity & mask) == 0)
+      << "RingBuffer capacity must be a power of two";
+
+    for (size_t i = 0; i < capacity; i++) {
+      slots[i].sequence = i;
+    }
+  }
+
+  ~RingBuffer()
+  {
+    delete[] slots;
+  }
+
+  // Returns false if the queue is full.
+  bool put(const T& t)
+  {
+    Slot* slot = NULL;
+    size_t position = tail;
+
+    while (true) {
+      slot = &slots[position & mask];
+      size_t sequence = slot->sequence;
+      __sync_synchronize(); // Acquire.
+
+      intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+
+      if (difference == 0) {
+        if (__sync_bool_compare_and_swap(&tail, position, position + 1)) {
+          break;
+        }
+      } else if (difference < 0) {
+        return false; // Full.
+      }
+
+      position = tail;
+    }
+
+    slot->value = t;
+    __sync_synchronize(); // Release.
+    slot->sequence = position + 1;
+
+    return true;
+  }
+
+  // Returns false if the queue is empty.
+  bool take(T* t)
+  {
+    Slot* slot = NULL;
+    size_t position = head;
+
+    while (true) {
+      slot = &slots[position & mask];
+      size_t sequence = slot->sequence;
+      __sync_synchronize(); // Acquire.
+
+      intptr_t difference =
+        (intptr_t) sequence - (intptr_t) (position + 1);
+
+      if (difference == 0) {
+        if (__sync_bool_compare_and_swap(&head, position, position + 1)) {
+          break;
+        }
+      } else if (difference < 0) {
+        return false; // Empty.
+      }
+
+      position = head;
+    }
+
+    *t = slot->value;
+    __sync_synchronize(); // Release.
+    slot->sequence = position + capacity;
+
+    return true;
+  }
+
+  // Returns an approximation of the number of values in the queue.
+  size_t size() const
+  {
+    size_t h = head;
+    size_t t = tail;
+    return t >= h ? t - h : 0;
+  }
+
+private:
+  // Not copyable, not assignable.
+  RingBuffer(const RingBuffer&);
+  RingBuffer& operator = (const RingBuffer&);
+
+  struct Slot
+  {
+    volatile size_t sequence;
+    T value;
+  };
+
+  const size_t capacity;
+  const size_t mask;
+  Slot* slots;
+
+  // Keep the consumer and producer positions on separate cache lines
+  // to avoid false sharing between consumers and producers.
+  char pad0[64];
+  volatile size_t head; // Next position to take from.
+  char pad1[64];
+  volatile size_t tail; // Next position to put into.
+  char pad2[64];
+};
+
+} // namespace jsl {
+
+#endif // __JSL_RINGBUFFER_HPP__
@@ -0,0 +1,508 @@
+#ifndef __JSL_ZOOKEEPER_HPP__
+#define __JSL_ZOOKEEPER_HPP__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stout/duration.hpp>
+#include <stout/hashset.hpp>
+#include <stout/json.hpp>
+#include <stout/lambda.hpp>
+#include <stout/none.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/try.hpp>
+
+#include <jsl/lang.hpp>
+
+#include <org/apache/zookeeper.hpp>
+
+namespace jsl {
+namespace zookeeper {
+
+// An in-process ZooKeeper ensemble for tests. Each peer is a
+// QuorumPeer running inside the (single) embedded JVM and listening
+// on loopback ports, with its snapshots and transaction logs in a
+// directory that defaults to tmpfs (/dev/shm) when available. Peers
+// can be killed and restarted individually. Requires the ZooKeeper
+// jar on the classpath of the JVM.
+class Quorum
+{
+public:
+  // Creates (but does not start) a quorum of 'size' peers with ids
+  // 1..size. The data directories are created below 'directory' (or
+  // below /dev/shm, falling back to /tmp) and removed on destruction.
+  explicit Quorum(
+      int size,
+      const Option<std::string>& directory = None(),
+      const Duration& tickTime = Milliseconds(100));
+
+  ~Quorum();
+
+  // Starts all peers and waits for a leader to be elected and all
+  // other peers to follow it. Returns how long that took.
+  Try<Duration> start(const Duration& timeout = Seconds(30));
+
+  // Shuts down the peer with the given id and waits for its thread
+  // to exit. Its data directory is kept so that it can be restarted.
+  Try<Nothing> kill(int id);
+
+  // Restarts a killed peer and waits for it to rejoin the quorum.
+  // Returns how long that took.
+  Try<Duration> restart(int id, const Duration& timeout = Seconds(30));
+
+  // Returns the id of the current leader, if any.
+  Option<int> leader();
+
+  // Returns the client ports of all running peers, suitable for
+  // constructing a ZooKeeper client (e.g., "127.0.0.1:2181,...").
+  std::string connectString() const;
+
+  // Returns the client port of the given peer.
+  int clientPort(int id) const;
+
+  int size() const { return peers.size(); }
+
+private:
+  // Not copyable, not assignable.
+  Quorum(const Quorum&);
+  Quorum& operator = (const Quorum&);
+
+  struct Peer
+  {
+    int id;
+    int clientPort;
+    int quorumPort;
+    int electionPort;
+    std::string directory;
+    org::apache::zookeeper::server::quorum::QuorumPeer* peer; // NULL if dead.
+  };
+
+  // Creates and starts the QuorumPeer for the peer.
+  void launch(Peer* peer);
+
+  // Waits until every running peer is leading or following.
+  Try<Nothing> await(const Duration& timeout);
+
+  Peer* find(int id);
+
+  std::string directory; // Parent of the data directories.
+  Duration tickTime;
+  std::vector<Peer> peers;
+};
+
+
+// An embedded, standalone ZooKeeper server listening on a loopback
+// port (picked when started), with its snapshots and transaction logs
+// in a directory that is removed on destruction. Requires the
+// ZooKeeper jar on the classpath of the JVM.
+class Server
+{
+public:
+  struct Options
+  {
+    // Defaults to ZooKeeper's own configuration.
+    Options();
+
+    // A profile for tests and development: data on tmpfs, no fsyncs,
+    // small log preallocations and no connection limit.
+    static Options ephemeral();
+
+    // Session timeouts are bounded by 2 and 20 ticks.
+    Duration tickTime;
+
+    // Maximum number of connections per client host (zero means
+    // unlimited).
+    int maxClientCnxns;
+
+    // The following are JVM-wide settings, i.e., they apply to all
+    // servers in the JVM once a server with these options starts.
+
+    // Size (in bytes) by which transaction logs grow. Each growth is
+    // zero-filled up front.
+    int64_t preAllocSize;
+
+    // Number of transactions between snapshots.
+    int snapCount;
+
+    // Whether to fsync each commit. Note that ZooKeeper reads this
+    // only once (when the first transaction log gets created), so the
+    // first server started in the JVM decides for all others.
+    bool forceSync;
+
+    // Whether to create the data directory on tmpfs (/dev/shm) rather
+    // than /tmp, unless a 'directory' is given.
+    bool tmpfs;
+
+    // Parent of the data directory.
+    Option<std::string> directory;
+  };
+
+  explicit Server(const Options& options = Options());
+
+  ~Server();
+
+  // Starts the server, returns how long that took.
+  Try<Duration> start();
+
+  // Shuts the server down gracefully (the data directory is kept):
+  // closes all sessions, stops the server (closing connections and
+  // joining the server's threads), closes the transaction log and
+  // snapshot files, and finally waits for the number of threads and
+  // file descriptors of the process to drop back to what they were
+  // before the server started. Returns an error if any of that did
+  // not happen within the timeout; the server is stopped either way.
+  // Note that the accounting is process-wide, so concurrent activity
+  // elsewhere in the process (e.g., another server) can cause errors.
+  Try<Nothing> shutdown(const Duration& timeout = Seconds(10));
+
+  bool running() const { return server != NULL; }
+
+  // Returns the client port of the running server.
+  int port() const;
+
+  // Returns the address of the server suitable for constructing a
+  // ZooKeeper client (i.e., "127.0.0.1:port").
+  std::string connectString() const;
+
+  // Returns the underlying server (e.g., for a Sampler).
+  org::apache::zookeeper::server::ZooKeeperServer zooKeeperServer() const;
+
+private:
+  // Not copyable, not assignable.
+  Server(const Server&);
+  Server& operator = (const Server&);
+
+  // Closes all sessions (so that, e.g., ephemeral nodes are removed
+  // rather than expiring after a restart) and waits for them to be
+  // gone, at most until the deadline.
+  Try<Nothing> closeSessions(const Duration& timeout);
+
+  const Options options;
+  std::string directory;
+
+  org::apache::zookeeper::server::ZooKeeperServer* server; // NULL if stopped.
+  org::apache::zookeeper::server::NIOServerCnxn::Factory* factory;
+  org::apache::zookeeper::persistence::FileTxnSnapLog* txnLogFactory;
+  int _port;
+
+  // Resource usage of the process before the server started.
+  long threads;
+  size_t fds;
+};
+
+
+// Point-in-time statistics of a ZooKeeperServer.
+struct Statistics
+{
+  double timestamp; // Seconds since the epoch, see jsl::management::now.
+
+  // Request latencies (in milliseconds) since the last reset.
+  long minLatency;
+  long avgLatency;
+  long maxLatency;
+
+  long outstandingRequests;
+  long packetsSent;
+  long packetsReceived;
+
+  // Throughput since the previous sample (zero for the first one).
+  double packetsSentPerSecond;
+  double packetsReceivedPerSecond;
+
+  // Sizes of the in-memory data tree.
+  int nodeCount;
+  long approximateDataSize; // In bytes.
+  int watchCount;
+};
+
+
+// Returns the statistics as a JSON object (keyed by field name).
+JSON::Object json(const Statistics& statistics);
+
+
+// Samples the statistics of a server every 'interval' on a dedicated
+// thread (which stays attached to the JVM), keeping the most recent
+// 'capacity' samples. Each sample costs a handful of JNI calls, plus
+// a walk of the data tree for its approximate size if 'dataSize' is
+// true (the walk is O(nodes), so disable it for large trees).
+class Sampler
+{
+public:
+  Sampler(const org::apache::zookeeper::server::ZooKeeperServer& server,
+          const Duration& interval = Seconds(1),
+          size_t capacity = 60,
+          bool dataSize = true);
+
+  ~Sampler();
+
+  // Returns the most recent sample, if any.
+  Option<Statistics> latest();
+
+  // Returns the retained samples, oldest first.
+  JSON::Array history();
+
+private:
+  // Not copyable, not assignable.
+  Sampler(const Sampler&);
+  Sampler& operator = (const Sampler&);
+
+  static void* run(void* that);
+
+  Statistics sample(const Option<Statistics>& previous);
+
+  org::apache::zookeeper::server::ZooKeeperServer server;
+  org::apache::zookeeper::server::ServerStats stats;
+  const Duration interval;
+  const size_t capacity;
+  const bool dataSize;
+
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  bool running; // Protected by 'mutex'.
+  std::deque<Statistics> samples; // Protected by 'mutex'.
+};
+
+
+// Delivers the events of a ZooKeeper session (and of the watches set
+// through it) to a queue consumed from C++, instead of polling. When
+// the consumer falls behind, an event is dropped if an event of the
+// same type for the same path is still queued: watches only say that
+// something changed, so one notification is as good as many. Session
+// events (which have no path) are never coalesced. The watcher must
+// outlive any clients using it. Usage:
+//
+//   jsl::zookeeper::Watcher watcher;
+//   jsl::zookeeper::Client client(servers, Seconds(10), &watcher);
+//   client.exists("/node", callback, true);
+//   Option<jsl::zookeeper::Watcher::Event> event =
+//     watcher.next(Seconds(1));
+class Watcher : public jsl::lang::NativeInvocationHandler
+{
+public:
+  struct Event
+  {
+    // See org::apache::zookeeper::Watcher::Event::{EventType,KeeperState}.
+    int type;
+    int state;
+    std::string path; // Empty for session events.
+  };
+
+  Watcher();
+  virtual ~Watcher();
+
+  // Returns the next event, waiting at most 'timeout' for one.
+  Option<Event> next(const Duration& timeout);
+
+  // Returns the number of queued events.
+  size_t size();
+
+  // Returns the number of events dropped by coalescing so far.
+  long coalesced() const { return _coalesced; }
+
+  // Returns the 'org.apache.zookeeper.Watcher' for this watcher.
+  org::apache::zookeeper::Watcher watcher() const { return _watcher; }
+
+  virtual jobject invoke(JNIEnv* env, int method, jobjectArray args);
+
+private:
+  // Not copyable, not assignable.
+  Watcher(const Watcher&);
+  Watcher& operator = (const Watcher&);
+
+  const org::apache::zookeeper::Watcher _watcher;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t cond; // Signaled when an event gets queued.
+  std::deque<Event> events; // Protected by 'mutex'.
+  hashset<std::pair<int, std::string> > queued; // Protected by 'mutex'.
+  volatile long _coalesced;
+};
+
+
+// An asynchronous ZooKeeper client (wrapping the Java client) whose
+// operations return immediately and complete via callbacks, so that
+// many operations can be outstanding (pipelined) per session rather
+// than paying for a round trip per operation. The Java callbacks are
+// implemented natively by a single proxy. Since ZooKeeper completes
+// the operations of a session in the order they were issued, we match
+// each completion with the oldest outstanding operation rather than
+// allocating a Java context object per operation.
+class Client
+{
+public:
+  struct Stat
+  {
+    int64_t mzxid;
+    int version;
+    int dataLength;
+    int numChildren;
+    int64_t ephemeralOwner; // Zero unless ephemeral.
+  };
+
+  struct Result
+  {
+    int rc; // See 'KeeperException.Code' (zero is OK).
+    std::string path; // As passed to the operation.
+    std::string name; // For 'create', the path actually created.
+    std::string data; // For 'getData'.
+    Option<Stat> stat; // For 'getData', 'setData' and 'exists'.
+    std::vector<std::string> children; // For 'getChildren'.
+  };
+
+  // Callbacks are invoked on the client's (Java) event thread, one at
+  // a time. They should not block but may issue further operations
+  // (they must not destroy the client though).
+  typedef lambda::function<void(const Result&)> Callback;
+
+  // Session events (and those of any watches set) are delivered to
+  // 'watcher' if not NULL and otherwise ignored.
+  Client(const std::string& servers,
+         const Duration& sessionTimeout,
+         Watcher* watcher = NULL);
+
+  // Waits (at most the session timeout) for outstanding operations to
+  // complete before closing the session, and then (again at most the
+  // session timeout) for those failed by closing it. Callbacks of any
+  // operations still outstanding after that are never invoked.
+  ~Client();
+
+  void create(
+      const std::string& path,
+      const std::string& data,
+      const org::apache::zookeeper::CreateMode& mode,
+      const Callback& callback);
+
+  // Operations that take 'watch' leave a watch on the node if true,
+  // which requires a watcher.
+  void getData(
+      const std::string& path,
+      const Callback& callback,
+      bool watch = false);
+
+  // A 'version' of -1 matches any version.
+  void setData(
+      const std::string& path,
+      const std::string& data,
+      int version,
+      const Callback& callback);
+
+  void exists(
+      const std::string& path,
+      const Callback& callback,
+      bool watch = false);
+
+  void getChildren(
+      const std::string& path,
+      const Callback& callback,
+      bool watch = false);
+
+  // Returns the number of operations that have not completed yet.
+  size_t outstanding();
+
+  // Waits until all outstanding operations have completed. Returns
+  // false if that did not happen within the timeout.
+  bool await(const Duration& timeout);
+
+  int64_t getSessionId() { return zk.getSessionId(); }
+
+private:
+  // Not copyable, not assignable.
+  Client(const Client&);
+  Client& operator = (const Client&);
+
+  enum Operation
+  {
+    CREATE,
+    GET_DATA,
+    SET_DATA,
+    EXISTS,
+    GET_CHILDREN
+  };
+
+  struct Pending
+  {
+    Operation operation;
+    std::string path;
+    Callback callback;
+  };
+
+  // Forwards invocations of the proxy to the client until the client
+  // gets destroyed. The Java client might still invoke the proxy after
+  // that (e.g., with a late completion or session event) and a handler
+  // must outlive its proxies, so the client deliberately leaks it.
+  class Handler : public jsl::lang::NativeInvocationHandler
+  {
+  public:
+    explicit Handler(Client* client);
+
+    using jsl::lang::NativeInvocationHandler::proxy;
+
+    // Stops forwarding, waiting for an ongoing invocation (if any).
+    void detach();
+
+    virtual jobject invoke(JNIEnv* env, int method, jobjectArray args);
+
+  private:
+    pthread_mutex_t mutex; // Held while forwarding.
+    Client* client; // NULL once detached.
+  };
+
+  friend class Handler;
+
+  jobject invoke(JNIEnv* env, int method, jobjectArray args);
+
+  // Converts the results of the completed operation and invokes its
+  // callback.
+  void complete(JNIEnv* env, const Pending& operation, jobjectArray args);
+
+  // Marks an operation taken off 'pending' as completed.
+  void completed();
+
+  // Enqueues the operation and locks 'mutex' so that operations are
+  // issued to the Java client in the same order, see 'issued'.
+  void issue(Operation operation,
+             const std::string& path,
+             const Callback& callback);
+
+  // Unlocks 'mutex' after issuing an operation, dropping it if the
+  // Java client failed to accept it.
+  void issued(bool success);
+
+  const Duration sessionTimeout;
+  Watcher* const watcher;
+
+  Handler* const handler; // Leaked, see above.
+
+  // The proxy implementing the callback interfaces (and Watcher),
+  // along with the typed references we pass to the Java client.
+  const java::lang::Object callbacks;
+  const org::apache::zookeeper::AsyncCallback::StringCallback stringCallback;
+  const org::apache::zookeeper::AsyncCallback::DataCallback dataCallback;
+  const org::apache::zookeeper::AsyncCallback::StatCallback statCallback;
+  const org::apache::zookeeper::AsyncCallback::ChildrenCallback
+    childrenCallback;
+
+  const java::lang::Object acl; // Always 'OPEN_ACL_UNSAFE'.
+
+  org::apache::zookeeper::ZooKeeper zk;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t cond; // Signaled when no operations are outstanding.
+  std::deque<Pending> pending; // Protected by 'mutex'.
+
+  // Number of operations taken off 'pending' whose callbacks haven't
+  // returned yet (protected by 'mutex').
+  size_t completing;
+};
+
+} // namespace zookeeper {
+} // namespace jsl {
+
+#endif // __JSL_ZOOKEEPER_HPP__
@@ -8,8 +8,9 @@
 
 #include <stout/try.hpp>
 
-// Forward declaration.
+// Forward declarations.
 namespace java { namespace lang { class Object; } }
+namespace java { namespace lang { template <typename T> class Weak; } }
 
 
 // Encapsulates JNI specific components, in particular the all
@@ -44,6 +45,21 @@ struct JNI
     JNIEnv* env;
     bool detach; // A nested use of Env should not detach the thread.
   };
+
+  // Local references are only freed when a native method returns to
+  // Java or the thread detaches, so a thread that stays attached
+  // (e.g., one sampling periodically) needs to free them itself. We
+  // use the following RAII class to push a frame for local references
+  // and pop it, deleting all local references created in it.
+  class Frame
+  {
+  public:
+    explicit Frame(int capacity = 16);
+    ~Frame();
+
+  private:
+    Env env;
+  };
 };
 
 
@@ -63,7 +79,7 @@ public:
   // injected with a different JavaVM than what was passed. If
   // 'exceptions' is false than any exceptions that occur will abort
   // the current process.
-  Try<Jvm*> inject(
+  static Try<Jvm*> inject(
       JavaVM* jvm,
       JNI::Version version,
       bool exceptions = false);
@@ -92,6 +108,10 @@ public:
   // and a default version if necessary.
   static Jvm* get();
 
+  // Returns the underlying JavaVM, e.g., for getting a JVMTI
+  // environment.
+  JavaVM* vm() const { return jvm; }
+
   // An opaque class descriptor that can be used to find constructors,
   // methods and fields.
   class Class
@@ -187,6 +207,13 @@ public:
     // Adds a parameter to the method parameter list.
     MethodFinder& parameter(const Class& type);
 
+    // Specifies that the method can be invoked without virtual
+    // dispatch, i.e., it's final or private or its class is final (a
+    // subclass' override would otherwise be bypassed). Jvm::invoke
+    // then uses CallNonvirtual*Method with the class, which is looked
+    // up once and kept (as a global reference) by the Method.
+    MethodFinder& nonvirtual();
+
     // Terminates description of a method by specifying its return type.
     MethodSignature returns(const Class& type) const;
 
@@ -198,6 +225,7 @@ public:
     const Class clazz;
     const std::string name;
     std::vector<Class> parameters;
+    bool isNonvirtual;
   };
 
 
@@ -214,12 +242,14 @@ public:
     MethodSignature(const Class& clazz,
                     const std::string& name,
                     const Class& returnType,
-                    const std::vector<Class>& parameters);
+                    const std::vector<Class>& parameters,
+                    bool isNonvirtual);
 
     const Class clazz;
     const std::string name;
     const Class returnType;
     std::vector<Class> parameters;
+    const bool isNonvirtual;
   };
 
 
@@ -234,10 +264,16 @@ public:
     friend class Jvm;
     friend class MethodSignature;
 
-    Method(const Class& clazz, const jmethodID id);
+    Method(const Class& clazz,
+           const jmethodID id,
+           const jclass nonvirtual = NULL);
 
     const Class clazz;
     const jmethodID id;
+
+    // The class (as a global reference) if the method gets invoked
+    // without virtual dispatch, see MethodFinder::nonvirtual.
+    const jclass nonvirtual;
   };
 
 
@@ -287,7 +323,7 @@ public:
       // too early.
       static Field field = Jvm::get()->findStaticField(clazz, name);
       T t;
-      t.object = Jvm::get()->getStaticField<jobject>(field);
+      t.reset(Jvm::get()->getStaticField<jobject>(field));
       return t;
     }
 
@@ -297,11 +333,40 @@ public:
 
   jstring string(const std::string& s);
 
+  // Returns the contents of a Java string (in modified UTF-8).
+  std::string string(jstring s);
+
+  // Converts between a vector of strings and a Java 'String[]'. Each
+  // conversion is done in bulk, i.e., with a single JNI environment
+  // and without any intermediate global references.
+  jobjectArray strings(const std::vector<std::string>& strings);
+  std::vector<std::string> strings(jobjectArray array);
+
+  // Returns the contents of a Java 'long[]' via a single region copy.
+  std::vector<long> longs(jlongArray array);
+
+  // Converts between (binary) strings and Java 'byte[]', each via a
+  // single region copy. A null array converts to an empty string.
+  jbyteArray bytes(const std::string& bytes);
+  std::string bytes(jbyteArray array);
+
+  // Converts a Java array of objects into a vector of T (which must
+  // extend java::lang::Object and be constructible from a jobject).
+  template <typename T>
+  std::vector<T> objects(jobjectArray array);
+
   Constructor findConstructor(const ConstructorFinder& finder);
   Method findMethod(const MethodSignature& signature);
   Method findStaticMethod(const MethodSignature& signature);
   Field findStaticField(const Class& clazz, const std::string& name);
 
+  // Finds a static field whose type differs from the class declaring
+  // it (the above assumes they are the same, e.g., for enums).
+  Field findStaticField(
+      const Class& clazz,
+      const std::string& name,
+      const Class& type);
+
   // TODO(John Sirois): Add "type checking" to variadic method
   // calls. Possibly a way to do this with typelists, type
   // concatenation and unwinding builder inheritance.
@@ -311,6 +376,12 @@ public:
   template <typename T>
   T invoke(const jobject receiver, const Method& method, ...);
 
+  // Invokes the implementation of the method in the class it was
+  // found in regardless of the class of the receiver (e.g., for
+  // invoking an overridden method of a superclass).
+  template <typename T>
+  T invokeNonvirtual(const jobject receiver, const Method& method, ...);
+
   template <typename T>
   T invokeStatic(const Method& method, ...);
 
@@ -323,6 +394,8 @@ public:
 private:
   friend class JNI::Env; // For attaching and detatching.
   friend class java::lang::Object; // For managing global references.
+  template <typename T>
+  friend class java::lang::Weak; // For managing weak global references.
   friend void deleter(); // For deleting the instance 'atexit'.
 
   Jvm(JavaVM* jvm, JNI::Version version, bool exceptions);
@@ -331,6 +404,12 @@ private:
 private:
   jobject newGlobalRef(const jobject object);
   void deleteGlobalRef(const jobject object);
+  jobject newLocalRef(const jobject object);
+  void deleteLocalRef(const jobject object);
+
+  jweak newWeakGlobalRef(const jobject object);
+  void deleteWeakGlobalRef(const jweak object);
+  bool collected(const jweak object);
 
   jclass findClass(const Class& clazz);
 
@@ -346,6 +425,13 @@ private:
   template <typename T>
   T invokeStaticV(const Class& receiver, const jmethodID id, va_list args);
 
+  template <typename T>
+  T invokeNonvirtualV(
+      const jobject receiver,
+      const jclass clazz,
+      const jmethodID id,
+      va_list args);
+
   // Singleton instance.
   static Jvm* instance;
 
@@ -364,8 +450,49 @@ T Jvm::invoke(const jobject receiver, const Method& method, ...)
 {
   va_list args;
   va_start(args, method);
-  const T result = invokeV<T>(receiver, method.id, args);
+  const T result = method.nonvirtual != NULL
+    ? invokeNonvirtualV<T>(receiver, method.nonvirtual, method.id, args)
+    : invokeV<T>(receiver, method.id, args);
+  va_end(args);
+  return result;
+}
+
+
+template <>
+void Jvm::invokeNonvirtual<void>(
+    const jobject receiver,
+    const Method& method,
+    ...);
+
+
+template <typename T>
+T Jvm::invokeNonvirtual(const jobject receiver, const Method& method, ...)
+{
+  const jclass clazz = method.nonvirtual != NULL
+    ? method.nonvirtual
+    : findClass(method.clazz);
+
+  va_list args;
+  va_start(args, method);
+
+  T result;
+  try {
+    result = invokeNonvirtualV<T>(receiver, clazz, method.id, args);
+  } catch (...) {
+    // Clean up even if the invocation threw (see Jvm::check).
+    va_end(args);
+    if (clazz != method.nonvirtual) {
+      deleteLocalRef(clazz);
+    }
+    throw;
+  }
+
   va_end(args);
+
+  if (clazz != method.nonvirtual) {
+    deleteLocalRef(clazz);
+  }
+
   return result;
 }
 
@@ -384,4 +511,30 @@ T Jvm::invokeStatic(const Method& method, ...)
   return result;
 }
 
+
+template <typename T>
+std::vector<T> Jvm::objects(jobjectArray array)
+{
+  JNI::Env env;
+
+  std::vector<T> result;
+
+  if (array == NULL) {
+    return result;
+  }
+
+  const jsize length = env->GetArrayLength(array);
+  result.reserve(length);
+
+  for (jsize i = 0; i < length; i++) {
+    jobject element = env->GetObjectArrayElement(array, i);
+    result.push_back(T(element));
+    env->DeleteLocalRef(element); // T holds its own global reference.
+  }
+
+  check(env);
+
+  return result;
+}
+
 #endif // __JVM_HPP__
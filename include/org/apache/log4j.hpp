@@ -1,6 +1,10 @@
 #ifndef __ORG_APACHE_LOG4J_HPP__
 #define __ORG_APACHE_LOG4J_HPP__
 
+#include <stdint.h>
+
+#include <string>
+
 #include <jvm.hpp>
 
 #include <java/lang.hpp>
@@ -9,24 +13,116 @@ namespace org {
 namespace apache {
 namespace log4j {
 
-// Forward declaration.
+// Forward declarations.
 extern const char LEVEL_OFF[];
+extern const char LEVEL_FATAL[];
+extern const char LEVEL_ERROR[];
+extern const char LEVEL_WARN[];
+extern const char LEVEL_INFO[];
+extern const char LEVEL_DEBUG[];
+extern const char LEVEL_TRACE[];
+extern const char LEVEL_ALL[];
 
 
 class Level : public java::lang::Object // TODO(benh): Extends Priority.
 {
 public:
   friend class Jvm::StaticVariable<Level, LEVEL_OFF>;
+  friend class Jvm::StaticVariable<Level, LEVEL_FATAL>;
+  friend class Jvm::StaticVariable<Level, LEVEL_ERROR>;
+  friend class Jvm::StaticVariable<Level, LEVEL_WARN>;
+  friend class Jvm::StaticVariable<Level, LEVEL_INFO>;
+  friend class Jvm::StaticVariable<Level, LEVEL_DEBUG>;
+  friend class Jvm::StaticVariable<Level, LEVEL_TRACE>;
+  friend class Jvm::StaticVariable<Level, LEVEL_ALL>;
 
   static Jvm::StaticVariable<Level, LEVEL_OFF> OFF;
+  static Jvm::StaticVariable<Level, LEVEL_FATAL> FATAL;
+  static Jvm::StaticVariable<Level, LEVEL_ERROR> ERROR;
+  static Jvm::StaticVariable<Level, LEVEL_WARN> WARN;
+  static Jvm::StaticVariable<Level, LEVEL_INFO> INFO;
+  static Jvm::StaticVariable<Level, LEVEL_DEBUG> DEBUG;
+  static Jvm::StaticVariable<Level, LEVEL_TRACE> TRACE;
+  static Jvm::StaticVariable<Level, LEVEL_ALL> ALL;
+
+  // The integer values of the levels above (see 'Priority.toInt()'),
+  // which can be compared without calling into the JVM.
+  enum
+  {
+    OFF_INT = 2147483647,
+    FATAL_INT = 50000,
+    ERROR_INT = 40000,
+    WARN_INT = 30000,
+    INFO_INT = 20000,
+    DEBUG_INT = 10000,
+    TRACE_INT = 5000,
+    ALL_INT = -2147483647 - 1
+  };
+
+  int toInt() const
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/log4j/Priority")
+        .method("toInt")
+        .returns(Jvm::Class::INT));
+
+    return Jvm::get()->invoke<int>(object, method);
+  }
 
   Level() {} // No default constuctors.
+
+  explicit Level(jobject level) : java::lang::Object(level) {}
+};
+
+
+class Appender : public java::lang::Object // Interface.
+{
+public:
+  // Wraps an existing implementation of 'org.apache.log4j.Appender'
+  // (e.g., a proxy created by a jsl::lang::NativeInvocationHandler).
+  explicit Appender(jobject appender) : java::lang::Object(appender) {}
+
+protected:
+  Appender() {} // Interface, necessary for subclasses.
 };
 
 
 class Category : public java::lang::Object
 {
 public:
+  void addAppender(const Appender& appender)
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/log4j/Category")
+        .method("addAppender")
+        .parameter(Jvm::Class::named("org/apache/log4j/Appender"))
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invoke<void>(object, method, (jobject) appender);
+  }
+
+  void removeAppender(const Appender& appender)
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/log4j/Category")
+        .method("removeAppender")
+        .parameter(Jvm::Class::named("org/apache/log4j/Appender"))
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invoke<void>(object, method, (jobject) appender);
+  }
+
+  void setAdditivity(bool additive)
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/log4j/Category")
+        .method("setAdditivity")
+        .parameter(Jvm::Class::BOOLEAN)
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invoke<void>(object, method, (jboolean) additive);
+  }
+
   void setLevel(const Level& level)
   {
     static Jvm::Method method = Jvm::get()->findMethod(
@@ -36,31 +132,104 @@ public:
         .returns(Jvm::Class::VOID));
 
     Jvm::get()->invoke<void>(object, method, (jobject) level);
+
+    levelsChanged();
+  }
+
+  Level getLevel() const
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/log4j/Category")
+        .method("getLevel")
+        .returns(Jvm::Class::named("org/apache/log4j/Level")));
+
+    return level(Jvm::get()->invoke<jobject>(object, method));
+  }
+
+  Level getEffectiveLevel() const
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/log4j/Category")
+        .method("getEffectiveLevel")
+        .returns(Jvm::Class::named("org/apache/log4j/Level")));
+
+    return level(Jvm::get()->invoke<jobject>(object, method));
   }
 
+  // Invalidates the snapshot of effective levels used by
+  // Logger::isEnabledFor. This is done automatically by 'setLevel'
+  // but must be called explicitly after changing levels from Java
+  // (e.g., after reconfiguring log4j).
+  static void levelsChanged();
+
 protected:
   Category() {} // No default constructors.
+
+  explicit Category(jobject category) : java::lang::Object(category) {}
+
+private:
+  // Wraps the level and deletes the local reference to it.
+  static Level level(jobject local)
+  {
+    Level level(local);
+    JNI::Env env;
+    env->DeleteLocalRef(local);
+    return level;
+  }
 };
 
 
 class Logger : public Category
 {
 public:
-  static Logger getRootLogger()
+  // Returns the root logger (from the cache, see 'getLogger').
+  static Logger getRootLogger();
+
+  // Returns the logger with the given name. Loggers are cached per
+  // name so only the first lookup of each name calls into the JVM.
+  static Logger getLogger(const std::string& name);
+
+  // Checks whether this logger is enabled for the level (one of the
+  // Level::*_INT values). This is answered from a snapshot of the
+  // effective level of this logger and only calls into the JVM when
+  // the snapshot has been invalidated (see Category::levelsChanged).
+  // Unlike log4j we ignore the threshold of the logger repository.
+  bool isEnabledFor(int level) const
   {
-    static Jvm::Method method = Jvm::get()->findStaticMethod(
-        Jvm::Class::named("org/apache/log4j/Logger")
-        .method("getRootLogger")
-        .returns(Jvm::Class::named("org/apache/log4j/Logger")));
-
-    Logger logger;
-    logger.object = Jvm::get()->invokeStatic<jobject>(method);
+    return level >= effectiveLevel();
+  }
 
-    return logger;
+  bool isEnabledFor(const Level& level) const
+  {
+    return isEnabledFor(level.toInt());
   }
 
+  bool isTraceEnabled() const { return isEnabledFor(Level::TRACE_INT); }
+  bool isDebugEnabled() const { return isEnabledFor(Level::DEBUG_INT); }
+  bool isInfoEnabled() const { return isEnabledFor(Level::INFO_INT); }
+
 protected:
-  Logger() {} // No default constructors.
+  Logger() : snapshot(NULL) {} // No default constructors.
+
+  explicit Logger(jobject logger) : Category(logger), snapshot(NULL) {}
+
+private:
+  // The last known effective level of a logger (low 32 bits) and the
+  // "generation" of levels it was computed in (high 32 bits, see
+  // Category::levelsChanged), packed so that they are read and written
+  // together.
+  struct Snapshot
+  {
+    volatile uint64_t state;
+  };
+
+  // Returns a new logger (with a fresh snapshot) for the object.
+  static Logger* create(jobject object);
+
+  // Returns the effective level, refreshing the snapshot if stale.
+  int effectiveLevel() const;
+
+  Snapshot* snapshot; // Shared by all copies of a cached logger.
 };
 
 
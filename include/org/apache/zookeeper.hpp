@@ -1,11 +1,481 @@
 #ifndef __ORG_APACHE_ZOOKEEPER_HPP__
 #define __ORG_APACHE_ZOOKEEPER_HPP__
 
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
 #include <jvm.hpp>
 
 #include <java/io.hpp>
 #include <java/lang.hpp>
 #include <java/net.hpp>
+#include <java/util.hpp>
+
+// Package 'org.apache.zookeeper.data'.
+
+namespace org {
+namespace apache {
+namespace zookeeper {
+namespace data {
+
+class Stat : public java::lang::Object
+{
+public:
+  explicit Stat(jobject stat) : java::lang::Object(stat) {}
+
+  int64_t getMzxid()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/data/Stat")
+        .method("getMzxid")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  int getVersion()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/data/Stat")
+        .method("getVersion")
+        .returns(Jvm::Class::INT));
+
+    return Jvm::get()->invoke<int>(object, method);
+  }
+
+  int getDataLength()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/data/Stat")
+        .method("getDataLength")
+        .returns(Jvm::Class::INT));
+
+    return Jvm::get()->invoke<int>(object, method);
+  }
+
+  int getNumChildren()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/data/Stat")
+        .method("getNumChildren")
+        .returns(Jvm::Class::INT));
+
+    return Jvm::get()->invoke<int>(object, method);
+  }
+
+  int64_t getEphemeralOwner()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/data/Stat")
+        .method("getEphemeralOwner")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+};
+
+} // namespace data {
+} // namespace zookeeper {
+} // namespace apache {
+} // namespace org {
+
+
+// Package 'org.apache.zookeeper'.
+
+namespace org {
+namespace apache {
+namespace zookeeper {
+
+// Forward declarations.
+extern const char CREATE_MODE_PERSISTENT[];
+extern const char CREATE_MODE_PERSISTENT_SEQUENTIAL[];
+extern const char CREATE_MODE_EPHEMERAL[];
+extern const char CREATE_MODE_EPHEMERAL_SEQUENTIAL[];
+
+
+class CreateMode : public java::lang::Object
+{
+public:
+  friend class Jvm::StaticVariable<CreateMode, CREATE_MODE_PERSISTENT>;
+  friend class Jvm::StaticVariable<
+    CreateMode, CREATE_MODE_PERSISTENT_SEQUENTIAL>;
+  friend class Jvm::StaticVariable<CreateMode, CREATE_MODE_EPHEMERAL>;
+  friend class Jvm::StaticVariable<
+    CreateMode, CREATE_MODE_EPHEMERAL_SEQUENTIAL>;
+
+  static Jvm::StaticVariable<CreateMode, CREATE_MODE_PERSISTENT>
+    PERSISTENT;
+  static Jvm::StaticVariable<CreateMode, CREATE_MODE_PERSISTENT_SEQUENTIAL>
+    PERSISTENT_SEQUENTIAL;
+  static Jvm::StaticVariable<CreateMode, CREATE_MODE_EPHEMERAL>
+    EPHEMERAL;
+  static Jvm::StaticVariable<CreateMode, CREATE_MODE_EPHEMERAL_SEQUENTIAL>
+    EPHEMERAL_SEQUENTIAL;
+
+private:
+  CreateMode() {} // No default constuctors.
+};
+
+
+class ZooDefs
+{
+public:
+  class Ids
+  {
+  public:
+    // Returns 'ZooDefs.Ids.OPEN_ACL_UNSAFE' (a 'List<ACL>').
+    static java::lang::Object OPEN_ACL_UNSAFE()
+    {
+      static Jvm::Field field = Jvm::get()->findStaticField(
+          Jvm::Class::named("org/apache/zookeeper/ZooDefs$Ids"),
+          "OPEN_ACL_UNSAFE",
+          Jvm::Class::named("java/util/ArrayList"));
+
+      return java::lang::Object(Jvm::get()->getStaticField<jobject>(field));
+    }
+  };
+};
+
+
+class Watcher : public java::lang::Object // Interface.
+{
+public:
+  class Event
+  {
+  public:
+    class EventType : public java::lang::Object
+    {
+    public:
+      // The integer values of the event types (see 'getIntValue').
+      enum
+      {
+        NONE = -1,
+        NODE_CREATED = 1,
+        NODE_DELETED = 2,
+        NODE_DATA_CHANGED = 3,
+        NODE_CHILDREN_CHANGED = 4
+      };
+
+      explicit EventType(jobject type) : java::lang::Object(type) {}
+
+      int getIntValue()
+      {
+        static Jvm::Method method = Jvm::get()->findMethod(
+            Jvm::Class::named(
+                "org/apache/zookeeper/Watcher$Event$EventType")
+            .method("getIntValue")
+            .nonvirtual() // Enums are final.
+            .returns(Jvm::Class::INT));
+
+        return Jvm::get()->invoke<int>(object, method);
+      }
+    };
+
+    class KeeperState : public java::lang::Object
+    {
+    public:
+      // The integer values of the (non-deprecated) states.
+      enum
+      {
+        DISCONNECTED = 0,
+        SYNC_CONNECTED = 3,
+        EXPIRED = -112
+      };
+
+      explicit KeeperState(jobject state) : java::lang::Object(state) {}
+
+      int getIntValue()
+      {
+        static Jvm::Method method = Jvm::get()->findMethod(
+            Jvm::Class::named(
+                "org/apache/zookeeper/Watcher$Event$KeeperState")
+            .method("getIntValue")
+            .nonvirtual() // Enums are final.
+            .returns(Jvm::Class::INT));
+
+        return Jvm::get()->invoke<int>(object, method);
+      }
+    };
+
+  private:
+    Event() {} // Namespace only.
+  };
+
+  // Wraps an existing implementation of 'org.apache.zookeeper.Watcher'
+  // (e.g., a proxy created by a jsl::lang::NativeInvocationHandler).
+  explicit Watcher(jobject watcher) : java::lang::Object(watcher) {}
+
+protected:
+  Watcher() {} // Interface, necessary for subclasses.
+};
+
+
+class WatchedEvent : public java::lang::Object
+{
+public:
+  explicit WatchedEvent(jobject event) : java::lang::Object(event) {}
+
+  Watcher::Event::EventType getType()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/WatchedEvent")
+        .method("getType")
+        .returns(
+            Jvm::Class::named(
+                "org/apache/zookeeper/Watcher$Event$EventType")));
+
+    return Watcher::Event::EventType(
+        Jvm::get()->invoke<jobject>(object, method));
+  }
+
+  Watcher::Event::KeeperState getState()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/WatchedEvent")
+        .method("getState")
+        .returns(
+            Jvm::Class::named(
+                "org/apache/zookeeper/Watcher$Event$KeeperState")));
+
+    return Watcher::Event::KeeperState(
+        Jvm::get()->invoke<jobject>(object, method));
+  }
+
+  // Returns the empty string for session events (which have no path).
+  std::string getPath()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/WatchedEvent")
+        .method("getPath")
+        .returns(Jvm::Class::STRING));
+
+    return Jvm::get()->string(
+        static_cast<jstring>(Jvm::get()->invoke<jobject>(object, method)));
+  }
+};
+
+
+// The callback interfaces nested in 'org.apache.zookeeper.AsyncCallback'.
+// Like Watcher these wrap existing implementations (e.g., proxies).
+class AsyncCallback
+{
+public:
+  class StringCallback : public java::lang::Object
+  {
+  public:
+    explicit StringCallback(jobject cb) : java::lang::Object(cb) {}
+  };
+
+  class DataCallback : public java::lang::Object
+  {
+  public:
+    explicit DataCallback(jobject cb) : java::lang::Object(cb) {}
+  };
+
+  class StatCallback : public java::lang::Object
+  {
+  public:
+    explicit StatCallback(jobject cb) : java::lang::Object(cb) {}
+  };
+
+  class ChildrenCallback : public java::lang::Object
+  {
+  public:
+    explicit ChildrenCallback(jobject cb) : java::lang::Object(cb) {}
+  };
+
+private:
+  AsyncCallback() {} // Namespace only.
+};
+
+
+class ZooKeeper : public java::lang::Object
+{
+public:
+  // Note that this returns immediately, the session gets established
+  // in the background and operations are queued until then.
+  ZooKeeper(const std::string& connectString,
+            int sessionTimeout,
+            const Watcher& watcher)
+  {
+    static Jvm::Constructor constructor = Jvm::get()->findConstructor(
+        Jvm::Class::named("org/apache/zookeeper/ZooKeeper")
+        .constructor()
+        .parameter(Jvm::Class::STRING)
+        .parameter(Jvm::Class::INT)
+        .parameter(Jvm::Class::named("org/apache/zookeeper/Watcher")));
+
+    reset(Jvm::get()->invoke(
+        constructor,
+        Jvm::get()->string(connectString),
+        sessionTimeout,
+        (jobject) watcher));
+  }
+
+  int64_t getSessionId()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/ZooKeeper")
+        .method("getSessionId")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  void close()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/ZooKeeper")
+        .method("close")
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invoke<void>(object, method);
+  }
+
+  // Asynchronous operations. The callbacks get invoked on the
+  // client's event thread, in the order the operations were issued.
+
+  void create(const std::string& path,
+              const std::string& data,
+              const java::lang::Object& acl,
+              const CreateMode& createMode,
+              const AsyncCallback::StringCallback& cb,
+              const java::lang::Object& ctx)
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/ZooKeeper")
+        .method("create")
+        .parameter(Jvm::Class::STRING)
+        .parameter(Jvm::Class::BYTE.arrayOf())
+        .parameter(Jvm::Class::named("java/util/List"))
+        .parameter(Jvm::Class::named("org/apache/zookeeper/CreateMode"))
+        .parameter(
+            Jvm::Class::named(
+                "org/apache/zookeeper/AsyncCallback$StringCallback"))
+        .parameter(Jvm::Class::named("java/lang/Object"))
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invoke<void>(
+        object,
+        method,
+        Jvm::get()->string(path),
+        Jvm::get()->bytes(data),
+        (jobject) acl,
+        (jobject) createMode,
+        (jobject) cb,
+        (jobject) ctx);
+  }
+
+  void getData(const std::string& path,
+               bool watch,
+               const AsyncCallback::DataCallback& cb,
+               const java::lang::Object& ctx)
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/ZooKeeper")
+        .method("getData")
+        .parameter(Jvm::Class::STRING)
+        .parameter(Jvm::Class::BOOLEAN)
+        .parameter(
+            Jvm::Class::named(
+                "org/apache/zookeeper/AsyncCallback$DataCallback"))
+        .parameter(Jvm::Class::named("java/lang/Object"))
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invoke<void>(
+        object,
+        method,
+        Jvm::get()->string(path),
+        (jboolean) watch,
+        (jobject) cb,
+        (jobject) ctx);
+  }
+
+  void setData(const std::string& path,
+               const std::string& data,
+               int version,
+               const AsyncCallback::StatCallback& cb,
+               const java::lang::Object& ctx)
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/ZooKeeper")
+        .method("setData")
+        .parameter(Jvm::Class::STRING)
+        .parameter(Jvm::Class::BYTE.arrayOf())
+        .parameter(Jvm::Class::INT)
+        .parameter(
+            Jvm::Class::named(
+                "org/apache/zookeeper/AsyncCallback$StatCallback"))
+        .parameter(Jvm::Class::named("java/lang/Object"))
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invoke<void>(
+        object,
+        method,
+        Jvm::get()->string(path),
+        Jvm::get()->bytes(data),
+        version,
+        (jobject) cb,
+        (jobject) ctx);
+  }
+
+  void exists(const std::string& path,
+              bool watch,
+              const AsyncCallback::StatCallback& cb,
+              const java::lang::Object& ctx)
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/ZooKeeper")
+        .method("exists")
+        .parameter(Jvm::Class::STRING)
+        .parameter(Jvm::Class::BOOLEAN)
+        .parameter(
+            Jvm::Class::named(
+                "org/apache/zookeeper/AsyncCallback$StatCallback"))
+        .parameter(Jvm::Class::named("java/lang/Object"))
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invoke<void>(
+        object,
+        method,
+        Jvm::get()->string(path),
+        (jboolean) watch,
+        (jobject) cb,
+        (jobject) ctx);
+  }
+
+  void getChildren(const std::string& path,
+                   bool watch,
+                   const AsyncCallback::ChildrenCallback& cb,
+                   const java::lang::Object& ctx)
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/ZooKeeper")
+        .method("getChildren")
+        .parameter(Jvm::Class::STRING)
+        .parameter(Jvm::Class::BOOLEAN)
+        .parameter(
+            Jvm::Class::named(
+                "org/apache/zookeeper/AsyncCallback$ChildrenCallback"))
+        .parameter(Jvm::Class::named("java/lang/Object"))
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invoke<void>(
+        object,
+        method,
+        Jvm::get()->string(path),
+        (jboolean) watch,
+        (jobject) cb,
+        (jobject) ctx);
+  }
+};
+
+} // namespace zookeeper {
+} // namespace apache {
+} // namespace org {
+
 
 // Package 'org.apache.zookeeper.persistence'.
 
@@ -14,6 +484,29 @@ namespace apache {
 namespace zookeeper {
 namespace persistence {
 
+class FileTxnLog : public java::lang::Object
+{
+public:
+  // Sets the size (in bytes) by which transaction log files grow, each
+  // growth being zero-filled up front. Applies to all (subsequently
+  // grown) logs in the JVM.
+  static void setPreallocSize(int64_t size)
+  {
+    static Jvm::Method method = Jvm::get()->findStaticMethod(
+        Jvm::Class::named(
+            "org/apache/zookeeper/server/persistence/FileTxnLog")
+        .method("setPreallocSize")
+        .parameter(Jvm::Class::LONG)
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invokeStatic<void>(method, size);
+  }
+
+private:
+  FileTxnLog() {} // No default constructors.
+};
+
+
 class FileTxnSnapLog : public java::lang::Object
 {
 public:
@@ -27,8 +520,20 @@ public:
         .parameter(Jvm::Class::named("java/io/File"))
         .parameter(Jvm::Class::named("java/io/File")));
 
-    object = Jvm::get()->invoke(
-        constructor, (jobject) dataDir, (jobject) snapDir);
+    reset(Jvm::get()->invoke(
+        constructor, (jobject) dataDir, (jobject) snapDir));
+  }
+
+  // Closes the transaction log and snapshot files.
+  void close()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named(
+            "org/apache/zookeeper/server/persistence/FileTxnSnapLog")
+        .method("close")
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invoke<void>(object, method);
   }
 };
 
@@ -45,6 +550,193 @@ namespace apache {
 namespace zookeeper {
 namespace server {
 
+class DataTree : public java::lang::Object
+{
+public:
+  explicit DataTree(jobject dataTree) : java::lang::Object(dataTree) {}
+
+  int getNodeCount()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/DataTree")
+        .method("getNodeCount")
+        .returns(Jvm::Class::INT));
+
+    return Jvm::get()->invoke<int>(object, method);
+  }
+
+  // Note that this walks every node in the tree.
+  long approximateDataSize()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/DataTree")
+        .method("approximateDataSize")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  int getWatchCount()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/DataTree")
+        .method("getWatchCount")
+        .returns(Jvm::Class::INT));
+
+    return Jvm::get()->invoke<int>(object, method);
+  }
+};
+
+
+class ZKDatabase : public java::lang::Object
+{
+public:
+  explicit ZKDatabase(jobject zkDatabase) : java::lang::Object(zkDatabase) {}
+
+  DataTree getDataTree()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/ZKDatabase")
+        .method("getDataTree")
+        .returns(Jvm::Class::named("org/apache/zookeeper/server/DataTree")));
+
+    return DataTree(Jvm::get()->invoke<jobject>(object, method));
+  }
+
+  // Returns the ids of the live sessions.
+  std::vector<int64_t> getSessions()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/ZKDatabase")
+        .method("getSessions")
+        .returns(Jvm::Class::named("java/util/Collection")));
+
+    static Jvm::Method toArray = Jvm::get()->findMethod(
+        Jvm::Class::named("java/util/Collection")
+        .method("toArray")
+        .returns(Jvm::Class::named("java/lang/Object").arrayOf()));
+
+    static Jvm::Method longValue = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/Long")
+        .method("longValue")
+        .returns(Jvm::Class::LONG));
+
+    Jvm* jvm = Jvm::get();
+
+    std::vector<int64_t> sessions;
+    std::vector<java::lang::Object> ids = jvm->objects<java::lang::Object>(
+        static_cast<jobjectArray>(jvm->invoke<jobject>(
+            jvm->invoke<jobject>(object, method), toArray)));
+
+    for (size_t i = 0; i < ids.size(); i++) {
+      sessions.push_back(jvm->invoke<long>(ids[i], longValue));
+    }
+
+    return sessions;
+  }
+};
+
+
+class ServerStats : public java::lang::Object
+{
+public:
+  explicit ServerStats(jobject serverStats)
+    : java::lang::Object(serverStats) {}
+
+  // Request latencies are in milliseconds.
+  long getMinLatency()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/ServerStats")
+        .method("getMinLatency")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  long getAvgLatency()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/ServerStats")
+        .method("getAvgLatency")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  long getMaxLatency()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/ServerStats")
+        .method("getMaxLatency")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  long getOutstandingRequests()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/ServerStats")
+        .method("getOutstandingRequests")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  long getPacketsSent()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/ServerStats")
+        .method("getPacketsSent")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  long getPacketsReceived()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/ServerStats")
+        .method("getPacketsReceived")
+        .returns(Jvm::Class::LONG));
+
+    return Jvm::get()->invoke<long>(object, method);
+  }
+
+  void resetLatency()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/ServerStats")
+        .method("resetLatency")
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invoke<void>(object, method);
+  }
+};
+
+
+class SyncRequestProcessor : public java::lang::Object
+{
+public:
+  // Sets the number of transactions logged between snapshots, for all
+  // servers in the JVM.
+  static void setSnapCount(int count)
+  {
+    static Jvm::Method method = Jvm::get()->findStaticMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/SyncRequestProcessor")
+        .method("setSnapCount")
+        .parameter(Jvm::Class::INT)
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invokeStatic<void>(method, count);
+  }
+
+private:
+  SyncRequestProcessor() {} // No default constructors.
+};
+
+
 class ZooKeeperServer : public java::lang::Object
 {
 public:
@@ -64,7 +756,7 @@ public:
               "org/apache/zookeeper/server/ZooKeeperServer$BasicDataTreeBuilder")
           .constructor());
 
-      object = Jvm::get()->invoke(constructor);
+      reset(Jvm::get()->invoke(constructor));
     }
   };
 
@@ -81,8 +773,20 @@ public:
             Jvm::Class::named(
                 "org/apache/zookeeper/server/ZooKeeperServer$DataTreeBuilder")));
 
-    object = Jvm::get()->invoke(
-        constructor, (jobject) txnLogFactory, (jobject) treeBuilder);
+    reset(Jvm::get()->invoke(
+        constructor, (jobject) txnLogFactory, (jobject) treeBuilder));
+  }
+
+  // Session timeouts are bounded by 2 and 20 ticks.
+  void setTickTime(int tickTime)
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/ZooKeeperServer")
+        .method("setTickTime")
+        .parameter(Jvm::Class::INT)
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invoke<void>(object, method, tickTime);
   }
 
   int getClientPort()
@@ -105,6 +809,26 @@ public:
 
     Jvm::get()->invoke<void>(object, method, sessionId);
   }
+
+  ServerStats serverStats()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/ZooKeeperServer")
+        .method("serverStats")
+        .returns(Jvm::Class::named("org/apache/zookeeper/server/ServerStats")));
+
+    return ServerStats(Jvm::get()->invoke<jobject>(object, method));
+  }
+
+  ZKDatabase getZKDatabase()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/ZooKeeperServer")
+        .method("getZKDatabase")
+        .returns(Jvm::Class::named("org/apache/zookeeper/server/ZKDatabase")));
+
+    return ZKDatabase(Jvm::get()->invoke<jobject>(object, method));
+  }
 };
 
 
@@ -122,7 +846,22 @@ public:
           .constructor()
           .parameter(Jvm::Class::named("java/net/InetSocketAddress")));
 
-      object = Jvm::get()->invoke(constructor, (jobject) addr);
+      reset(Jvm::get()->invoke(constructor, (jobject) addr));
+    }
+
+    // Limits the number of connections per client host (zero means
+    // unlimited).
+    Factory(const java::net::InetSocketAddress& addr, int maxClientCnxns)
+    {
+      static Jvm::Constructor constructor = Jvm::get()->findConstructor(
+          Jvm::Class::named(
+              "org/apache/zookeeper/server/NIOServerCnxn$Factory")
+          .constructor()
+          .parameter(Jvm::Class::named("java/net/InetSocketAddress"))
+          .parameter(Jvm::Class::INT));
+
+      reset(Jvm::get()->invoke(
+          constructor, (jobject) addr, maxClientCnxns));
     }
 
     void startup(const ZooKeeperServer& zks)
@@ -170,4 +909,142 @@ private:
 } // namespace apache {
 } // namespace org {
 
+
+
+// Package 'org.apache.zookeeper.server.quorum'.
+
+namespace org {
+namespace apache {
+namespace zookeeper {
+namespace server {
+namespace quorum {
+
+class QuorumPeer : public java::lang::Object // TODO(benh): Extends Thread.
+{
+public:
+  class QuorumServer : public java::lang::Object
+  {
+  public:
+    QuorumServer(int64_t id,
+                 const java::net::InetSocketAddress& addr,
+                 const java::net::InetSocketAddress& electionAddr)
+    {
+      static Jvm::Constructor constructor = Jvm::get()->findConstructor(
+          Jvm::Class::named(
+              "org/apache/zookeeper/server/quorum/QuorumPeer$QuorumServer")
+          .constructor()
+          .parameter(Jvm::Class::LONG)
+          .parameter(Jvm::Class::named("java/net/InetSocketAddress"))
+          .parameter(Jvm::Class::named("java/net/InetSocketAddress")));
+
+      reset(Jvm::get()->invoke(
+          constructor, id, (jobject) addr, (jobject) electionAddr));
+    }
+  };
+
+  // Leader election algorithm using TCP (i.e., FastLeaderElection).
+  static const int FAST_LEADER_ELECTION = 3;
+
+  // Note that 'quorumPeers' must map each peer's id (as a
+  // java::lang::Long) to its QuorumServer.
+  QuorumPeer(const java::util::Map& quorumPeers,
+             const java::io::File& dataDir,
+             const java::io::File& dataLogDir,
+             int electionType,
+             int64_t myid,
+             int tickTime,
+             int initLimit,
+             int syncLimit,
+             const NIOServerCnxn::Factory& cnxnFactory)
+  {
+    static Jvm::Constructor constructor = Jvm::get()->findConstructor(
+        Jvm::Class::named("org/apache/zookeeper/server/quorum/QuorumPeer")
+        .constructor()
+        .parameter(Jvm::Class::named("java/util/Map"))
+        .parameter(Jvm::Class::named("java/io/File"))
+        .parameter(Jvm::Class::named("java/io/File"))
+        .parameter(Jvm::Class::INT)
+        .parameter(Jvm::Class::LONG)
+        .parameter(Jvm::Class::INT)
+        .parameter(Jvm::Class::INT)
+        .parameter(Jvm::Class::INT)
+        .parameter(
+            Jvm::Class::named(
+                "org/apache/zookeeper/server/NIOServerCnxn$Factory")));
+
+    reset(Jvm::get()->invoke(
+        constructor,
+        (jobject) quorumPeers,
+        (jobject) dataDir,
+        (jobject) dataLogDir,
+        electionType,
+        myid,
+        tickTime,
+        initLimit,
+        syncLimit,
+        (jobject) cnxnFactory));
+  }
+
+  // Starts the connection factory, leader election and the peer's
+  // own thread.
+  void start()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/quorum/QuorumPeer")
+        .method("start")
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invoke<void>(object, method);
+  }
+
+  void shutdown()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/quorum/QuorumPeer")
+        .method("shutdown")
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invoke<void>(object, method);
+  }
+
+  // Returns one of "LOOKING", "LEADING", "FOLLOWING" or "OBSERVING".
+  std::string getServerState()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("org/apache/zookeeper/server/quorum/QuorumPeer")
+        .method("getServerState")
+        .returns(Jvm::Class::STRING));
+
+    return Jvm::get()->string(
+        static_cast<jstring>(Jvm::get()->invoke<jobject>(object, method)));
+  }
+
+  bool isAlive()
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/Thread")
+        .method("isAlive")
+        .returns(Jvm::Class::BOOLEAN));
+
+    return Jvm::get()->invoke<bool>(object, method);
+  }
+
+  void join(int64_t millis)
+  {
+    static Jvm::Method method = Jvm::get()->findMethod(
+        Jvm::Class::named("java/lang/Thread")
+        .method("join")
+        .parameter(Jvm::Class::LONG)
+        .returns(Jvm::Class::VOID));
+
+    Jvm::get()->invoke<void>(object, method, millis);
+  }
+};
+
+} // namespace quorum {
+} // namespace server {
+} // namespace zookeeper {
+} // namespace apache {
+} // namespace org {
+
 #endif // __ORG_APACHE_ZOOKEEPER_HPP__
@@ -0,0 +1,48 @@
+package jsl.io;
+
+import java.io.File;
+
+/**
+ * Batched file system queries. Each method takes many paths and does
+ * all of the work within a single call so that a native caller pays
+ * for only one JNI transition (see include/jsl/io.hpp).
+ */
+public final class Files {
+  // Bits of the flags word returned for each path by 'stat'.
+  public static final long EXISTS = 1;
+  public static final long DIRECTORY = 2;
+  public static final long FILE = 4;
+
+  // Number of longs returned for each path by 'stat'.
+  public static final int STAT_FIELDS = 3;
+
+  private Files() {} // Not instantiable.
+
+  /**
+   * Returns flags, length and last modified time for each path,
+   * flattened into a single array of 'STAT_FIELDS' longs per path.
+   */
+  public static long[] stat(String[] paths) {
+    long[] result = new long[paths.length * STAT_FIELDS];
+
+    for (int i = 0; i < paths.length; i++) {
+      File file = new File(paths[i]);
+
+      long flags = 0;
+      if (file.exists()) {
+        flags |= EXISTS;
+        if (file.isDirectory()) {
+          flags |= DIRECTORY;
+        } else if (file.isFile()) {
+          flags |= FILE;
+        }
+      }
+
+      result[i * STAT_FIELDS] = flags;
+      result[i * STAT_FIELDS + 1] = file.length();
+      result[i * STAT_FIELDS + 2] = file.lastModified();
+    }
+
+    return result;
+  }
+}
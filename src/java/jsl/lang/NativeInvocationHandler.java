@@ -0,0 +1,93 @@
+package jsl.lang;
+
+import java.lang.reflect.InvocationHandler;
+import java.lang.reflect.Method;
+import java.lang.reflect.Proxy;
+import java.util.HashMap;
+import java.util.Map;
+
+/**
+ * Forwards invocations on a dynamic proxy to a C++ object (see
+ * include/jsl/lang.hpp). Only the methods named at construction are
+ * forwarded (identified by their index in that list), all others
+ * return a default value (null, false or zero) so that native code
+ * only has to implement the parts of an interface it cares about.
+ */
+public final class NativeInvocationHandler implements InvocationHandler {
+  private static final Object[] NO_ARGS = new Object[0];
+
+  private final long handle; // Pointer to the C++ handler.
+  private final Map<String, Integer> methods;
+
+  private NativeInvocationHandler(long handle, String[] methods) {
+    this.handle = handle;
+    this.methods = new HashMap<String, Integer>();
+    for (int i = 0; i < methods.length; i++) {
+      this.methods.put(methods[i], i);
+    }
+  }
+
+  /**
+   * Returns a new proxy implementing the named interfaces (given in
+   * their internal form, e.g., 'org/apache/log4j/Appender').
+   */
+  public static Object proxy(String[] interfaces, long handle, String[] methods)
+    throws ClassNotFoundException {
+    ClassLoader loader = NativeInvocationHandler.class.getClassLoader();
+
+    Class<?>[] classes = new Class<?>[interfaces.length];
+    for (int i = 0; i < interfaces.length; i++) {
+      String name = interfaces[i].replace('/', '.');
+      classes[i] = Class.forName(name, false, loader);
+    }
+
+    return Proxy.newProxyInstance(
+        loader, classes, new NativeInvocationHandler(handle, methods));
+  }
+
+  public Object invoke(Object proxy, Method method, Object[] args)
+    throws Throwable {
+    // Proxies have identity semantics for the methods of Object.
+    if (method.getDeclaringClass() == Object.class) {
+      String name = method.getName();
+      if (name.equals("equals")) {
+        return proxy == args[0];
+      } else if (name.equals("hashCode")) {
+        return System.identityHashCode(proxy);
+      }
+      return "NativeInvocationHandler@" + Long.toHexString(handle);
+    }
+
+    Integer index = methods.get(method.getName());
+
+    Object result = null;
+    if (index != null) {
+      result = invoke(handle, index, args != null ? args : NO_ARGS);
+    }
+
+    return result != null ? result : defaultValue(method.getReturnType());
+  }
+
+  private static Object defaultValue(Class<?> type) {
+    if (!type.isPrimitive() || type == Void.TYPE) {
+      return null;
+    } else if (type == Boolean.TYPE) {
+      return Boolean.FALSE;
+    } else if (type == Character.TYPE) {
+      return Character.valueOf((char) 0);
+    } else if (type == Byte.TYPE) {
+      return Byte.valueOf((byte) 0);
+    } else if (type == Short.TYPE) {
+      return Short.valueOf((short) 0);
+    } else if (type == Integer.TYPE) {
+      return Integer.valueOf(0);
+    } else if (type == Long.TYPE) {
+      return Long.valueOf(0);
+    } else if (type == Float.TYPE) {
+      return Float.valueOf(0);
+    }
+    return Double.valueOf(0);
+  }
+
+  private static native Object invoke(long handle, int method, Object[] args);
+}
@@ -0,0 +1,455 @@
+#include <jni.h>
+#include <stdint.h>
+#include <string.h> // For memset.
+#include <zlib.h>
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/strings.hpp>
+
+#include <jvm.hpp>
+
+#include <java/lang.hpp>
+
+#include <jsl/classes.hpp>
+
+namespace jsl {
+namespace classes {
+
+// Class files are big-endian, zip files are little-endian.
+static uint16_t u2be(const char* data)
+{
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+  return (bytes[0] << 8) | bytes[1];
+}
+
+
+static uint16_t u2le(const char* data)
+{
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+  return bytes[0] | (bytes[1] << 8);
+}
+
+
+static uint32_t u4le(const char* data)
+{
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+  return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) |
+    (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+
+// Returns the names of the superclass and interfaces of a class, as
+// found in its constant pool (see the JVM specification, 4.4).
+static Try<std::vector<std::string> > supertypes(const std::string& bytes)
+{
+  const char* data = bytes.data();
+  const size_t size = bytes.size();
+
+  if (size < 10 || u2be(data) != 0xcafe || u2be(data + 2) != 0xbabe) {
+    return Error("Not a class file");
+  }
+
+  const uint16_t count = u2be(data + 8);
+
+  // Offsets of the constant pool entries (indexed from 1).
+  std::vector<size_t> offsets(count, 0);
+
+  size_t offset = 10;
+  for (uint16_t i = 1; i < count; i++) {
+    if (offset >= size) {
+      return Error("Truncated constant pool");
+    }
+
+    offsets[i] = offset;
+
+    switch (data[offset]) {
+      case 1: // Utf8.
+        if (offset + 3 > size) {
+          return Error("Truncated constant pool");
+        }
+        offset += 3 + u2be(data + offset + 1);
+        break;
+      case 7: // Class.
+      case 8: // String.
+      case 16: // MethodType.
+      case 19: // Module.
+      case 20: // Package.
+        offset += 3;
+        break;
+      case 15: // MethodHandle.
+        offset += 4;
+        break;
+      case 3: // Integer.
+      case 4: // Float.
+      case 9: // Fieldref.
+      case 10: // Methodref.
+      case 11: // InterfaceMethodref.
+      case 12: // NameAndType.
+      case 17: // Dynamic.
+      case 18: // InvokeDynamic.
+        offset += 5;
+        break;
+      case 5: // Long.
+      case 6: // Double.
+        offset += 9;
+        i++; // Takes up two entries.
+        break;
+      default:
+        return Error("Unknown constant pool tag");
+    }
+  }
+
+  // Skip the access flags and this class.
+  offset += 4;
+
+  std::vector<uint16_t> indices;
+
+  if (offset + 4 > size) {
+    return Error("Truncated class file");
+  }
+
+  indices.push_back(u2be(data + offset)); // Superclass (0 for Object).
+
+  const uint16_t interfaces = u2be(data + offset + 2);
+  offset += 4;
+
+  if (offset + 2 * interfaces > size) {
+    return Error("Truncated class file");
+  }
+
+  for (uint16_t i = 0; i < interfaces; i++) {
+    indices.push_back(u2be(data + offset + 2 * i));
+  }
+
+  std::vector<std::string> names;
+
+  foreach (uint16_t index, indices) {
+    if (index == 0) {
+      continue;
+    }
+
+    if (index >= count || data[offsets[index]] != 7) {
+      return Error("Bad class index");
+    }
+
+    const uint16_t name = u2be(data + offsets[index] + 1);
+
+    if (name == 0 || name >= count || data[offsets[name]] != 1) {
+      return Error("Bad class name index");
+    }
+
+    names.push_back(std::string(
+        data + offsets[name] + 3,
+        u2be(data + offsets[name] + 1)));
+  }
+
+  return names;
+}
+
+
+// Returns the description of the pending exception, clearing it.
+static std::string describe(JNIEnv* env)
+{
+  jthrowable throwable = env->ExceptionOccurred();
+  env->ExceptionClear();
+
+  jclass clazz = env->FindClass("java/lang/Object");
+  jmethodID toString =
+    env->GetMethodID(clazz, "toString", "()Ljava/lang/String;");
+
+  jstring description =
+    static_cast<jstring>(env->CallObjectMethod(throwable, toString));
+
+  if (env->ExceptionCheck()) {
+    env->ExceptionClear();
+    description = NULL;
+  }
+
+  env->DeleteLocalRef(clazz);
+  env->DeleteLocalRef(throwable);
+
+  return description != NULL ? Jvm::get()->string(description) : "unknown";
+}
+
+
+static java::lang::Object systemClassLoader()
+{
+  static Jvm::Method method = Jvm::get()->findStaticMethod(
+      Jvm::Class::named("java/lang/ClassLoader")
+      .method("getSystemClassLoader")
+      .returns(Jvm::Class::named("java/lang/ClassLoader")));
+
+  JNI::Env env;
+
+  jobject loader = Jvm::get()->invokeStatic<jobject>(method);
+  java::lang::Object object(loader);
+  env->DeleteLocalRef(loader);
+  return object;
+}
+
+
+Embedded::Embedded() : loader(systemClassLoader()) {}
+
+
+void Embedded::add(const std::string& name, const char* data, size_t size)
+{
+  Entry entry;
+  entry.data = data;
+  entry.size = size;
+  entry.length = size;
+  entry.deflated = false;
+
+  entries[name] = entry;
+}
+
+
+Try<Nothing> Embedded::addJar(const char* data, size_t size)
+{
+  // Find the end of central directory record, which is followed by a
+  // comment of up to 64KB (see APPNOTE.TXT, 4.3.16).
+  const size_t EOCD = 22;
+
+  if (size < EOCD) {
+    return Error("Not a jar");
+  }
+
+  size_t end = size - EOCD;
+  while (u4le(data + end) != 0x06054b50) {
+    if (end == 0 || size - end > EOCD + 0xffff) {
+      return Error("Not a jar (no end of central directory)");
+    }
+    end--;
+  }
+
+  const uint16_t count = u2le(data + end + 10);
+  size_t offset = u4le(data + end + 16);
+
+  for (uint16_t i = 0; i < count; i++) {
+    if (offset + 46 > end || u4le(data + offset) != 0x02014b50) {
+      return Error("Bad central directory");
+    }
+
+    const uint16_t method = u2le(data + offset + 10);
+    const uint32_t compressed = u4le(data + offset + 20);
+    const uint32_t uncompressed = u4le(data + offset + 24);
+    const uint16_t length = u2le(data + offset + 28);
+    const uint16_t extra = u2le(data + offset + 30);
+    const uint16_t comment = u2le(data + offset + 32);
+    const uint32_t local = u4le(data + offset + 42);
+
+    // The variable length fields must also fit in the directory.
+    if (offset + 46 + length + extra + comment > end) {
+      return Error("Bad central directory");
+    }
+
+    const std::string name(data + offset + 46, length);
+
+    offset += 46 + length + extra + comment;
+
+    // Skip anything but classes (including those for other versions
+    // of Java in multi-release jars and module descriptors).
+    if (!strings::endsWith(name, ".class") ||
+        strings::startsWith(name, "META-INF/") ||
+        name == "module-info.class") {
+      continue;
+    }
+
+    if (method != 0 && method != Z_DEFLATED) {
+      return Error("Unsupported compression for '" + name + "'");
+    }
+
+    // The local header has its own (variable length) name and extra
+    // field, followed by the data.
+    if (local + 30 > size || u4le(data + local) != 0x04034b50) {
+      return Error("Bad local header for '" + name + "'");
+    }
+
+    const size_t start =
+      local + 30 + u2le(data + local + 26) + u2le(data + local + 28);
+
+    if (start + compressed > size) {
+      return Error("Truncated entry '" + name + "'");
+    }
+
+    Entry entry;
+    entry.data = data + start;
+    entry.size = compressed;
+    entry.length = uncompressed;
+    entry.deflated = method == Z_DEFLATED;
+
+    entries[name.substr(0, name.size() - strlen(".class"))] = entry;
+  }
+
+  return Nothing();
+}
+
+
+bool Embedded::contains(const std::string& name) const
+{
+  return entries.contains(name);
+}
+
+
+std::vector<std::string> Embedded::names() const
+{
+  std::vector<std::string> names;
+  foreachkey (const std::string& name, entries) {
+    names.push_back(name);
+  }
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+
+// Returns the class file of an entry, inflating it if need be.
+static Try<std::string> inflate(
+    const char* data,
+    size_t size,
+    size_t length,
+    bool deflated)
+{
+  if (!deflated) {
+    return std::string(data, size);
+  }
+
+  if (length == 0) {
+    return Error("Empty class file");
+  }
+
+  std::string bytes(length, '\0');
+
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream.avail_in = size;
+  stream.next_out = reinterpret_cast<Bytef*>(&bytes[0]);
+  stream.avail_out = length;
+
+  // Jar entries are raw deflate streams, i.e., without zlib headers.
+  if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+    return Error("Failed to initialize inflate");
+  }
+
+  const int code = ::inflate(&stream, Z_FINISH);
+
+  inflateEnd(&stream);
+
+  if (code != Z_STREAM_END || stream.total_out != length) {
+    return Error("Failed to inflate");
+  }
+
+  return bytes;
+}
+
+
+bool Embedded::loaded(const std::string& name)
+{
+  // Note that JNI ignores that 'findLoadedClass' is protected.
+  static Jvm::Method method = Jvm::get()->findMethod(
+      Jvm::Class::named("java/lang/ClassLoader")
+      .method("findLoadedClass")
+      .parameter(Jvm::Class::STRING)
+      .returns(Jvm::Class::named("java/lang/Class")));
+
+  JNI::Env env;
+
+  jobject clazz = Jvm::get()->invoke<jobject>(
+      loader, method, Jvm::get()->string(strings::replace(name, "/", ".")));
+
+  if (clazz == NULL) {
+    return false;
+  }
+
+  env->DeleteLocalRef(clazz);
+  return true;
+}
+
+
+Try<Nothing> Embedded::define(const std::string& name)
+{
+  if (defined.contains(name)) {
+    return Nothing();
+  }
+
+  if (!entries.contains(name)) {
+    return Error("Unknown class '" + name + "'");
+  }
+
+  const Entry& entry = entries[name];
+
+  Try<std::string> bytes =
+    inflate(entry.data, entry.size, entry.length, entry.deflated);
+
+  if (bytes.isError()) {
+    return Error("Failed to read '" + name + "': " + bytes.error());
+  }
+
+  Try<std::vector<std::string> > supertypes =
+    jsl::classes::supertypes(bytes.get());
+
+  if (supertypes.isError()) {
+    return Error("Failed to parse '" + name + "': " + supertypes.error());
+  }
+
+  // Mark the class first so that a (bogus) cycle terminates, the JVM
+  // rejects it when defining the class.
+  defined.insert(name);
+
+  // Supertypes must be loadable when a class gets defined, so define
+  // those that would otherwise not be found first.
+  foreach (const std::string& supertype, supertypes.get()) {
+    if (entries.contains(supertype)) {
+      Try<Nothing> define = Embedded::define(supertype);
+      if (define.isError()) {
+        defined.erase(name);
+        return define;
+      }
+    }
+  }
+
+  if (loaded(name)) {
+    return Nothing();
+  }
+
+  JNI::Env env;
+
+  jclass clazz = env->DefineClass(
+      name.c_str(),
+      loader,
+      reinterpret_cast<const jbyte*>(bytes.get().data()),
+      bytes.get().size());
+
+  if (clazz == NULL) {
+    defined.erase(name);
+    return Error("Failed to define '" + name + "': " + describe(env));
+  }
+
+  VLOG(1) << "Defined class " << name << " from memory";
+
+  env->DeleteLocalRef(clazz);
+
+  return Nothing();
+}
+
+
+Try<Nothing> Embedded::define()
+{
+  foreach (const std::string& name, names()) {
+    Try<Nothing> define = Embedded::define(name);
+    if (define.isError()) {
+      return define;
+    }
+  }
+
+  return Nothing();
+}
+
+} // namespace classes {
+} // namespace jsl {
@@ -0,0 +1,100 @@
+#include <jni.h>
+
+#include <glog/logging.h>
+
+#include <exception>
+#include <string>
+#include <vector>
+
+#include <jvm.hpp>
+
+#include <java/lang.hpp>
+
+#include <jsl/lang.hpp>
+
+namespace jsl {
+namespace lang {
+
+// Native implementation of 'jsl.lang.NativeInvocationHandler.invoke'.
+static jobject invoke(
+    JNIEnv* env,
+    jclass,
+    jlong handle,
+    jint method,
+    jobjectArray args)
+{
+  NativeInvocationHandler* handler =
+    reinterpret_cast<NativeInvocationHandler*>(handle);
+
+  try {
+    return CHECK_NOTNULL(handler)->invoke(env, method, args);
+  } catch (const java::lang::Throwable& throwable) {
+    env->Throw(static_cast<jthrowable>(static_cast<jobject>(throwable)));
+  } catch (const std::exception& e) {
+    env->ThrowNew(env->FindClass("java/lang/RuntimeException"), e.what());
+  } catch (...) {
+    env->ThrowNew(env->FindClass("java/lang/RuntimeException"),
+                  "Unknown C++ exception");
+  }
+
+  return NULL;
+}
+
+
+// Registers the native methods of 'jsl.lang.NativeInvocationHandler'.
+static bool registerNatives()
+{
+  JNI::Env env;
+
+  jclass clazz = CHECK_NOTNULL(
+      env->FindClass("jsl/lang/NativeInvocationHandler"));
+
+  JNINativeMethod methods[] = {
+    { const_cast<char*>("invoke"),
+      const_cast<char*>("(JI[Ljava/lang/Object;)Ljava/lang/Object;"),
+      reinterpret_cast<void*>(&invoke) }
+  };
+
+  CHECK_EQ(0, env->RegisterNatives(clazz, methods, 1))
+    << "Failed to register natives for jsl.lang.NativeInvocationHandler";
+
+  env->DeleteLocalRef(clazz);
+
+  return true;
+}
+
+
+java::lang::Object NativeInvocationHandler::proxy(
+    const std::string& interface,
+    const std::vector<std::string>& methods)
+{
+  return proxy(std::vector<std::string>(1, interface), methods);
+}
+
+
+java::lang::Object NativeInvocationHandler::proxy(
+    const std::vector<std::string>& interfaces,
+    const std::vector<std::string>& methods)
+{
+  static bool registered = registerNatives();
+  CHECK(registered);
+
+  static Jvm::Method method = Jvm::get()->findStaticMethod(
+      Jvm::Class::named("jsl/lang/NativeInvocationHandler")
+      .method("proxy")
+      .parameter(Jvm::Class::STRING.arrayOf())
+      .parameter(Jvm::Class::LONG)
+      .parameter(Jvm::Class::STRING.arrayOf())
+      .returns(Jvm::Class::named("java/lang/Object")));
+
+  jobject object = Jvm::get()->invokeStatic<jobject>(
+      method,
+      Jvm::get()->strings(interfaces),
+      reinterpret_cast<jlong>(this),
+      Jvm::get()->strings(methods));
+
+  return java::lang::Object(object);
+}
+
+} // namespace lang {
+} // namespace jsl {
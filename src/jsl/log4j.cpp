@@ -0,0 +1,186 @@
+#include <jni.h>
+#include <unistd.h> // For usleep.
+
+#include <glog/logging.h>
+
+#include <string>
+#include <vector>
+
+#include <jvm.hpp>
+
+#include <jsl/log4j.hpp>
+
+#include <org/apache/log4j.hpp>
+
+using org::apache::log4j::Level;
+
+namespace jsl {
+namespace log4j {
+
+// Methods of 'org.apache.log4j.Appender' that we implement, in the
+// order they are passed to the proxy (i.e., the 'method' index).
+enum
+{
+  DO_APPEND,
+  GET_NAME,
+  CLOSE
+};
+
+
+static std::vector<std::string> methods()
+{
+  std::vector<std::string> methods;
+  methods.push_back("doAppend");
+  methods.push_back("getName");
+  methods.push_back("close");
+  return methods;
+}
+
+
+// Maximum number of events written per batch before checking whether
+// we've been asked to stop.
+static const size_t BATCH = 1024;
+
+
+GlogAppender::GlogAppender(size_t capacity)
+  : events(capacity),
+    _appender(proxy("org/apache/log4j/Appender", methods())),
+    running(true),
+    closed(false),
+    appended(0),
+    dropped(0),
+    logged(0)
+{
+  CHECK_EQ(0, pthread_create(&thread, NULL, &GlogAppender::drain, this));
+}
+
+
+GlogAppender::~GlogAppender()
+{
+  closed = true;
+  running = false;
+  CHECK_EQ(0, pthread_join(thread, NULL));
+
+  // Write out anything appended before we were closed.
+  while (flush(BATCH) > 0);
+}
+
+
+GlogAppender::Statistics GlogAppender::statistics() const
+{
+  Statistics statistics;
+  statistics.appended = appended;
+  statistics.dropped = dropped;
+  statistics.logged = logged;
+  return statistics;
+}
+
+
+jobject GlogAppender::invoke(JNIEnv* env, int method, jobjectArray args)
+{
+  switch (method) {
+    case DO_APPEND: {
+      jobject event = env->GetObjectArrayElement(args, 0);
+      append(event);
+      env->DeleteLocalRef(event);
+      return NULL;
+    }
+    case GET_NAME:
+      return env->NewStringUTF("glog");
+    case CLOSE:
+      closed = true;
+      return NULL;
+    default:
+      LOG(FATAL) << "Unexpected method index " << method;
+      return NULL;
+  }
+}
+
+
+void GlogAppender::append(jobject object)
+{
+  if (closed) {
+    return;
+  }
+
+  static Jvm::Method getLevel = Jvm::get()->findMethod(
+      Jvm::Class::named("org/apache/log4j/spi/LoggingEvent")
+      .method("getLevel")
+      .returns(Jvm::Class::named("org/apache/log4j/Level")));
+
+  static Jvm::Method toInt = Jvm::get()->findMethod(
+      Jvm::Class::named("org/apache/log4j/Priority")
+      .method("toInt")
+      .returns(Jvm::Class::INT));
+
+  static Jvm::Method getLoggerName = Jvm::get()->findMethod(
+      Jvm::Class::named("org/apache/log4j/spi/LoggingEvent")
+      .method("getLoggerName")
+      .returns(Jvm::Class::STRING));
+
+  static Jvm::Method getRenderedMessage = Jvm::get()->findMethod(
+      Jvm::Class::named("org/apache/log4j/spi/LoggingEvent")
+      .method("getRenderedMessage")
+      .returns(Jvm::Class::STRING));
+
+  Jvm* jvm = Jvm::get();
+
+  Event event;
+  event.level = jvm->invoke<int>(
+      jvm->invoke<jobject>(object, getLevel), toInt);
+  event.logger = jvm->string(static_cast<jstring>(
+      jvm->invoke<jobject>(object, getLoggerName)));
+  event.message = jvm->string(static_cast<jstring>(
+      jvm->invoke<jobject>(object, getRenderedMessage)));
+
+  if (events.put(event)) {
+    __sync_fetch_and_add(&appended, 1);
+  } else {
+    __sync_fetch_and_add(&dropped, 1);
+  }
+}
+
+
+void* GlogAppender::drain(void* that)
+{
+  GlogAppender* appender = static_cast<GlogAppender*>(that);
+
+  while (appender->running) {
+    if (appender->flush(BATCH) == 0) {
+      usleep(1000); // Back off while there is nothing to do.
+    }
+  }
+
+  return NULL;
+}
+
+
+size_t GlogAppender::flush(size_t limit)
+{
+  Event event;
+  size_t count = 0;
+
+  while (count < limit && events.take(&event)) {
+    if (event.level >= Level::ERROR_INT) {
+      LOG(ERROR) << event.logger << ": " << event.message;
+    } else if (event.level >= Level::WARN_INT) {
+      LOG(WARNING) << event.logger << ": " << event.message;
+    } else if (event.level >= Level::INFO_INT) {
+      LOG(INFO) << event.logger << ": " << event.message;
+    } else if (event.level >= Level::DEBUG_INT) {
+      VLOG(1) << event.logger << ": " << event.message;
+    } else {
+      VLOG(2) << event.logger << ": " << event.message;
+    }
+    count++;
+  }
+
+  if (count > 0) {
+    __sync_fetch_and_add(&logged, count);
+  }
+
+  return count;
+}
+
+} // namespace log4j {
+} // namespace jsl {
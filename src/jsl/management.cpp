@@ -0,0 +1,233 @@
+#include <errno.h>
+
+#include <sys/time.h>
+
+#include <glog/logging.h>
+
+#include <string>
+#include <vector>
+
+#include <stout/duration.hpp>
+#include <stout/foreach.hpp>
+#include <stout/json.hpp>
+
+#include <jvm.hpp>
+
+#include <java/lang/management.hpp>
+
+#include <jsl/management.hpp>
+
+using java::lang::management::GarbageCollectorMXBean;
+using java::lang::management::ManagementFactory;
+using java::lang::management::MemoryUsage;
+
+namespace jsl {
+namespace management {
+
+double now()
+{
+  timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + now.tv_usec / 1000000.0;
+}
+
+
+static JSON::Object json(const Statistics::Usage& usage)
+{
+  JSON::Object object;
+  object.values["used"] = JSON::Number(usage.used);
+  object.values["committed"] = JSON::Number(usage.committed);
+  object.values["max"] = JSON::Number(usage.max);
+  return object;
+}
+
+
+JSON::Object json(const Statistics& statistics)
+{
+  JSON::Object object;
+
+  object.values["timestamp"] = JSON::Number(statistics.timestamp);
+  object.values["uptime"] = JSON::Number(statistics.uptime);
+
+  object.values["heap"] = json(statistics.heap);
+  object.values["non_heap"] = json(statistics.nonHeap);
+
+  JSON::Object collectors;
+  foreach (const Statistics::Collector& collector, statistics.collectors) {
+    JSON::Object values;
+    values.values["count"] = JSON::Number(collector.count);
+    values.values["time"] = JSON::Number(collector.time);
+    values.values["count_delta"] = JSON::Number(collector.countDelta);
+    values.values["time_delta"] = JSON::Number(collector.timeDelta);
+    collectors.values[collector.name] = values;
+  }
+  object.values["collectors"] = collectors;
+
+  object.values["threads"] = JSON::Number(statistics.threads);
+  object.values["peak_threads"] = JSON::Number(statistics.peakThreads);
+  object.values["daemon_threads"] = JSON::Number(statistics.daemonThreads);
+  object.values["started_threads"] = JSON::Number(statistics.startedThreads);
+
+  return object;
+}
+
+
+Sampler::Sampler(const Duration& _interval, size_t _capacity)
+  : memory(ManagementFactory::getMemoryMXBean()),
+    collectors(ManagementFactory::getGarbageCollectorMXBeans()),
+    threads(ManagementFactory::getThreadMXBean()),
+    runtime(ManagementFactory::getRuntimeMXBean()),
+    interval(_interval),
+    capacity(_capacity),
+    running(true)
+{
+  CHECK_GT(capacity, 0u);
+
+  for (size_t i = 0; i < collectors.size(); i++) {
+    names.push_back(collectors[i].getName());
+  }
+
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond, NULL);
+
+  CHECK_EQ(0, pthread_create(&thread, NULL, &Sampler::run, this));
+}
+
+
+Sampler::~Sampler()
+{
+  pthread_mutex_lock(&mutex);
+  running = false;
+  pthread_cond_signal(&cond);
+  pthread_mutex_unlock(&mutex);
+
+  CHECK_EQ(0, pthread_join(thread, NULL));
+
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mutex);
+}
+
+
+Option<Statistics> Sampler::latest()
+{
+  Option<Statistics> result;
+
+  pthread_mutex_lock(&mutex);
+  if (!samples.empty()) {
+    result = samples.back();
+  }
+  pthread_mutex_unlock(&mutex);
+
+  return result;
+}
+
+
+JSON::Array Sampler::history()
+{
+  JSON::Array array;
+
+  pthread_mutex_lock(&mutex);
+  foreach (const Statistics& statistics, samples) {
+    array.values.push_back(json(statistics));
+  }
+  pthread_mutex_unlock(&mutex);
+
+  return array;
+}
+
+
+void* Sampler::run(void* that)
+{
+  Sampler* sampler = static_cast<Sampler*>(that);
+
+  // Stay attached to the JVM for the life of the thread rather than
+  // attaching and detaching for each call.
+  JNI::Env env;
+
+  Option<Statistics> previous;
+
+  pthread_mutex_lock(&sampler->mutex);
+
+  while (sampler->running) {
+    pthread_mutex_unlock(&sampler->mutex);
+
+    Statistics statistics;
+    {
+      // Free the local references of each sample (e.g., for the
+      // memory usages), this thread never returns to Java.
+      JNI::Frame frame;
+      statistics = sampler->sample(previous);
+    }
+    previous = statistics;
+
+    pthread_mutex_lock(&sampler->mutex);
+
+    sampler->samples.push_back(statistics);
+    if (sampler->samples.size() > sampler->capacity) {
+      sampler->samples.pop_front();
+    }
+
+    // Wait for the next interval (or until we're stopped).
+    const double deadline = now() + sampler->interval.secs();
+
+    timespec timeout;
+    timeout.tv_sec = static_cast<time_t>(deadline);
+    timeout.tv_nsec = static_cast<long>((deadline - timeout.tv_sec) * 1e9);
+
+    while (sampler->running &&
+           pthread_cond_timedwait(
+               &sampler->cond, &sampler->mutex, &timeout) != ETIMEDOUT);
+  }
+
+  pthread_mutex_unlock(&sampler->mutex);
+
+  return NULL;
+}
+
+
+Statistics Sampler::sample(const Option<Statistics>& previous)
+{
+  Statistics statistics;
+
+  statistics.timestamp = now();
+  statistics.uptime = runtime.getUptime();
+
+  MemoryUsage heap = memory.getHeapMemoryUsage();
+  statistics.heap.used = heap.getUsed();
+  statistics.heap.committed = heap.getCommitted();
+  statistics.heap.max = heap.getMax();
+
+  MemoryUsage nonHeap = memory.getNonHeapMemoryUsage();
+  statistics.nonHeap.used = nonHeap.getUsed();
+  statistics.nonHeap.committed = nonHeap.getCommitted();
+  statistics.nonHeap.max = nonHeap.getMax();
+
+  for (size_t i = 0; i < collectors.size(); i++) {
+    Statistics::Collector collector;
+    collector.name = names[i];
+    collector.count = collectors[i].getCollectionCount();
+    collector.time = collectors[i].getCollectionTime();
+    collector.countDelta = 0;
+    collector.timeDelta = 0;
+
+    // The set of collectors is fixed so the previous sample has the
+    // same collectors in the same order.
+    if (previous.isSome()) {
+      const Statistics::Collector& last = previous.get().collectors[i];
+      collector.countDelta = collector.count - last.count;
+      collector.timeDelta = collector.time - last.time;
+    }
+
+    statistics.collectors.push_back(collector);
+  }
+
+  statistics.threads = threads.getThreadCount();
+  statistics.peakThreads = threads.getPeakThreadCount();
+  statistics.daemonThreads = threads.getDaemonThreadCount();
+  statistics.startedThreads = threads.getTotalStartedThreadCount();
+
+  return statistics;
+}
+
+} // namespace management {
+} // namespace jsl {
@@ -0,0 +1,614 @@
+#include <cxxabi.h> // For abi::__cxa_demangle.
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h> // For backtrace.
+#include <jni.h>
+#include <jvmti.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h> // For atexit, free.
+#include <string.h> // For memset, strstr.
+#include <ucontext.h>
+
+#include <sys/time.h>
+
+#include <glog/logging.h>
+
+#include <algorithm> // For std::min.
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/os.hpp>
+#include <stout/strings.hpp>
+
+#include <jvm.hpp>
+
+#include <java/lang.hpp>
+
+#include <jsl/profiler.hpp>
+
+namespace jsl {
+namespace profiler {
+
+// The (undocumented) interface of 'AsyncGetCallTrace', exported by
+// HotSpot's libjvm.
+struct CallFrame
+{
+  jint lineno; // Negative for native methods.
+  jmethodID method;
+};
+
+struct CallTrace
+{
+  JNIEnv* env;
+  jint frames; // Or a (negative) error.
+  CallFrame* frame;
+};
+
+typedef void (*AsyncGetCallTrace)(CallTrace* trace, jint depth, void* context);
+
+
+// Maximum number of frames per sample (bounds the stack used by the
+// signal handler).
+static const size_t MAX_DEPTH = 256;
+
+
+// Each thread records its samples into a buffer of its own: slot 0
+// of each sample holds the number of Java frames (low 16 bits) and
+// native frames (high bits), followed by the Java frames (jmethodIDs,
+// leaf first) and the native frames (program counters, leaf first).
+// Only the owning thread writes to a buffer (signal handlers don't
+// nest since SIGPROF is blocked while handling it) and it publishes
+// each sample by incrementing 'count'.
+struct Buffer
+{
+  volatile size_t count;
+  uintptr_t* slots;
+};
+
+
+static JavaVM* vm = NULL;
+static jvmtiEnv* jvmti = NULL;
+static AsyncGetCallTrace asyncGetCallTrace = NULL;
+
+static Options options;
+static Buffer* buffers = NULL;
+static volatile size_t claimed = 0; // Number of buffers handed out.
+
+// Incremented for every 'start' so that threads claim a new buffer.
+static volatile unsigned int generation = 0;
+
+static volatile bool sampling = false;
+static volatile int active = 0; // Number of signal handlers running.
+
+static volatile long samples = 0;
+static volatile long dropped = 0;
+static volatile long failed = 0;
+
+// The buffer of the current thread (if any) and the generation it was
+// claimed in. Note that we use the initial-exec model since accessing
+// thread-local storage in other models might allocate, which is not
+// safe in a signal handler.
+static __thread Buffer* buffer __attribute__((tls_model("initial-exec")));
+static __thread unsigned int claim __attribute__((tls_model("initial-exec")));
+
+
+// Returns the buffer of the current thread, claiming one if need be,
+// or NULL if there are none left.
+static Buffer* current()
+{
+  if (claim != generation || buffer == NULL) {
+    size_t index = __sync_fetch_and_add(&claimed, 1);
+    buffer = index < options.threads ? &buffers[index] : NULL;
+    claim = generation;
+  }
+
+  return buffer;
+}
+
+
+// Returns the program counter of the interrupted frame, if we know
+// how to get it on this platform.
+static void* pc(void* context)
+{
+#if defined(__linux__) && defined(__x86_64__)
+  return reinterpret_cast<void*>(
+      static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__linux__) && defined(__i386__)
+  return reinterpret_cast<void*>(
+      static_cast<ucontext_t*>(context)->uc_mcontext.gregs[REG_EIP]);
+#else
+  return NULL;
+#endif
+}
+
+
+static void record(void* context)
+{
+  Buffer* buffer = current();
+
+  if (buffer == NULL || buffer->count >= options.samples) {
+    __sync_fetch_and_add(&dropped, 1);
+    return;
+  }
+
+  uintptr_t* slots = buffer->slots + buffer->count * (options.depth + 1);
+
+  size_t java = 0;
+  size_t native = 0;
+
+  JNIEnv* env = NULL;
+  if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_OK) {
+    CallFrame frames[MAX_DEPTH];
+
+    CallTrace trace;
+    trace.env = env;
+    trace.frames = 0;
+    trace.frame = frames;
+
+    asyncGetCallTrace(&trace, options.depth, context);
+
+    if (trace.frames > 0) {
+      java = trace.frames;
+      for (size_t i = 0; i < java; i++) {
+        slots[1 + i] = reinterpret_cast<uintptr_t>(frames[i].method);
+      }
+    } else {
+      __sync_fetch_and_add(&failed, 1);
+    }
+  }
+
+  if (options.native && java < options.depth) {
+    void* pcs[MAX_DEPTH];
+    const int size = backtrace(pcs, MAX_DEPTH);
+
+    // Skip the frames of the signal handler itself, i.e., start at
+    // the interrupted frame (or after 'record' and 'handler' if we
+    // can't tell which one that is).
+    int start = size < 2 ? size : 2;
+    void* interrupted = pc(context);
+    for (int i = 0; interrupted != NULL && i < size; i++) {
+      if (pcs[i] == interrupted) {
+        start = i;
+        break;
+      }
+    }
+
+    for (int i = start; i < size && java + native < options.depth; i++) {
+      slots[1 + java + native++] = reinterpret_cast<uintptr_t>(pcs[i]);
+    }
+  }
+
+  slots[0] = java | (native << 16);
+
+  __sync_synchronize(); // Publish the sample before counting it.
+  buffer->count++;
+
+  __sync_fetch_and_add(&samples, 1);
+}
+
+
+static void handler(int, siginfo_t*, void* context)
+{
+  const int error = errno;
+
+  __sync_fetch_and_add(&active, 1);
+
+  if (sampling) {
+    record(context);
+  }
+
+  __sync_fetch_and_sub(&active, 1);
+
+  errno = error;
+}
+
+
+// AsyncGetCallTrace can only resolve methods whose jmethodIDs exist,
+// so we make sure they get created for every class as it's loaded
+// (and for the classes that have been loaded already on 'start').
+static void methods(jvmtiEnv* jvmti, jclass clazz)
+{
+  jint count = 0;
+  jmethodID* methods = NULL;
+  if (jvmti->GetClassMethods(clazz, &count, &methods) == JVMTI_ERROR_NONE) {
+    jvmti->Deallocate(reinterpret_cast<unsigned char*>(methods));
+  }
+}
+
+
+static void JNICALL classLoad(jvmtiEnv*, JNIEnv*, jthread, jclass)
+{
+  // Nothing to do until the class is prepared, but the event must be
+  // enabled for ClassPrepare to get posted for all classes.
+}
+
+
+static void JNICALL classPrepare(
+    jvmtiEnv* jvmti,
+    JNIEnv*,
+    jthread,
+    jclass clazz)
+{
+  methods(jvmti, clazz);
+}
+
+
+// Sets up JVMTI and the signal handler, once.
+static Try<Nothing> initialize(JavaVM* jvm)
+{
+  if (jvmti != NULL) {
+    return Nothing();
+  }
+
+  asyncGetCallTrace = reinterpret_cast<AsyncGetCallTrace>(
+      dlsym(RTLD_DEFAULT, "AsyncGetCallTrace"));
+
+  if (asyncGetCallTrace == NULL) {
+    return Error("The JVM does not provide AsyncGetCallTrace");
+  }
+
+  jvmtiEnv* env = NULL;
+  if (jvm->GetEnv(reinterpret_cast<void**>(&env), JVMTI_VERSION_1_0) !=
+      JNI_OK) {
+    return Error("Failed to get a JVMTI environment");
+  }
+
+  jvmtiEventCallbacks callbacks;
+  memset(&callbacks, 0, sizeof(callbacks));
+  callbacks.ClassLoad = &classLoad;
+  callbacks.ClassPrepare = &classPrepare;
+
+  if (env->SetEventCallbacks(&callbacks, sizeof(callbacks)) !=
+        JVMTI_ERROR_NONE ||
+      env->SetEventNotificationMode(
+          JVMTI_ENABLE, JVMTI_EVENT_CLASS_LOAD, NULL) != JVMTI_ERROR_NONE ||
+      env->SetEventNotificationMode(
+          JVMTI_ENABLE, JVMTI_EVENT_CLASS_PREPARE, NULL) !=
+        JVMTI_ERROR_NONE) {
+    env->DisposeEnvironment();
+    return Error("Failed to enable JVMTI class events");
+  }
+
+  // Create the jmethodIDs of the classes loaded so far.
+  jint count = 0;
+  jclass* classes = NULL;
+  if (env->GetLoadedClasses(&count, &classes) == JVMTI_ERROR_NONE) {
+    JNI::Env jni;
+    for (jint i = 0; i < count; i++) {
+      methods(env, classes[i]);
+      jni->DeleteLocalRef(classes[i]);
+    }
+    env->Deallocate(reinterpret_cast<unsigned char*>(classes));
+  }
+
+  // Note that the first call to 'backtrace' might allocate (it loads
+  // libgcc_s) so we make it here rather than in the signal handler.
+  void* pcs[1];
+  backtrace(pcs, 1);
+
+  // Our handler stays installed (and ignores signals when we're not
+  // sampling) since a SIGPROF still pending after 'stop' would
+  // otherwise terminate the process.
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = &handler;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+
+  if (sigaction(SIGPROF, &action, NULL) != 0) {
+    env->DisposeEnvironment();
+    return ErrnoError("Failed to install SIGPROF handler");
+  }
+
+  vm = jvm;
+  jvmti = env;
+
+  return Nothing();
+}
+
+
+static Try<Nothing> timer(const Duration& interval)
+{
+  const long us = static_cast<long>(interval.us());
+
+  itimerval timer;
+  timer.it_interval.tv_sec = us / 1000000;
+  timer.it_interval.tv_usec = us % 1000000;
+  timer.it_value = timer.it_interval;
+
+  if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+    return ErrnoError("Failed to set profiling timer");
+  }
+
+  return Nothing();
+}
+
+
+Try<Nothing> start(const Options& _options)
+{
+  if (sampling) {
+    return Error("Profiler is already running");
+  }
+
+  if (_options.depth == 0 || _options.depth > MAX_DEPTH ||
+      _options.interval.us() < 1) {
+    return Error("Invalid profiler options");
+  }
+
+  Try<Nothing> initialize = jsl::profiler::initialize(Jvm::get()->vm());
+  if (initialize.isError()) {
+    return Error(initialize.error());
+  }
+
+  // Wait for any signal handler from a previous run that might still
+  // be using the old buffers.
+  while (active > 0);
+
+  if (buffers != NULL) {
+    for (size_t i = 0; i < options.threads; i++) {
+      delete[] buffers[i].slots;
+    }
+    delete[] buffers;
+  }
+
+  options = _options;
+
+  buffers = new Buffer[options.threads];
+  for (size_t i = 0; i < options.threads; i++) {
+    buffers[i].count = 0;
+    buffers[i].slots = new uintptr_t[options.samples * (options.depth + 1)];
+  }
+
+  claimed = 0;
+  samples = 0;
+  dropped = 0;
+  failed = 0;
+  generation++;
+
+  __sync_synchronize();
+  sampling = true;
+
+  Try<Nothing> timer = jsl::profiler::timer(options.interval);
+  if (timer.isError()) {
+    sampling = false;
+    return timer;
+  }
+
+  return Nothing();
+}
+
+
+Try<Nothing> stop()
+{
+  if (!sampling) {
+    return Error("Profiler is not running");
+  }
+
+  sampling = false;
+
+  return timer(Duration());
+}
+
+
+bool running()
+{
+  return sampling;
+}
+
+
+Statistics statistics()
+{
+  Statistics statistics;
+  statistics.samples = samples;
+  statistics.dropped = dropped;
+  statistics.failed = failed;
+  return statistics;
+}
+
+
+// Returns the name of a Java method as "package.Class.method".
+static std::string java(JNIEnv* env, jmethodID method)
+{
+  jclass clazz = NULL;
+  char* signature = NULL;
+  char* name = NULL;
+
+  if (jvmti->GetMethodDeclaringClass(method, &clazz) != JVMTI_ERROR_NONE ||
+      jvmti->GetClassSignature(clazz, &signature, NULL) != JVMTI_ERROR_NONE ||
+      jvmti->GetMethodName(method, &name, NULL, NULL) != JVMTI_ERROR_NONE) {
+    if (clazz != NULL) {
+      env->DeleteLocalRef(clazz);
+    }
+    if (signature != NULL) {
+      jvmti->Deallocate(reinterpret_cast<unsigned char*>(signature));
+    }
+    return "[unknown]"; // E.g., its class has been unloaded.
+  }
+
+  // Class signatures look like 'Ljava/lang/Object;'.
+  std::string result = signature;
+  if (result.size() > 2 && result[0] == 'L') {
+    result = result.substr(1, result.size() - 2);
+  }
+  result = strings::replace(result, "/", ".") + "." + name;
+
+  env->DeleteLocalRef(clazz);
+  jvmti->Deallocate(reinterpret_cast<unsigned char*>(signature));
+  jvmti->Deallocate(reinterpret_cast<unsigned char*>(name));
+
+  return result;
+}
+
+
+// Returns the (demangled) name of the function containing 'pc', or
+// the name of its library and the offset if it has no symbol.
+static std::string native(uintptr_t pc)
+{
+  Dl_info info;
+  if (dladdr(reinterpret_cast<void*>(pc), &info) == 0) {
+    std::ostringstream out;
+    out << "0x" << std::hex << pc;
+    return out.str();
+  }
+
+  if (info.dli_sname == NULL) {
+    std::string library = info.dli_fname != NULL ? info.dli_fname : "?";
+    library = library.substr(library.find_last_of('/') + 1);
+
+    std::ostringstream out;
+    out << library << "+0x" << std::hex << (pc - (uintptr_t) info.dli_fbase);
+    return out.str();
+  }
+
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(info.dli_sname, NULL, NULL, &status);
+
+  if (status != 0 || demangled == NULL) {
+    return info.dli_sname;
+  }
+
+  std::string result = demangled;
+  free(demangled);
+  return result;
+}
+
+
+// Returns true if 'pc' is in the JVM itself (as opposed to, e.g., the
+// native code invoked by or invoking Java).
+static bool jvm(uintptr_t pc)
+{
+  Dl_info info;
+  return dladdr(reinterpret_cast<void*>(pc), &info) != 0 &&
+    info.dli_fname != NULL &&
+    strstr(info.dli_fname, "libjvm") != NULL;
+}
+
+
+std::string collapsed()
+{
+  CHECK(jvmti != NULL) << "Profiler was never started";
+
+  JNI::Env env;
+
+  std::map<std::string, long> stacks;
+  std::map<uintptr_t, std::string> javas;
+  std::map<uintptr_t, std::string> natives;
+  std::map<uintptr_t, bool> jvms;
+
+  const size_t threads = std::min((size_t) claimed, options.threads);
+
+  for (size_t t = 0; t < threads; t++) {
+    const size_t count = buffers[t].count;
+    __sync_synchronize(); // Read the samples after their count.
+
+    for (size_t s = 0; s < count; s++) {
+      const uintptr_t* slots =
+        buffers[t].slots + s * (options.depth + 1);
+
+      const size_t java = slots[0] & 0xffff;
+      const size_t native = slots[0] >> 16;
+
+      std::vector<std::string> frames;
+
+      // Java frames (root first).
+      for (size_t i = java; i > 0; i--) {
+        const uintptr_t method = slots[i];
+        if (javas.count(method) == 0) {
+          javas[method] = jsl::profiler::java(
+              env, reinterpret_cast<jmethodID>(method)) + "_[j]";
+        }
+        frames.push_back(javas[method]);
+      }
+
+      // Native frames. Below Java frames only keep those above the
+      // JVM (e.g., a native method) rather than the JVM's internals
+      // and the native code that called into Java.
+      size_t end = native;
+      if (java > 0) {
+        for (size_t i = 0; i < native; i++) {
+          const uintptr_t pc = slots[1 + java + i];
+          if (jvms.count(pc) == 0) {
+            jvms[pc] = jsl::profiler::jvm(pc);
+          }
+          if (jvms[pc]) {
+            end = i;
+            break;
+          }
+        }
+      }
+
+      for (size_t i = end; i > 0; i--) {
+        const uintptr_t pc = slots[java + i];
+        if (natives.count(pc) == 0) {
+          natives[pc] = jsl::profiler::native(pc);
+        }
+        frames.push_back(natives[pc]);
+      }
+
+      if (frames.empty()) {
+        frames.push_back("[unknown]");
+      }
+
+      stacks[strings::join(";", frames)]++;
+    }
+  }
+
+  std::ostringstream out;
+
+  typedef std::map<std::string, long>::value_type Stack;
+  foreach (const Stack& stack, stacks) {
+    out << stack.first << " " << stack.second << "\n";
+  }
+
+  return out.str();
+}
+
+
+// File to dump the samples to at exit (see 'initialize').
+static std::string* output = NULL;
+
+
+static void dump()
+{
+  if (sampling) {
+    stop();
+  }
+
+  Try<Nothing> write = os::write(*output, collapsed());
+  if (write.isError()) {
+    LOG(ERROR) << "Failed to write profile to '" << *output << "': "
+               << write.error();
+  }
+}
+
+
+void initialize()
+{
+  const std::string path =
+    java::lang::System::getProperty("jsl.profiler");
+
+  if (path.empty() || output != NULL) {
+    return;
+  }
+
+  Try<Nothing> start = jsl::profiler::start();
+  if (start.isError()) {
+    LOG(ERROR) << "Failed to start profiler: " << start.error();
+    return;
+  }
+
+  output = new std::string(path);
+
+  // Note that we register after the Jvm (which deletes itself at
+  // exit) so we get to dump the samples before it's gone.
+  atexit(&dump);
+}
+
+} // namespace profiler {
+} // namespace jsl {
@@ -0,0 +1,324 @@
+#include <cxxabi.h> // For abi::__cxa_demangle.
+#include <dlfcn.h>
+#include <execinfo.h> // For backtrace.
+#include <jni.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h> // For atexit, free.
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/os.hpp>
+#include <stout/strings.hpp>
+
+#include <jvm.hpp>
+
+#include <java/lang.hpp>
+
+#include <jsl/references.hpp>
+
+namespace jsl {
+namespace references {
+
+// Live and created references per call stack.
+struct Counts
+{
+  Counts() : live(0), created(0) {}
+
+  long live;
+  long created;
+};
+
+typedef std::map<std::vector<void*>, Counts> Stacks;
+
+
+namespace internal {
+
+volatile bool tracking = false;
+
+} // namespace internal {
+
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// The following are protected by 'mutex' (and allocated on the heap
+// since references might get created during static initialization).
+static size_t depth = 0;
+static Stacks* stacks = NULL;
+static hashmap<jobject, Stacks::iterator>* tracked = NULL;
+
+
+void start(size_t _depth)
+{
+  // Note that the first call to 'backtrace' might allocate (it loads
+  // libgcc_s), which we'd rather not do while holding the lock.
+  void* pcs[1];
+  backtrace(pcs, 1);
+
+  pthread_mutex_lock(&mutex);
+
+  depth = _depth;
+
+  if (stacks == NULL) {
+    stacks = new Stacks();
+    tracked = new hashmap<jobject, Stacks::iterator>();
+  }
+
+  internal::tracking = true;
+
+  pthread_mutex_unlock(&mutex);
+}
+
+
+void stop()
+{
+  pthread_mutex_lock(&mutex);
+
+  internal::tracking = false;
+
+  if (stacks != NULL) {
+    tracked->clear();
+    stacks->clear();
+  }
+
+  pthread_mutex_unlock(&mutex);
+}
+
+
+void internal::created(jobject reference)
+{
+  // Capture one more frame than requested to skip this one.
+  void* pcs[64];
+  const int size = backtrace(pcs, std::min(depth + 1, (size_t) 64));
+
+  if (size <= 1) {
+    return;
+  }
+
+  const std::vector<void*> stack(pcs + 1, pcs + size);
+
+  pthread_mutex_lock(&mutex);
+
+  // Tracking might have been stopped since it was checked.
+  if (internal::tracking) {
+    Stacks::iterator iterator =
+      stacks->insert(std::make_pair(stack, Counts())).first;
+
+    iterator->second.live++;
+    iterator->second.created++;
+
+    (*tracked)[reference] = iterator;
+  }
+
+  pthread_mutex_unlock(&mutex);
+}
+
+
+void internal::deleted(jobject reference)
+{
+  pthread_mutex_lock(&mutex);
+
+  if (internal::tracking) {
+    hashmap<jobject, Stacks::iterator>::iterator iterator =
+      tracked->find(reference);
+
+    // Ignore references created before we started tracking.
+    if (iterator != tracked->end()) {
+      iterator->second->second.live--;
+      tracked->erase(iterator);
+    }
+  }
+
+  pthread_mutex_unlock(&mutex);
+}
+
+
+long live()
+{
+  pthread_mutex_lock(&mutex);
+  long live = tracked != NULL ? tracked->size() : 0;
+  pthread_mutex_unlock(&mutex);
+  return live;
+}
+
+
+// Returns the (demangled) name of the function containing 'pc', or
+// the name of its library and the offset if it has no symbol.
+static std::string symbolize(void* pc)
+{
+  Dl_info info;
+  if (dladdr(pc, &info) == 0) {
+    std::ostringstream out;
+    out << pc;
+    return out.str();
+  }
+
+  if (info.dli_sname == NULL) {
+    std::string library = info.dli_fname != NULL ? info.dli_fname : "?";
+    library = library.substr(library.find_last_of('/') + 1);
+
+    std::ostringstream out;
+    out << library << "+0x" << std::hex
+        << ((uintptr_t) pc - (uintptr_t) info.dli_fbase);
+    return out.str();
+  }
+
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(info.dli_sname, NULL, NULL, &status);
+
+  if (status != 0 || demangled == NULL) {
+    return info.dli_sname;
+  }
+
+  std::string result = demangled;
+  free(demangled);
+  return result;
+}
+
+
+// Returns true if the frame is part of creating a global reference
+// rather than the site that wanted one.
+static bool creating(const std::string& name)
+{
+  return strings::startsWith(name, "Jvm::") ||
+    strings::startsWith(name, "java::lang::Object::");
+}
+
+
+static bool compare(const Site& left, const Site& right)
+{
+  if (left.live != right.live) {
+    return left.live > right.live;
+  }
+  return left.created > right.created;
+}
+
+
+std::vector<Site> sites()
+{
+  // Copy the counts so we don't symbolize while holding the lock.
+  std::vector<std::pair<std::vector<void*>, Counts> > copy;
+
+  pthread_mutex_lock(&mutex);
+  if (stacks != NULL) {
+    copy.assign(stacks->begin(), stacks->end());
+  }
+  pthread_mutex_unlock(&mutex);
+
+  std::map<std::vector<std::string>, Site> merged;
+  std::map<void*, std::string> names;
+
+  for (size_t i = 0; i < copy.size(); i++) {
+    std::vector<std::string> frames;
+    foreach (void* pc, copy[i].first) {
+      if (names.count(pc) == 0) {
+        names[pc] = symbolize(pc);
+      }
+      if (!frames.empty() || !creating(names[pc])) {
+        frames.push_back(names[pc]);
+      }
+    }
+
+    if (frames.empty()) {
+      frames.push_back("[unknown]");
+    }
+
+    if (merged.count(frames) == 0) {
+      Site site;
+      site.name = frames[0];
+      site.callers.assign(frames.begin() + 1, frames.end());
+      site.live = 0;
+      site.created = 0;
+      merged[frames] = site;
+    }
+
+    merged[frames].live += copy[i].second.live;
+    merged[frames].created += copy[i].second.created;
+  }
+
+  std::vector<Site> sites;
+
+  typedef std::map<std::vector<std::string>, Site>::value_type Merged;
+  foreach (const Merged& site, merged) {
+    sites.push_back(site.second);
+  }
+
+  std::sort(sites.begin(), sites.end(), &compare);
+
+  return sites;
+}
+
+
+std::string report()
+{
+  std::ostringstream out;
+
+  std::vector<Site> sites = jsl::references::sites();
+
+  long live = 0;
+  foreach (const Site& site, sites) {
+    live += site.live;
+  }
+
+  out << live << " live global references\n";
+
+  foreach (const Site& site, sites) {
+    if (site.live > 0) {
+      out << "\n" << site.live << " live (" << site.created << " created) "
+          << "at " << site.name << "\n";
+      foreach (const std::string& caller, site.callers) {
+        out << "    from " << caller << "\n";
+      }
+    }
+  }
+
+  return out.str();
+}
+
+
+// File to write the report to at exit (see 'initialize').
+static std::string* output = NULL;
+
+
+static void dump()
+{
+  const std::string report = jsl::references::report();
+
+  Try<Nothing> write = os::write(*output, report);
+  if (write.isError()) {
+    LOG(ERROR) << "Failed to write global references to '" << *output
+               << "': " << write.error();
+  }
+
+  stop();
+}
+
+
+void initialize()
+{
+  const std::string path =
+    java::lang::System::getProperty("jsl.references");
+
+  if (path.empty() || output != NULL) {
+    return;
+  }
+
+  start();
+
+  output = new std::string(path);
+
+  // Note that we register after the Jvm (which deletes itself at
+  // exit) so we get to report before it's gone.
+  atexit(&dump);
+}
+
+} // namespace references {
+} // namespace jsl {
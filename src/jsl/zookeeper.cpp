@@ -0,0 +1,1260 @@
+#include <errno.h>
+#include <jni.h>
+#include <netinet/in.h>
+#include <string.h> // For memset.
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <arpa/inet.h>
+
+#include <glog/logging.h>
+
+#include <string>
+#include <vector>
+
+#include <stout/duration.hpp>
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/json.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/proc.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+
+#include <java/io.hpp>
+#include <java/lang.hpp>
+#include <java/net.hpp>
+#include <java/util.hpp>
+
+#include <jsl/management.hpp>
+#include <jsl/zookeeper.hpp>
+
+#include <org/apache/zookeeper.hpp>
+
+using org::apache::zookeeper::persistence::FileTxnLog;
+using org::apache::zookeeper::persistence::FileTxnSnapLog;
+using org::apache::zookeeper::server::DataTree;
+using org::apache::zookeeper::server::ZKDatabase;
+using org::apache::zookeeper::server::NIOServerCnxn;
+using org::apache::zookeeper::server::SyncRequestProcessor;
+using org::apache::zookeeper::server::ZooKeeperServer;
+using org::apache::zookeeper::server::quorum::QuorumPeer;
+
+namespace jsl {
+namespace zookeeper {
+
+// Returns a currently unused loopback port (by binding to port 0 and
+// letting the kernel pick). There is an inherent race with anybody
+// else picking ports but that's acceptable for tests.
+static Try<int> port()
+{
+  int s = ::socket(AF_INET, SOCK_STREAM, 0);
+  if (s < 0) {
+    return ErrnoError("Failed to create socket");
+  }
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+
+  socklen_t length = sizeof(addr);
+
+  if (::bind(s, (sockaddr*) &addr, sizeof(addr)) < 0 ||
+      ::getsockname(s, (sockaddr*) &addr, &length) < 0) {
+    ErrnoError error("Failed to pick a port");
+    ::close(s);
+    return error;
+  }
+
+  ::close(s);
+
+  return ntohs(addr.sin_port);
+}
+
+
+Quorum::Quorum(
+    int size,
+    const Option<std::string>& _directory,
+    const Duration& _tickTime)
+  : tickTime(_tickTime)
+{
+  CHECK_GT(size, 0);
+
+  // Prefer tmpfs so that snapshots and transaction logs (and their
+  // fsyncs) never touch a disk.
+  std::string parent = _directory.isSome()
+    ? _directory.get()
+    : (os::isdir("/dev/shm") ? "/dev/shm" : "/tmp");
+
+  Try<std::string> mkdtemp = os::mkdtemp(path::join(parent, "quorum_XXXXXX"));
+  CHECK(mkdtemp.isSome())
+    << "Failed to create directory for quorum: " << mkdtemp.error();
+
+  directory = mkdtemp.get();
+
+  for (int id = 1; id <= size; id++) {
+    Try<int> clientPort = port();
+    Try<int> quorumPort = port();
+    Try<int> electionPort = port();
+
+    CHECK(clientPort.isSome() && quorumPort.isSome() && electionPort.isSome())
+      << "Failed to pick ports for quorum peer " << id;
+
+    Peer peer;
+    peer.id = id;
+    peer.clientPort = clientPort.get();
+    peer.quorumPort = quorumPort.get();
+    peer.electionPort = electionPort.get();
+    peer.directory = path::join(directory, "peer" + stringify(id));
+    peer.peer = NULL;
+
+    Try<Nothing> mkdir = os::mkdir(peer.directory);
+    CHECK(mkdir.isSome())
+      << "Failed to create directory for quorum peer " << id
+      << ": " << mkdir.error();
+
+    peers.push_back(peer);
+  }
+}
+
+
+Quorum::~Quorum()
+{
+  foreach (const Peer& peer, peers) {
+    if (peer.peer != NULL) {
+      kill(peer.id);
+    }
+  }
+
+  Try<Nothing> rmdir = os::rmdir(directory);
+  if (rmdir.isError()) {
+    LOG(WARNING) << "Failed to remove '" << directory << "': " << rmdir.error();
+  }
+}
+
+
+Try<Duration> Quorum::start(const Duration& timeout)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  for (size_t i = 0; i < peers.size(); i++) {
+    if (peers[i].peer == NULL) {
+      launch(&peers[i]);
+    }
+  }
+
+  Try<Nothing> await = this->await(timeout);
+  if (await.isError()) {
+    return Error(await.error());
+  }
+
+  return stopwatch.elapsed();
+}
+
+
+Try<Nothing> Quorum::kill(int id)
+{
+  Peer* peer = find(id);
+
+  if (peer == NULL) {
+    return Error("Unknown quorum peer " + stringify(id));
+  } else if (peer->peer == NULL) {
+    return Error("Quorum peer " + stringify(id) + " is not running");
+  }
+
+  peer->peer->shutdown();
+  peer->peer->join(static_cast<int64_t>(Seconds(10).ms()));
+
+  bool alive = peer->peer->isAlive();
+
+  delete peer->peer;
+  peer->peer = NULL;
+
+  if (alive) {
+    return Error("Quorum peer " + stringify(id) + " failed to exit");
+  }
+
+  return Nothing();
+}
+
+
+Try<Duration> Quorum::restart(int id, const Duration& timeout)
+{
+  Peer* peer = find(id);
+
+  if (peer == NULL) {
+    return Error("Unknown quorum peer " + stringify(id));
+  } else if (peer->peer != NULL) {
+    return Error("Quorum peer " + stringify(id) + " is still running");
+  }
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  launch(peer);
+
+  Try<Nothing> await = this->await(timeout);
+  if (await.isError()) {
+    return Error(await.error());
+  }
+
+  return stopwatch.elapsed();
+}
+
+
+Option<int> Quorum::leader()
+{
+  foreach (const Peer& peer, peers) {
+    if (peer.peer != NULL && peer.peer->getServerState() == "LEADING") {
+      return peer.id;
+    }
+  }
+
+  return None();
+}
+
+
+std::string Quorum::connectString() const
+{
+  std::string result;
+
+  foreach (const Peer& peer, peers) {
+    if (peer.peer != NULL) {
+      if (!result.empty()) {
+        result += ",";
+      }
+      result += "127.0.0.1:" + stringify(peer.clientPort);
+    }
+  }
+
+  return result;
+}
+
+
+int Quorum::clientPort(int id) const
+{
+  foreach (const Peer& peer, peers) {
+    if (peer.id == id) {
+      return peer.clientPort;
+    }
+  }
+
+  LOG(FATAL) << "Unknown quorum peer " << id;
+  return -1;
+}
+
+
+void Quorum::launch(Peer* peer)
+{
+  CHECK(peer->peer == NULL);
+
+  // Every peer needs the full view of the quorum.
+  java::util::HashMap servers;
+  foreach (const Peer& other, peers) {
+    servers.put(
+        java::lang::Long(other.id),
+        QuorumPeer::QuorumServer(
+            other.id,
+            java::net::InetSocketAddress("127.0.0.1", other.quorumPort),
+            java::net::InetSocketAddress("127.0.0.1", other.electionPort)));
+  }
+
+  java::io::File dataDir(peer->directory);
+
+  NIOServerCnxn::Factory factory(
+      java::net::InetSocketAddress("127.0.0.1", peer->clientPort));
+
+  const int tickTime = static_cast<int>(this->tickTime.ms());
+
+  peer->peer = new QuorumPeer(
+      servers,
+      dataDir,
+      dataDir,
+      QuorumPeer::FAST_LEADER_ELECTION,
+      peer->id,
+      tickTime,
+      10,  // initLimit (in ticks).
+      5,   // syncLimit (in ticks).
+      factory);
+
+  peer->peer->start();
+}
+
+
+Try<Nothing> Quorum::await(const Duration& timeout)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  do {
+    int leaders = 0;
+    int followers = 0;
+    int running = 0;
+
+    foreach (const Peer& peer, peers) {
+      if (peer.peer != NULL) {
+        running++;
+        const std::string& state = peer.peer->getServerState();
+        if (state == "LEADING") {
+          leaders++;
+        } else if (state == "FOLLOWING") {
+          followers++;
+        }
+      }
+    }
+
+    if (leaders == 1 && leaders + followers == running) {
+      return Nothing();
+    }
+
+    os::sleep(Milliseconds(10));
+  } while (stopwatch.elapsed() < timeout);
+
+  return Error("Timed out waiting for the quorum to form");
+}
+
+
+Quorum::Peer* Quorum::find(int id)
+{
+  for (size_t i = 0; i < peers.size(); i++) {
+    if (peers[i].id == id) {
+      return &peers[i];
+    }
+  }
+
+  return NULL;
+}
+
+
+Server::Options::Options()
+  : tickTime(Milliseconds(3000)),
+    maxClientCnxns(10),
+    preAllocSize(64 * 1024 * 1024),
+    snapCount(100000),
+    forceSync(true),
+    tmpfs(false) {}
+
+
+Server::Options Server::Options::ephemeral()
+{
+  Options options;
+  options.tickTime = Milliseconds(500); // Allows up to 10 second sessions.
+  options.maxClientCnxns = 0;
+  options.preAllocSize = 64 * 1024;
+  options.forceSync = false;
+  options.tmpfs = true;
+  return options;
+}
+
+
+// Returns the number of threads in this process.
+static Try<long> threads()
+{
+  Try<proc::ProcessStatus> status = proc::status(getpid());
+  if (status.isError()) {
+    return Error(status.error());
+  }
+  return status.get().num_threads;
+}
+
+
+// Returns the number of open file descriptors in this process.
+static size_t fds()
+{
+  return os::ls("/proc/self/fd").size();
+}
+
+
+// ZooKeeper reads 'zookeeper.forceSync' once (when 'FileTxnLog' gets
+// initialized) so we remember what the first server asked for.
+static Option<bool> forceSync;
+
+
+Server::Server(const Options& _options)
+  : options(_options),
+    server(NULL),
+    factory(NULL),
+    txnLogFactory(NULL),
+    _port(-1),
+    threads(-1),
+    fds(0)
+{
+  std::string parent = "/tmp";
+  if (options.directory.isSome()) {
+    parent = options.directory.get();
+  } else if (options.tmpfs) {
+    if (os::isdir("/dev/shm")) {
+      parent = "/dev/shm";
+    } else {
+      LOG(WARNING) << "No tmpfs at /dev/shm, using /tmp for ZooKeeper data";
+    }
+  }
+
+  Try<std::string> mkdtemp =
+    os::mkdtemp(path::join(parent, "zookeeper_XXXXXX"));
+  CHECK(mkdtemp.isSome())
+    << "Failed to create directory for ZooKeeper: " << mkdtemp.error();
+
+  directory = mkdtemp.get();
+}
+
+
+Server::~Server()
+{
+  if (server != NULL) {
+    Try<Nothing> shutdown = this->shutdown();
+    if (shutdown.isError()) {
+      LOG(WARNING) << "Failed to shut down ZooKeeper server gracefully: "
+                   << shutdown.error();
+    }
+  }
+
+  Try<Nothing> rmdir = os::rmdir(directory);
+  if (rmdir.isError()) {
+    LOG(WARNING) << "Failed to remove '" << directory << "': " << rmdir.error();
+  }
+}
+
+
+Try<Duration> Server::start()
+{
+  if (server != NULL) {
+    return Error("ZooKeeper server is already running");
+  }
+
+  // Take the baseline before the server creates any threads or opens
+  // any files (a failure to read the thread count skips that check).
+  Try<long> threads = jsl::zookeeper::threads();
+  this->threads = threads.isSome() ? threads.get() : -1;
+  this->fds = jsl::zookeeper::fds();
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  if (forceSync.isNone()) {
+    java::lang::System::setProperty(
+        "zookeeper.forceSync", options.forceSync ? "yes" : "no");
+    forceSync = options.forceSync;
+  } else if (forceSync.get() != options.forceSync) {
+    LOG(WARNING) << "Ignoring forceSync=" << options.forceSync
+                 << " since ZooKeeper already uses forceSync="
+                 << forceSync.get();
+  }
+
+  FileTxnLog::setPreallocSize(options.preAllocSize);
+  SyncRequestProcessor::setSnapCount(options.snapCount);
+
+  java::io::File dataDir(directory);
+  txnLogFactory = new FileTxnSnapLog(dataDir, dataDir);
+
+  server = new ZooKeeperServer(
+      *txnLogFactory,
+      ZooKeeperServer::BasicDataTreeBuilder());
+
+  server->setTickTime(static_cast<int>(options.tickTime.ms()));
+
+  factory = new NIOServerCnxn::Factory(
+      java::net::InetSocketAddress("127.0.0.1", 0),
+      options.maxClientCnxns);
+
+  factory->startup(*server);
+
+  _port = server->getClientPort();
+
+  return stopwatch.elapsed();
+}
+
+
+Try<Nothing> Server::shutdown(const Duration& timeout)
+{
+  CHECK(server != NULL) << "ZooKeeper server is not running";
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  std::vector<std::string> errors;
+
+  Try<Nothing> closed = closeSessions(timeout);
+  if (closed.isError()) {
+    errors.push_back(closed.error());
+  }
+
+  // Closes the connections and joins the factory's thread, then
+  // shuts down the server (which joins its request processors after
+  // they flushed the transaction log).
+  factory->shutdown();
+
+  // The server never closes these itself.
+  txnLogFactory->close();
+
+  delete factory;
+  factory = NULL;
+
+  delete server;
+  server = NULL;
+
+  delete txnLogFactory;
+  txnLogFactory = NULL;
+
+  _port = -1;
+
+  // Some threads (e.g., the session tracker's) exit asynchronously
+  // after being shut down, so poll until we're back to the baseline.
+  while (true) {
+    Try<long> threads = jsl::zookeeper::threads();
+    size_t fds = jsl::zookeeper::fds();
+
+    bool done = (this->threads < 0 || threads.isError() ||
+                 threads.get() <= this->threads) && fds <= this->fds;
+
+    if (done) {
+      break;
+    } else if (stopwatch.elapsed() >= timeout) {
+      errors.push_back(
+          "Leaked " +
+          stringify(threads.isSome() ? threads.get() - this->threads : 0) +
+          " threads and " + stringify((long) fds - (long) this->fds) +
+          " file descriptors");
+      break;
+    }
+
+    os::sleep(Milliseconds(1));
+  }
+
+  if (!errors.empty()) {
+    return Error(strings::join("; ", errors));
+  }
+
+  return Nothing();
+}
+
+
+int Server::port() const
+{
+  CHECK(server != NULL) << "ZooKeeper server is not running";
+  return _port;
+}
+
+
+std::string Server::connectString() const
+{
+  return "127.0.0.1:" + stringify(port());
+}
+
+
+Try<Nothing> Server::closeSessions(const Duration& timeout)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  // Free our local references, we might be on a native thread which
+  // doesn't return to Java (and we poll below).
+  JNI::Frame frame;
+
+  ZKDatabase database = server->getZKDatabase();
+
+  foreach (int64_t session, database.getSessions()) {
+    server->closeSession(session);
+  }
+
+  // The sessions are gone once the requests to close them made it
+  // through the request processors.
+  while (true) {
+    {
+      JNI::Frame poll; // Free the local references of each poll.
+      if (database.getSessions().empty()) {
+        break;
+      }
+    }
+    if (stopwatch.elapsed() >= timeout) {
+      return Error("Timed out closing sessions");
+    }
+    os::sleep(Milliseconds(1));
+  }
+
+  return Nothing();
+}
+
+
+ZooKeeperServer Server::zooKeeperServer() const
+{
+  CHECK(server != NULL) << "ZooKeeper server is not running";
+  return *server;
+}
+
+
+JSON::Object json(const Statistics& statistics)
+{
+  JSON::Object object;
+
+  object.values["timestamp"] = JSON::Number(statistics.timestamp);
+  object.values["min_latency"] = JSON::Number(statistics.minLatency);
+  object.values["avg_latency"] = JSON::Number(statistics.avgLatency);
+  object.values["max_latency"] = JSON::Number(statistics.maxLatency);
+
+  object.values["outstanding_requests"] =
+    JSON::Number(statistics.outstandingRequests);
+  object.values["packets_sent"] = JSON::Number(statistics.packetsSent);
+  object.values["packets_received"] = JSON::Number(statistics.packetsReceived);
+  object.values["packets_sent_per_second"] =
+    JSON::Number(statistics.packetsSentPerSecond);
+  object.values["packets_received_per_second"] =
+    JSON::Number(statistics.packetsReceivedPerSecond);
+
+  object.values["node_count"] = JSON::Number(statistics.nodeCount);
+  object.values["approximate_data_size"] =
+    JSON::Number(statistics.approximateDataSize);
+  object.values["watch_count"] = JSON::Number(statistics.watchCount);
+
+  return object;
+}
+
+
+Sampler::Sampler(
+    const org::apache::zookeeper::server::ZooKeeperServer& _server,
+    const Duration& _interval,
+    size_t _capacity,
+    bool _dataSize)
+  : server(_server),
+    stats(server.serverStats()),
+    interval(_interval),
+    capacity(_capacity),
+    dataSize(_dataSize),
+    running(true)
+{
+  CHECK_GT(capacity, 0u);
+
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond, NULL);
+
+  CHECK_EQ(0, pthread_create(&thread, NULL, &Sampler::run, this));
+}
+
+
+Sampler::~Sampler()
+{
+  pthread_mutex_lock(&mutex);
+  running = false;
+  pthread_cond_signal(&cond);
+  pthread_mutex_unlock(&mutex);
+
+  CHECK_EQ(0, pthread_join(thread, NULL));
+
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mutex);
+}
+
+
+Option<Statistics> Sampler::latest()
+{
+  Option<Statistics> result;
+
+  pthread_mutex_lock(&mutex);
+  if (!samples.empty()) {
+    result = samples.back();
+  }
+  pthread_mutex_unlock(&mutex);
+
+  return result;
+}
+
+
+JSON::Array Sampler::history()
+{
+  JSON::Array array;
+
+  pthread_mutex_lock(&mutex);
+  foreach (const Statistics& statistics, samples) {
+    array.values.push_back(json(statistics));
+  }
+  pthread_mutex_unlock(&mutex);
+
+  return array;
+}
+
+
+void* Sampler::run(void* that)
+{
+  Sampler* sampler = static_cast<Sampler*>(that);
+
+  // Stay attached to the JVM for the life of the thread rather than
+  // attaching and detaching for each call.
+  JNI::Env env;
+
+  Option<Statistics> previous;
+
+  pthread_mutex_lock(&sampler->mutex);
+
+  while (sampler->running) {
+    pthread_mutex_unlock(&sampler->mutex);
+
+    Statistics statistics;
+    {
+      // Free the local references of each sample, this thread never
+      // returns to Java.
+      JNI::Frame frame;
+      statistics = sampler->sample(previous);
+    }
+    previous = statistics;
+
+    pthread_mutex_lock(&sampler->mutex);
+
+    sampler->samples.push_back(statistics);
+    if (sampler->samples.size() > sampler->capacity) {
+      sampler->samples.pop_front();
+    }
+
+    // Wait for the next interval (or until we're stopped).
+    timeval now;
+    gettimeofday(&now, NULL);
+
+    const double deadline =
+      now.tv_sec + now.tv_usec / 1000000.0 + sampler->interval.secs();
+
+    timespec timeout;
+    timeout.tv_sec = static_cast<time_t>(deadline);
+    timeout.tv_nsec = static_cast<long>((deadline - timeout.tv_sec) * 1e9);
+
+    while (sampler->running &&
+           pthread_cond_timedwait(
+               &sampler->cond, &sampler->mutex, &timeout) != ETIMEDOUT);
+  }
+
+  pthread_mutex_unlock(&sampler->mutex);
+
+  return NULL;
+}
+
+
+Statistics Sampler::sample(const Option<Statistics>& previous)
+{
+  Statistics statistics;
+
+  statistics.timestamp = jsl::management::now();
+
+  statistics.minLatency = stats.getMinLatency();
+  statistics.avgLatency = stats.getAvgLatency();
+  statistics.maxLatency = stats.getMaxLatency();
+  statistics.outstandingRequests = stats.getOutstandingRequests();
+  statistics.packetsSent = stats.getPacketsSent();
+  statistics.packetsReceived = stats.getPacketsReceived();
+
+  statistics.packetsSentPerSecond = 0;
+  statistics.packetsReceivedPerSecond = 0;
+
+  if (previous.isSome()) {
+    const double elapsed = statistics.timestamp - previous.get().timestamp;
+    if (elapsed > 0) {
+      statistics.packetsSentPerSecond =
+        (statistics.packetsSent - previous.get().packetsSent) / elapsed;
+      statistics.packetsReceivedPerSecond =
+        (statistics.packetsReceived - previous.get().packetsReceived) / elapsed;
+    }
+  }
+
+  DataTree tree = server.getZKDatabase().getDataTree();
+  statistics.nodeCount = tree.getNodeCount();
+  statistics.approximateDataSize = dataSize ? tree.approximateDataSize() : 0;
+  statistics.watchCount = tree.getWatchCount();
+
+  return statistics;
+}
+
+
+static std::vector<std::string> watcherMethods()
+{
+  return std::vector<std::string>(1, "process");
+}
+
+
+Watcher::Watcher()
+  : _watcher(proxy("org/apache/zookeeper/Watcher", watcherMethods())),
+    _coalesced(0)
+{
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond, NULL);
+}
+
+
+Watcher::~Watcher()
+{
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mutex);
+}
+
+
+Option<Watcher::Event> Watcher::next(const Duration& timeout)
+{
+  timeval now;
+  gettimeofday(&now, NULL);
+
+  const double deadline =
+    now.tv_sec + now.tv_usec / 1000000.0 + timeout.secs();
+
+  timespec abstime;
+  abstime.tv_sec = static_cast<time_t>(deadline);
+  abstime.tv_nsec = static_cast<long>((deadline - abstime.tv_sec) * 1e9);
+
+  Option<Event> result;
+
+  pthread_mutex_lock(&mutex);
+
+  while (events.empty() &&
+         pthread_cond_timedwait(&cond, &mutex, &abstime) != ETIMEDOUT);
+
+  if (!events.empty()) {
+    const Event& event = events.front();
+    if (!event.path.empty()) {
+      queued.erase(std::make_pair(event.type, event.path));
+    }
+    result = event;
+    events.pop_front();
+  }
+
+  pthread_mutex_unlock(&mutex);
+
+  return result;
+}
+
+
+size_t Watcher::size()
+{
+  pthread_mutex_lock(&mutex);
+  size_t size = events.size();
+  pthread_mutex_unlock(&mutex);
+  return size;
+}
+
+
+jobject Watcher::invoke(JNIEnv* env, int method, jobjectArray args)
+{
+  CHECK_EQ(0, method); // Only 'process'.
+
+  jobject object = env->GetObjectArrayElement(args, 0);
+  org::apache::zookeeper::WatchedEvent watchedEvent(object);
+  env->DeleteLocalRef(object);
+
+  Event event;
+  event.type = watchedEvent.getType().getIntValue();
+  event.state = watchedEvent.getState().getIntValue();
+  event.path = watchedEvent.getPath();
+
+  pthread_mutex_lock(&mutex);
+
+  if (event.path.empty() ||
+      queued.insert(std::make_pair(event.type, event.path)).second) {
+    events.push_back(event);
+    pthread_cond_signal(&cond);
+  } else {
+    _coalesced++; // Only written with 'mutex' held.
+  }
+
+  pthread_mutex_unlock(&mutex);
+
+  return NULL;
+}
+
+
+// Methods of the interfaces implemented by the Client's proxy, in the
+// order they are passed to the proxy (i.e., the 'method' index). All
+// of the callback interfaces name their method 'processResult'.
+enum
+{
+  PROCESS_RESULT,
+  PROCESS
+};
+
+
+static std::vector<std::string> interfaces()
+{
+  std::vector<std::string> interfaces;
+  interfaces.push_back("org/apache/zookeeper/AsyncCallback$StringCallback");
+  interfaces.push_back("org/apache/zookeeper/AsyncCallback$DataCallback");
+  interfaces.push_back("org/apache/zookeeper/AsyncCallback$StatCallback");
+  interfaces.push_back("org/apache/zookeeper/AsyncCallback$ChildrenCallback");
+  interfaces.push_back("org/apache/zookeeper/Watcher");
+  return interfaces;
+}
+
+
+static std::vector<std::string> methods()
+{
+  std::vector<std::string> methods;
+  methods.push_back("processResult");
+  methods.push_back("process");
+  return methods;
+}
+
+
+// Returns the value of a (boxed) 'java.lang.Integer'.
+static int intValue(jobject integer)
+{
+  static Jvm::Method method = Jvm::get()->findMethod(
+      Jvm::Class::named("java/lang/Integer")
+      .method("intValue")
+      .nonvirtual() // Integer is final.
+      .returns(Jvm::Class::INT));
+
+  return Jvm::get()->invoke<int>(integer, method);
+}
+
+
+// Returns the strings in a 'java.util.List<String>'.
+static std::vector<std::string> children(jobject list)
+{
+  static Jvm::Method method = Jvm::get()->findMethod(
+      Jvm::Class::named("java/util/List")
+      .method("toArray")
+      .returns(Jvm::Class::named("java/lang/Object").arrayOf()));
+
+  return Jvm::get()->strings(
+      static_cast<jobjectArray>(Jvm::get()->invoke<jobject>(list, method)));
+}
+
+
+static Option<Client::Stat> stat(jobject object)
+{
+  if (object == NULL) {
+    return None(); // E.g., the node does not exist.
+  }
+
+  org::apache::zookeeper::data::Stat s(object);
+
+  Client::Stat result;
+  result.mzxid = s.getMzxid();
+  result.version = s.getVersion();
+  result.dataLength = s.getDataLength();
+  result.numChildren = s.getNumChildren();
+  result.ephemeralOwner = s.getEphemeralOwner();
+  return result;
+}
+
+
+Client::Client(
+    const std::string& servers,
+    const Duration& _sessionTimeout,
+    Watcher* _watcher)
+  : sessionTimeout(_sessionTimeout),
+    watcher(_watcher),
+    handler(new Handler(this)),
+    callbacks(handler->proxy(interfaces(), methods())),
+    stringCallback(callbacks),
+    dataCallback(callbacks),
+    statCallback(callbacks),
+    childrenCallback(callbacks),
+    acl(org::apache::zookeeper::ZooDefs::Ids::OPEN_ACL_UNSAFE()),
+    zk(servers,
+       static_cast<int>(_sessionTimeout.ms()),
+       _watcher != NULL
+       ? _watcher->watcher()
+       : org::apache::zookeeper::Watcher(callbacks)),
+    completing(0)
+{
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&cond, NULL);
+}
+
+
+Client::~Client()
+{
+  const int64_t session = zk.getSessionId();
+
+  if (!await(sessionTimeout)) {
+    LOG(WARNING) << "Closing ZooKeeper session " << session
+                 << " with " << outstanding() << " outstanding operations";
+  }
+
+  zk.close();
+
+  // Closing fails the outstanding operations (e.g., with a connection
+  // loss), give their callbacks a chance to run.
+  if (!await(sessionTimeout)) {
+    LOG(WARNING) << "Dropping the callbacks of " << outstanding()
+                 << " operations of closed ZooKeeper session " << session;
+  }
+
+  // The proxy might still get invoked, but no longer calls into us.
+  handler->detach();
+
+  pthread_cond_destroy(&cond);
+  pthread_mutex_destroy(&mutex);
+}
+
+
+void Client::create(
+    const std::string& path,
+    const std::string& data,
+    const org::apache::zookeeper::CreateMode& mode,
+    const Callback& callback)
+{
+  issue(CREATE, path, callback);
+  try {
+    zk.create(path, data, acl, mode, stringCallback, java::lang::Object());
+  } catch (...) {
+    issued(false);
+    throw;
+  }
+  issued(true);
+}
+
+
+void Client::getData(
+    const std::string& path,
+    const Callback& callback,
+    bool watch)
+{
+  CHECK(!watch || watcher != NULL) << "Watches require a watcher";
+
+  issue(GET_DATA, path, callback);
+  try {
+    zk.getData(path, watch, dataCallback, java::lang::Object());
+  } catch (...) {
+    issued(false);
+    throw;
+  }
+  issued(true);
+}
+
+
+void Client::setData(
+    const std::string& path,
+    const std::string& data,
+    int version,
+    const Callback& callback)
+{
+  issue(SET_DATA, path, callback);
+  try {
+    zk.setData(path, data, version, statCallback, java::lang::Object());
+  } catch (...) {
+    issued(false);
+    throw;
+  }
+  issued(true);
+}
+
+
+void Client::exists(
+    const std::string& path,
+    const Callback& callback,
+    bool watch)
+{
+  CHECK(!watch || watcher != NULL) << "Watches require a watcher";
+
+  issue(EXISTS, path, callback);
+  try {
+    zk.exists(path, watch, statCallback, java::lang::Object());
+  } catch (...) {
+    issued(false);
+    throw;
+  }
+  issued(true);
+}
+
+
+void Client::getChildren(
+    const std::string& path,
+    const Callback& callback,
+    bool watch)
+{
+  CHECK(!watch || watcher != NULL) << "Watches require a watcher";
+
+  issue(GET_CHILDREN, path, callback);
+  try {
+    zk.getChildren(path, watch, childrenCallback, java::lang::Object());
+  } catch (...) {
+    issued(false);
+    throw;
+  }
+  issued(true);
+}
+
+
+size_t Client::outstanding()
+{
+  pthread_mutex_lock(&mutex);
+  size_t size = pending.size() + completing;
+  pthread_mutex_unlock(&mutex);
+  return size;
+}
+
+
+bool Client::await(const Duration& timeout)
+{
+  timeval now;
+  gettimeofday(&now, NULL);
+
+  const double deadline =
+    now.tv_sec + now.tv_usec / 1000000.0 + timeout.secs();
+
+  timespec abstime;
+  abstime.tv_sec = static_cast<time_t>(deadline);
+  abstime.tv_nsec = static_cast<long>((deadline - abstime.tv_sec) * 1e9);
+
+  pthread_mutex_lock(&mutex);
+  while ((!pending.empty() || completing > 0) &&
+         pthread_cond_timedwait(&cond, &mutex, &abstime) != ETIMEDOUT);
+  bool empty = pending.empty() && completing == 0;
+  pthread_mutex_unlock(&mutex);
+
+  return empty;
+}
+
+
+void Client::issue(
+    Operation operation,
+    const std::string& path,
+    const Callback& callback)
+{
+  Pending pending;
+  pending.operation = operation;
+  pending.path = path;
+  pending.callback = callback;
+
+  pthread_mutex_lock(&mutex);
+  this->pending.push_back(pending);
+}
+
+
+void Client::issued(bool success)
+{
+  if (!success) {
+    pending.pop_back();
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+
+jobject Client::invoke(JNIEnv* env, int method, jobjectArray args)
+{
+  if (method != PROCESS_RESULT) {
+    return NULL; // Session events without a watcher.
+  }
+
+  // Take the oldest operation off the queue before doing anything
+  // that might throw, so a failed completion can't leave it there to
+  // be matched with the next completion. It still counts as
+  // outstanding until its callback returns (see 'await').
+  pthread_mutex_lock(&mutex);
+  CHECK(!pending.empty()) << "ZooKeeper completion without an operation";
+  const Pending operation = pending.front();
+  pending.pop_front();
+  completing++;
+  pthread_mutex_unlock(&mutex);
+
+  try {
+    complete(env, operation, args);
+  } catch (...) {
+    completed();
+    throw;
+  }
+
+  completed();
+
+  return NULL;
+}
+
+
+void Client::completed()
+{
+  pthread_mutex_lock(&mutex);
+  completing--;
+  if (pending.empty() && completing == 0) {
+    pthread_cond_broadcast(&cond);
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+
+void Client::complete(
+    JNIEnv* env,
+    const Pending& operation,
+    jobjectArray args)
+{
+  Result result;
+  result.path = operation.path;
+
+  jobject rc = env->GetObjectArrayElement(args, 0);
+  result.rc = intValue(rc);
+  env->DeleteLocalRef(rc);
+
+  // The arguments are (rc, path, ctx, ...), see 'AsyncCallback'.
+  jobject first = env->GetObjectArrayElement(args, 3);
+
+  switch (operation.operation) {
+    case CREATE:
+      result.name = Jvm::get()->string(static_cast<jstring>(first));
+      break;
+    case GET_DATA: {
+      result.data = Jvm::get()->bytes(static_cast<jbyteArray>(first));
+      jobject second = env->GetObjectArrayElement(args, 4);
+      result.stat = stat(second);
+      env->DeleteLocalRef(second);
+      break;
+    }
+    case SET_DATA:
+    case EXISTS:
+      result.stat = stat(first);
+      break;
+    case GET_CHILDREN:
+      if (first != NULL) {
+        result.children = children(first);
+      }
+      break;
+  }
+
+  env->DeleteLocalRef(first);
+
+  if (operation.callback) {
+    operation.callback(result);
+  }
+}
+
+
+Client::Handler::Handler(Client* _client)
+  : client(_client)
+{
+  pthread_mutex_init(&mutex, NULL);
+}
+
+
+void Client::Handler::detach()
+{
+  pthread_mutex_lock(&mutex);
+  client = NULL;
+  pthread_mutex_unlock(&mutex);
+}
+
+
+jobject Client::Handler::invoke(JNIEnv* env, int method, jobjectArray args)
+{
+  // Note that the mutex is held while forwarding so that 'detach'
+  // waits for the client to be done. The Java client invokes the
+  // proxy from its event thread only, so this doesn't serialize
+  // anything further.
+  pthread_mutex_lock(&mutex);
+
+  jobject result = NULL;
+
+  try {
+    if (client != NULL) {
+      result = client->invoke(env, method, args);
+    }
+  } catch (...) {
+    pthread_mutex_unlock(&mutex);
+    throw;
+  }
+
+  pthread_mutex_unlock(&mutex);
+
+  return result;
+}
+
+} // namespace zookeeper {
+} // namespace jsl {
@@ -17,6 +17,9 @@
 
 #include "java/lang.hpp" // For java::lang::Throwable.
 
+#include "jsl/profiler.hpp"
+#include "jsl/references.hpp"
+
 
 // Some compilers give us warnings about 'dereferencing type-punned
 // pointer will break strict-aliasing rules' when we cast our JNIEnv**
@@ -55,6 +58,19 @@ JNI::Env::~Env()
 }
 
 
+JNI::Frame::Frame(int capacity)
+{
+  CHECK_EQ(0, env->PushLocalFrame(capacity))
+    << "Failed to push a frame for local references";
+}
+
+
+JNI::Frame::~Frame()
+{
+  env->PopLocalFrame(NULL);
+}
+
+
 // Static storage and initialization.
 Jvm* Jvm::instance = NULL;
 
@@ -82,6 +98,9 @@ Try<Jvm*> Jvm::inject(
 
   atexit(&deleter);
 
+  jsl::profiler::initialize();
+  jsl::references::initialize();
+
   return instance;
 }
 
@@ -122,6 +141,9 @@ Try<Jvm*> Jvm::create(
 
   atexit(&deleter);
 
+  jsl::profiler::initialize();
+  jsl::references::initialize();
+
   return instance;
 }
 
@@ -166,7 +188,8 @@ Jvm::MethodFinder::MethodFinder(
     const std::string& _name)
   : clazz(_clazz),
     name(_name),
-    parameters() {}
+    parameters(),
+    isNonvirtual(false) {}
 
 
 Jvm::MethodFinder& Jvm::MethodFinder::parameter(const Class& type)
@@ -176,9 +199,17 @@ Jvm::MethodFinder& Jvm::MethodFinder::parameter(const Class& type)
 }
 
 
+Jvm::MethodFinder& Jvm::MethodFinder::nonvirtual()
+{
+  isNonvirtual = true;
+  return *this;
+}
+
+
 Jvm::MethodSignature Jvm::MethodFinder::returns(const Class& returnType) const
 {
-  return Jvm::MethodSignature(clazz, name, returnType, parameters);
+  return Jvm::MethodSignature(
+      clazz, name, returnType, parameters, isNonvirtual);
 }
 
 
@@ -186,26 +217,32 @@ Jvm::MethodSignature::MethodSignature(const MethodSignature& that)
   : clazz(that.clazz),
     name(that.name),
     returnType(that.returnType),
-    parameters(that.parameters) {}
+    parameters(that.parameters),
+    isNonvirtual(that.isNonvirtual) {}
 
 
 Jvm::MethodSignature::MethodSignature(
     const Class& _clazz,
     const std::string& _name,
     const Class& _returnType,
-    const std::vector<Class>& _parameters)
+    const std::vector<Class>& _parameters,
+    bool _isNonvirtual)
   : clazz(_clazz),
     name(_name),
     returnType(_returnType),
-    parameters(_parameters) {}
+    parameters(_parameters),
+    isNonvirtual(_isNonvirtual) {}
 
 
 Jvm::Method::Method(const Method& that)
-    : clazz(that.clazz), id(that.id) {}
+    : clazz(that.clazz), id(that.id), nonvirtual(that.nonvirtual) {}
 
 
-Jvm::Method::Method(const Class& _clazz, const jmethodID _id)
-    : clazz(_clazz), id(_id) {}
+Jvm::Method::Method(
+    const Class& _clazz,
+    const jmethodID _id,
+    const jclass _nonvirtual)
+    : clazz(_clazz), id(_id), nonvirtual(_nonvirtual) {}
 
 
 const Jvm::Class Jvm::Class::VOID = Jvm::Class("V");
@@ -236,7 +273,9 @@ Jvm::Class::Class(const std::string& _name, bool _native)
 
 const Jvm::Class Jvm::Class::arrayOf() const
 {
-  return Jvm::Class("[" + name, native);
+  // An array's name is also its signature (e.g., '[Ljava/lang/String;')
+  // so we treat it like a native type to avoid wrapping it in 'L...;'.
+  return Jvm::Class("[" + signature(), true);
 }
 
 
@@ -273,6 +312,147 @@ jstring Jvm::string(const std::string& s)
 }
 
 
+std::string Jvm::string(jstring s)
+{
+  JNI::Env env;
+
+  if (s == NULL) {
+    return "";
+  }
+
+  const char* chars = env->GetStringUTFChars(s, NULL);
+  check(env);
+
+  std::string result(chars, env->GetStringUTFLength(s));
+  env->ReleaseStringUTFChars(s, chars);
+
+  return result;
+}
+
+
+jobjectArray Jvm::strings(const std::vector<std::string>& strings)
+{
+  JNI::Env env;
+
+  const jclass clazz = findClass(Jvm::Class::STRING);
+
+  jobjectArray array = env->NewObjectArray(strings.size(), clazz, NULL);
+
+  env->DeleteLocalRef(clazz);
+
+  check(env);
+
+  for (size_t i = 0; i < strings.size(); i++) {
+    jstring s = env->NewStringUTF(strings[i].c_str());
+    check(env);
+    env->SetObjectArrayElement(array, i, s);
+    env->DeleteLocalRef(s);
+  }
+
+  return array;
+}
+
+
+std::vector<std::string> Jvm::strings(jobjectArray array)
+{
+  JNI::Env env;
+
+  std::vector<std::string> result;
+
+  if (array == NULL) {
+    return result;
+  }
+
+  const jsize length = env->GetArrayLength(array);
+  result.reserve(length);
+
+  for (jsize i = 0; i < length; i++) {
+    jstring s = static_cast<jstring>(env->GetObjectArrayElement(array, i));
+    check(env);
+
+    if (s == NULL) {
+      result.push_back("");
+      continue;
+    }
+
+    const char* chars = env->GetStringUTFChars(s, NULL);
+    check(env);
+
+    result.push_back(std::string(chars, env->GetStringUTFLength(s)));
+    env->ReleaseStringUTFChars(s, chars);
+    env->DeleteLocalRef(s);
+  }
+
+  return result;
+}
+
+
+std::vector<long> Jvm::longs(jlongArray array)
+{
+  JNI::Env env;
+
+  std::vector<long> result;
+
+  if (array == NULL) {
+    return result;
+  }
+
+  const jsize length = env->GetArrayLength(array);
+
+  if (length > 0) {
+    std::vector<jlong> longs(length);
+    env->GetLongArrayRegion(array, 0, length, &longs[0]);
+    check(env);
+    result.assign(longs.begin(), longs.end());
+  }
+
+  return result;
+}
+
+
+jbyteArray Jvm::bytes(const std::string& bytes)
+{
+  JNI::Env env;
+
+  jbyteArray array = env->NewByteArray(bytes.size());
+  check(env);
+
+  if (!bytes.empty()) {
+    env->SetByteArrayRegion(
+        array,
+        0,
+        bytes.size(),
+        reinterpret_cast<const jbyte*>(bytes.data()));
+    check(env);
+  }
+
+  return array;
+}
+
+
+std::string Jvm::bytes(jbyteArray array)
+{
+  JNI::Env env;
+
+  std::string result;
+
+  if (array == NULL) {
+    return result;
+  }
+
+  const jsize length = env->GetArrayLength(array);
+
+  if (length > 0) {
+    result.resize(length);
+    env->GetByteArrayRegion(
+        array, 0, length, reinterpret_cast<jbyte*>(&result[0]));
+    check(env);
+  }
+
+  return result;
+}
+
+
 Jvm::Constructor Jvm::findConstructor(const ConstructorFinder& finder)
 {
   jmethodID id = findMethod(
@@ -295,7 +475,17 @@ Jvm::Method Jvm::findMethod(const MethodSignature& signature)
       signature.parameters,
       false);
 
-  return Jvm::Method(signature.clazz, id);
+  if (!signature.isNonvirtual) {
+    return Jvm::Method(signature.clazz, id);
+  }
+
+  // Note that the global reference to the class is never deleted
+  // (like methods, which are typically looked up once and cached).
+  jclass clazz = findClass(signature.clazz);
+  jclass nonvirtual = static_cast<jclass>(newGlobalRef(clazz));
+  deleteLocalRef(clazz);
+
+  return Jvm::Method(signature.clazz, id, nonvirtual);
 }
 
 
@@ -327,6 +517,24 @@ Jvm::Field Jvm::findStaticField(const Class& clazz, const std::string& name)
 }
 
 
+Jvm::Field Jvm::findStaticField(
+    const Class& clazz,
+    const std::string& name,
+    const Class& type)
+{
+  JNI::Env env;
+
+  jfieldID id = env->GetStaticFieldID(
+      findClass(clazz),
+      name.c_str(),
+      type.signature().c_str());
+
+  check(env);
+
+  return Jvm::Field(clazz, id);
+}
+
+
 jobject Jvm::invoke(const Constructor& ctor, ...)
 {
   JNI::Env env;
@@ -434,7 +642,11 @@ Jvm::~Jvm()
 jobject Jvm::newGlobalRef(const jobject object)
 {
   JNI::Env env;
-  return env->NewGlobalRef(object);
+  jobject reference = env->NewGlobalRef(object);
+  if (jsl::references::tracking() && reference != NULL) {
+    jsl::references::internal::created(reference);
+  }
+  return reference;
 }
 
 
@@ -442,11 +654,60 @@ void Jvm::deleteGlobalRef(const jobject object)
 {
   JNI::Env env;
   if (object != NULL) {
+    if (jsl::references::tracking()) {
+      jsl::references::internal::deleted(object);
+    }
     env->DeleteGlobalRef(object);
   }
 }
 
 
+jobject Jvm::newLocalRef(const jobject object)
+{
+  JNI::Env env;
+  return env->NewLocalRef(object);
+}
+
+
+void Jvm::deleteLocalRef(const jobject object)
+{
+  JNI::Env env;
+  if (object != NULL) {
+    env->DeleteLocalRef(object);
+  }
+}
+
+
+jweak Jvm::newWeakGlobalRef(const jobject object)
+{
+  JNI::Env env;
+  jweak reference = env->NewWeakGlobalRef(object);
+  if (jsl::references::tracking() && reference != NULL) {
+    jsl::references::internal::created(reference);
+  }
+  return reference;
+}
+
+
+void Jvm::deleteWeakGlobalRef(const jweak object)
+{
+  JNI::Env env;
+  if (object != NULL) {
+    if (jsl::references::tracking()) {
+      jsl::references::internal::deleted(object);
+    }
+    env->DeleteWeakGlobalRef(object);
+  }
+}
+
+
+bool Jvm::collected(const jweak object)
+{
+  JNI::Env env;
+  return env->IsSameObject(object, NULL) == JNI_TRUE;
+}
+
+
 jclass Jvm::findClass(const Class& clazz)
 {
   JNI::Env env;
@@ -725,6 +986,131 @@ double Jvm::invokeStaticV<double>(
 }
 
 
+template <>
+void Jvm::invokeNonvirtualV<void>(
+    const jobject receiver,
+    const jclass clazz,
+    const jmethodID id,
+    va_list args)
+{
+  JNI::Env env;
+  env->CallNonvirtualVoidMethodV(receiver, clazz, id, args);
+  check(env);
+}
+
+
+template <>
+jobject Jvm::invokeNonvirtualV<jobject>(
+    const jobject receiver,
+    const jclass clazz,
+    const jmethodID id,
+    va_list args)
+{
+  JNI::Env env;
+  jobject o = env->CallNonvirtualObjectMethodV(receiver, clazz, id, args);
+  check(env);
+  return o;
+}
+
+
+template <>
+bool Jvm::invokeNonvirtualV<bool>(
+    const jobject receiver,
+    const jclass clazz,
+    const jmethodID id,
+    va_list args)
+{
+  JNI::Env env;
+  bool b = env->CallNonvirtualBooleanMethodV(receiver, clazz, id, args);
+  check(env);
+  return b;
+}
+
+
+template <>
+char Jvm::invokeNonvirtualV<char>(
+    const jobject receiver,
+    const jclass clazz,
+    const jmethodID id,
+    va_list args)
+{
+  JNI::Env env;
+  char c = env->CallNonvirtualCharMethodV(receiver, clazz, id, args);
+  check(env);
+  return c;
+}
+
+
+template <>
+short Jvm::invokeNonvirtualV<short>(
+    const jobject receiver,
+    const jclass clazz,
+    const jmethodID id,
+    va_list args)
+{
+  JNI::Env env;
+  short s = env->CallNonvirtualShortMethodV(receiver, clazz, id, args);
+  check(env);
+  return s;
+}
+
+
+template <>
+int Jvm::invokeNonvirtualV<int>(
+    const jobject receiver,
+    const jclass clazz,
+    const jmethodID id,
+    va_list args)
+{
+  JNI::Env env;
+  int i = env->CallNonvirtualIntMethodV(receiver, clazz, id, args);
+  check(env);
+  return i;
+}
+
+
+template <>
+long Jvm::invokeNonvirtualV<long>(
+    const jobject receiver,
+    const jclass clazz,
+    const jmethodID id,
+    va_list args)
+{
+  JNI::Env env;
+  long l = env->CallNonvirtualLongMethodV(receiver, clazz, id, args);
+  check(env);
+  return l;
+}
+
+
+template <>
+float Jvm::invokeNonvirtualV<float>(
+    const jobject receiver,
+    const jclass clazz,
+    const jmethodID id,
+    va_list args)
+{
+  JNI::Env env;
+  float f = env->CallNonvirtualFloatMethodV(receiver, clazz, id, args);
+  check(env);
+  return f;
+}
+
+
+template <>
+double Jvm::invokeNonvirtualV<double>(
+    const jobject receiver,
+    const jclass clazz,
+    const jmethodID id,
+    va_list args)
+{
+  JNI::Env env;
+  double d = env->CallNonvirtualDoubleMethodV(receiver, clazz, id, args);
+  check(env);
+  return d;
+}
+
+
 void Jvm::check(JNIEnv* env)
 {
   if (env->ExceptionCheck() == JNI_TRUE) {
@@ -732,27 +1118,69 @@ void Jvm::check(JNIEnv* env)
       env->ExceptionDescribe();
       LOG(FATAL) << "Caught a JVM exception, not propagating";
     } else {
+      // Clear the exception before making a global reference to it
+      // (or calling anything else) since JNI doesn't allow that with
+      // an exception pending.
+      jthrowable t = env->ExceptionOccurred();
+      env->ExceptionClear();
+
       java::lang::Throwable throwable;
       java::lang::Object* object = &throwable;
-      object->object = env->ExceptionOccurred();
-      env->ExceptionClear();
+      object->reset(t);
       throw throwable;
     }
   }
 }
 
 
-// N.B. Both Jvm::invoke<void> and Jvm::invokeStatic<void> template
-// instantiations need to be defined AFTER template instantions that
-// they use (i.e., Jvm::invokeV<void>, Jvm::invokeStaticV<void>).
+// N.B. The Jvm::invoke<void>, Jvm::invokeNonvirtual<void> and
+// Jvm::invokeStatic<void> template instantiations need to be defined
+// AFTER template instantions that they use (i.e., Jvm::invokeV<void>,
+// Jvm::invokeNonvirtualV<void>, Jvm::invokeStaticV<void>).
 
 template <>
 void Jvm::invoke<void>(const jobject receiver, const Method& method, ...)
 {
   va_list args;
   va_start(args, method);
-  invokeV<void>(receiver, method.id, args);
+  if (method.nonvirtual != NULL) {
+    invokeNonvirtualV<void>(receiver, method.nonvirtual, method.id, args);
+  } else {
+    invokeV<void>(receiver, method.id, args);
+  }
+  va_end(args);
+}
+
+
+template <>
+void Jvm::invokeNonvirtual<void>(
+    const jobject receiver,
+    const Method& method,
+    ...)
+{
+  const jclass clazz = method.nonvirtual != NULL
+    ? method.nonvirtual
+    : findClass(method.clazz);
+
+  va_list args;
+  va_start(args, method);
+
+  try {
+    invokeNonvirtualV<void>(receiver, clazz, method.id, args);
+  } catch (...) {
+    // Clean up even if the invocation threw (see Jvm::check).
+    va_end(args);
+    if (clazz != method.nonvirtual) {
+      deleteLocalRef(clazz);
+    }
+    throw;
+  }
+
   va_end(args);
+
+  if (clazz != method.nonvirtual) {
+    deleteLocalRef(clazz);
+  }
 }
 
 
@@ -1,3 +1,13 @@
+#include <pthread.h>
+#include <stdint.h>
+
+#include <glog/logging.h>
+
+#include <string>
+
+#include <stout/hashmap.hpp>
+#include <stout/option.hpp>
+
 #include <org/apache/log4j.hpp>
 
 namespace org {
@@ -6,11 +16,178 @@ namespace log4j {
 
 // Static storage and initialization.
 const char LEVEL_OFF[] = "OFF";
+const char LEVEL_FATAL[] = "FATAL";
+const char LEVEL_ERROR[] = "ERROR";
+const char LEVEL_WARN[] = "WARN";
+const char LEVEL_INFO[] = "INFO";
+const char LEVEL_DEBUG[] = "DEBUG";
+const char LEVEL_TRACE[] = "TRACE";
+const char LEVEL_ALL[] = "ALL";
 
 Jvm::StaticVariable<Level, LEVEL_OFF> Level::OFF =
   Jvm::StaticVariable<Level, LEVEL_OFF>(
       Jvm::Class::named("org/apache/log4j/Level"));
 
+Jvm::StaticVariable<Level, LEVEL_FATAL> Level::FATAL =
+  Jvm::StaticVariable<Level, LEVEL_FATAL>(
+      Jvm::Class::named("org/apache/log4j/Level"));
+
+Jvm::StaticVariable<Level, LEVEL_ERROR> Level::ERROR =
+  Jvm::StaticVariable<Level, LEVEL_ERROR>(
+      Jvm::Class::named("org/apache/log4j/Level"));
+
+Jvm::StaticVariable<Level, LEVEL_WARN> Level::WARN =
+  Jvm::StaticVariable<Level, LEVEL_WARN>(
+      Jvm::Class::named("org/apache/log4j/Level"));
+
+Jvm::StaticVariable<Level, LEVEL_INFO> Level::INFO =
+  Jvm::StaticVariable<Level, LEVEL_INFO>(
+      Jvm::Class::named("org/apache/log4j/Level"));
+
+Jvm::StaticVariable<Level, LEVEL_DEBUG> Level::DEBUG =
+  Jvm::StaticVariable<Level, LEVEL_DEBUG>(
+      Jvm::Class::named("org/apache/log4j/Level"));
+
+Jvm::StaticVariable<Level, LEVEL_TRACE> Level::TRACE =
+  Jvm::StaticVariable<Level, LEVEL_TRACE>(
+      Jvm::Class::named("org/apache/log4j/Level"));
+
+Jvm::StaticVariable<Level, LEVEL_ALL> Level::ALL =
+  Jvm::StaticVariable<Level, LEVEL_ALL>(
+      Jvm::Class::named("org/apache/log4j/Level"));
+
+
+// Incremented every time levels (might) have changed, any snapshot of
+// an effective level from an older generation is stale. Snapshots
+// start out with generation 0 so we start at 1.
+static volatile uint32_t generation = 1;
+
+
+// Snapshots pack the level and generation into a single word (see
+// Logger::Snapshot).
+static uint64_t pack(int level, uint32_t number)
+{
+  return (static_cast<uint64_t>(number) << 32) |
+    static_cast<uint32_t>(level);
+}
+
+
+static uint32_t generationOf(uint64_t state)
+{
+  return static_cast<uint32_t>(state >> 32);
+}
+
+
+void Category::levelsChanged()
+{
+  __sync_fetch_and_add(&generation, 1);
+}
+
+
+// Cache of loggers by name. Loggers are never removed from the cache
+// (nor from log4j's hierarchy) so we can hand out pointers to their
+// snapshots. Lookups only take a read lock.
+static pthread_rwlock_t lock = PTHREAD_RWLOCK_INITIALIZER;
+static hashmap<std::string, Logger*>* loggers =
+  new hashmap<std::string, Logger*>();
+
+
+Logger* Logger::create(jobject object)
+{
+  Logger* logger = new Logger(object);
+  logger->snapshot = new Snapshot();
+  logger->snapshot->state = pack(Level::OFF_INT, 0); // Stale.
+  return logger;
+}
+
+
+Logger Logger::getRootLogger()
+{
+  static Jvm::Method method = Jvm::get()->findStaticMethod(
+      Jvm::Class::named("org/apache/log4j/Logger")
+      .method("getRootLogger")
+      .returns(Jvm::Class::named("org/apache/log4j/Logger")));
+
+  // Note that the root logger is not cached by name since any name,
+  // including "root", is also a valid name for a non-root logger.
+  static Logger* logger = create(Jvm::get()->invokeStatic<jobject>(method));
+
+  return *logger;
+}
+
+
+Logger Logger::getLogger(const std::string& name)
+{
+  pthread_rwlock_rdlock(&lock);
+  Option<Logger*> cached = loggers->get(name);
+  pthread_rwlock_unlock(&lock);
+
+  if (cached.isSome()) {
+    return *cached.get();
+  }
+
+  static Jvm::Method method = Jvm::get()->findStaticMethod(
+      Jvm::Class::named("org/apache/log4j/Logger")
+      .method("getLogger")
+      .parameter(Jvm::Class::STRING)
+      .returns(Jvm::Class::named("org/apache/log4j/Logger")));
+
+  // Look up the logger outside of the lock, if we race with another
+  // thread we'll just drop our copy in favor of theirs.
+  Logger* logger = create(
+      Jvm::get()->invokeStatic<jobject>(method, Jvm::get()->string(name)));
+
+  pthread_rwlock_wrlock(&lock);
+  if (loggers->contains(name)) {
+    delete logger->snapshot;
+    delete logger;
+  } else {
+    (*loggers)[name] = logger;
+  }
+  Logger result = *(*loggers)[name];
+  pthread_rwlock_unlock(&lock);
+
+  return result;
+}
+
+
+int Logger::effectiveLevel() const
+{
+  CHECK_NOTNULL(snapshot);
+
+  const uint32_t current = generation;
+
+  // Aligned 64-bit loads are atomic on 64-bit platforms, elsewhere
+  // read through a (no-op) atomic add.
+#ifdef __LP64__
+  uint64_t state = snapshot->state;
+#else
+  uint64_t state = __sync_fetch_and_add(&snapshot->state, 0);
+#endif
+
+  if (generationOf(state) == current) {
+    return static_cast<int>(static_cast<uint32_t>(state));
+  }
+
+  // Note that the level is computed after reading the generation, so
+  // it is at least as recent as that generation.
+  const int level = getEffectiveLevel().toInt();
+  const uint64_t refreshed = pack(level, current);
+
+  // Only replace snapshots of older generations, a slower refresh
+  // racing with ours must not overwrite a newer one.
+  while (static_cast<int32_t>(current - generationOf(state)) > 0) {
+    const uint64_t previous =
+      __sync_val_compare_and_swap(&snapshot->state, state, refreshed);
+    if (previous == state) {
+      break;
+    }
+    state = previous;
+  }
+
+  return level;
+}
+
 } // namespace log4j {
 } // namespace apache {
 } // namespace org {
@@ -0,0 +1,35 @@
+#include <org/apache/zookeeper.hpp>
+
+namespace org {
+namespace apache {
+namespace zookeeper {
+
+// Static storage and initialization.
+const char CREATE_MODE_PERSISTENT[] = "PERSISTENT";
+const char CREATE_MODE_PERSISTENT_SEQUENTIAL[] = "PERSISTENT_SEQUENTIAL";
+const char CREATE_MODE_EPHEMERAL[] = "EPHEMERAL";
+const char CREATE_MODE_EPHEMERAL_SEQUENTIAL[] = "EPHEMERAL_SEQUENTIAL";
+
+Jvm::StaticVariable<CreateMode, CREATE_MODE_PERSISTENT>
+  CreateMode::PERSISTENT =
+    Jvm::StaticVariable<CreateMode, CREATE_MODE_PERSISTENT>(
+        Jvm::Class::named("org/apache/zookeeper/CreateMode"));
+
+Jvm::StaticVariable<CreateMode, CREATE_MODE_PERSISTENT_SEQUENTIAL>
+  CreateMode::PERSISTENT_SEQUENTIAL =
+    Jvm::StaticVariable<CreateMode, CREATE_MODE_PERSISTENT_SEQUENTIAL>(
+        Jvm::Class::named("org/apache/zookeeper/CreateMode"));
+
+Jvm::StaticVariable<CreateMode, CREATE_MODE_EPHEMERAL>
+  CreateMode::EPHEMERAL =
+    Jvm::StaticVariable<CreateMode, CREATE_MODE_EPHEMERAL>(
+        Jvm::Class::named("org/apache/zookeeper/CreateMode"));
+
+Jvm::StaticVariable<CreateMode, CREATE_MODE_EPHEMERAL_SEQUENTIAL>
+  CreateMode::EPHEMERAL_SEQUENTIAL =
+    Jvm::StaticVariable<CreateMode, CREATE_MODE_EPHEMERAL_SEQUENTIAL>(
+        Jvm::Class::named("org/apache/zookeeper/CreateMode"));
+
+} // namespace zookeeper {
+} // namespace apache {
+} // namespace org {
@@ -1,24 +1,104 @@
 #include <glog/logging.h>
 
 #include <string>
+#include <vector>
 
+#include <stout/duration.hpp>
 #include <stout/os.hpp>
+#include <stout/path.hpp>
 #include <stout/try.hpp>
 
+#include <jvm.hpp>
+
 #include <java/io.hpp>
 
+#include <jsl/classes.hpp>
+#include <jsl/io.hpp>
+#include <jsl/management.hpp>
+#include <jsl/references.hpp>
+
 
 int main(int argc, char** argv)
 {
   FLAGS_logtostderr = true; // Log to stderr instead of files by default.
   google::InitGoogleLogging(argv[0]);
 
+  std::vector<std::string> options;
+  options.push_back("-Djava.class.path=" JSL_JAR);
+
+  Try<Jvm*> jvm = Jvm::create(options);
+  CHECK(jvm.isSome()) << jvm.error();
+
   Try<std::string> directory = os::mkdtemp();
   CHECK(directory.isSome());
 
+  CHECK(os::write(path::join(directory.get(), "file"), "data").isSome());
+
   java::io::File file(directory.get());
 
   file.deleteOnExit();
 
+  CHECK(file.isDirectory());
+  CHECK_EQ(1u, file.list().size());
+  CHECK_EQ("file", file.list().front());
+  CHECK_EQ(1u, file.listFiles().size());
+  CHECK_EQ(4, file.listFiles().front().length());
+
+  std::vector<std::string> paths;
+  paths.push_back(directory.get());
+  paths.push_back(path::join(directory.get(), "file"));
+  paths.push_back(path::join(directory.get(), "missing"));
+
+  const std::vector<jsl::io::Files::Status> statuses =
+    jsl::io::Files::stat(paths);
+
+  CHECK_EQ(3u, statuses.size());
+  CHECK(statuses[0].exists && statuses[0].directory);
+  CHECK(statuses[1].exists && statuses[1].file);
+  CHECK_EQ(4, statuses[1].length);
+  CHECK(!statuses[2].exists);
+
+  CHECK(os::rm(path::join(directory.get(), "file")).isSome());
+
+  jsl::management::Sampler sampler(Milliseconds(10));
+
+  while (sampler.latest().isNone()) {
+    os::sleep(Milliseconds(1));
+  }
+
+  CHECK_GT(sampler.latest().get().heap.used, 0);
+  CHECK_GT(sampler.latest().get().threads, 0);
+  CHECK(!sampler.latest().get().collectors.empty());
+
+  jsl::references::start();
+
+  {
+    java::io::File copy = file;
+    copy = copy; // Must not delete the reference it's assigning.
+    CHECK(copy.exists());
+    CHECK_EQ(1, jsl::references::live());
+    CHECK_EQ(1u, jsl::references::sites().size());
+  }
+
+  CHECK_EQ(0, jsl::references::live());
+
+  jsl::references::stop();
+
+  java::lang::Weak<java::io::File> weak(file);
+  CHECK(!weak.collected());
+  CHECK(weak.get().isSome());
+  CHECK(weak.get().get().isDirectory());
+
+  Try<std::string> jar = os::read(JSL_JAR);
+  CHECK(jar.isSome()) << jar.error();
+
+  jsl::classes::Embedded embedded;
+  CHECK(embedded.addJar(jar.get().data(), jar.get().size()).isSome());
+  CHECK(embedded.contains("jsl/io/Files"));
+  CHECK(embedded.contains("jsl/lang/NativeInvocationHandler"));
+
+  Try<Nothing> define = embedded.define();
+  CHECK(define.isSome()) << define.error();
+
   return file.exists() ? 0 : -1;
 }
@@ -0,0 +1,241 @@
+// Load generator for ZooKeeper: starts an embedded (standalone)
+// server and drives it with asynchronous clients, each keeping a
+// fixed number of operations outstanding, then reports the startup
+// time and throughput.
+//
+// Usage: zookeeper-load CLASSPATH [PROFILE [CLIENTS [DEPTH [SECONDS [READS]]]]]
+//
+// The classpath must include jsl.jar as well as the ZooKeeper and
+// log4j jars. PROFILE is either 'default' (ZooKeeper's own settings)
+// or 'ephemeral' (see jsl::zookeeper::Server::Options). Since some
+// settings are fixed once the first server in a JVM starts, compare
+// profiles by running once per profile. READS is the percentage of
+// operations that are reads ('getData'), the rest are writes
+// ('setData'), all on one node per client; use 0 to measure write
+// throughput.
+
+#include <stdio.h>
+#include <stdlib.h> // For exit.
+
+#include <glog/logging.h>
+
+#include <string>
+#include <vector>
+
+#include <stout/duration.hpp>
+#include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
+#include <stout/numify.hpp>
+#include <stout/os.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+
+#include <jvm.hpp>
+
+#include <jsl/log4j.hpp>
+#include <jsl/zookeeper.hpp>
+
+#include <org/apache/log4j.hpp>
+#include <org/apache/zookeeper.hpp>
+
+using jsl::zookeeper::Client;
+using jsl::zookeeper::Server;
+
+using org::apache::zookeeper::CreateMode;
+
+
+// Issues operations on a single node through one client, issuing the
+// next operation as soon as one completes (i.e., from the callback,
+// which always runs on the client's event thread).
+class Worker
+{
+public:
+  Worker(Client* _client, const std::string& _path, int _reads)
+    : client(_client),
+      path(_path),
+      data(100, 'x'),
+      reads(_reads),
+      running(true),
+      count(0),
+      completed(0),
+      failed(0),
+      callback(lambda::bind(&Worker::complete, this, lambda::_1)) {}
+
+  void issue()
+  {
+    // Note that the first operations get issued from the main thread
+    // while the event thread might already be issuing more.
+    if (__sync_fetch_and_add(&count, 1) % 100 < (unsigned int) reads) {
+      client->getData(path, callback);
+    } else {
+      client->setData(path, data, -1, callback);
+    }
+  }
+
+  void stop() { running = false; }
+
+  long succeeded() const { return completed; }
+  long errors() const { return failed; }
+
+private:
+  void complete(const Client::Result& result)
+  {
+    if (result.rc == 0) {
+      __sync_fetch_and_add(&completed, 1);
+    } else {
+      __sync_fetch_and_add(&failed, 1);
+    }
+
+    if (running) {
+      issue();
+    }
+  }
+
+  Client* client;
+  const std::string path;
+  const std::string data;
+  const int reads;
+
+  volatile bool running;
+  volatile unsigned int count;
+  volatile long completed;
+  volatile long failed;
+
+  const Client::Callback callback;
+};
+
+
+static void usage(const char* argv0)
+{
+  fprintf(stderr,
+          "Usage: %s CLASSPATH "
+          "[PROFILE [CLIENTS [DEPTH [SECONDS [READS]]]]]\n",
+          argv0);
+}
+
+
+static int argument(int argc, char** argv, int index, int _default)
+{
+  if (index >= argc) {
+    return _default;
+  }
+
+  Try<int> value = numify<int>(argv[index]);
+  if (value.isError() || value.get() < 0) {
+    usage(argv[0]);
+    exit(1);
+  }
+
+  return value.get();
+}
+
+
+int main(int argc, char** argv)
+{
+  FLAGS_logtostderr = true; // Log to stderr instead of files by default.
+  google::InitGoogleLogging(argv[0]);
+
+  if (argc < 2) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  const std::string profile = argc > 2 ? argv[2] : "default";
+  const int clients = argument(argc, argv, 3, 4);
+  const int depth = argument(argc, argv, 4, 64);
+  const int seconds = argument(argc, argv, 5, 10);
+  const int reads = argument(argc, argv, 6, 90);
+
+  Server::Options options;
+  if (profile == "ephemeral") {
+    options = Server::Options::ephemeral();
+  } else if (profile != "default") {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::vector<std::string> jvmOptions;
+  jvmOptions.push_back("-Djava.class.path=" + std::string(argv[1]));
+
+  Try<Jvm*> jvm = Jvm::create(jvmOptions);
+  CHECK(jvm.isSome()) << jvm.error();
+
+  // Send ZooKeeper's logging through glog, warnings only.
+  jsl::log4j::GlogAppender appender;
+  org::apache::log4j::Logger root =
+    org::apache::log4j::Logger::getRootLogger();
+  root.addAppender(appender.appender());
+  root.setLevel(org::apache::log4j::Level::WARN);
+
+  Server server(options);
+
+  Try<Duration> startup = server.start();
+  CHECK(startup.isSome()) << startup.error();
+
+  const std::string servers = server.connectString();
+
+  std::vector<Client*> sessions;
+  std::vector<Worker*> workers;
+
+  for (int i = 0; i < clients; i++) {
+    Client* client = new Client(servers, Seconds(10));
+    const std::string path = "/load-" + stringify(i);
+
+    client->create(path, "", CreateMode::PERSISTENT, Client::Callback());
+    CHECK(client->await(Seconds(10)))
+      << "Timed out creating " << path << " (is ZooKeeper running?)";
+
+    sessions.push_back(client);
+    workers.push_back(new Worker(client, path, reads));
+  }
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  foreach (Worker* worker, workers) {
+    for (int i = 0; i < depth; i++) {
+      worker->issue();
+    }
+  }
+
+  os::sleep(Seconds(seconds));
+
+  foreach (Worker* worker, workers) {
+    worker->stop();
+  }
+
+  foreach (Client* client, sessions) {
+    CHECK(client->await(Seconds(10)));
+  }
+
+  stopwatch.stop();
+
+  long succeeded = 0;
+  long failed = 0;
+  foreach (Worker* worker, workers) {
+    succeeded += worker->succeeded();
+    failed += worker->errors();
+    delete worker;
+  }
+
+  foreach (Client* client, sessions) {
+    delete client;
+  }
+
+  Try<Nothing> shutdown = server.shutdown();
+  if (shutdown.isError()) {
+    LOG(WARNING) << "Failed to shut down ZooKeeper gracefully: "
+                 << shutdown.error();
+  }
+
+  const double elapsed = stopwatch.elapsed().secs();
+
+  printf("profile=%s clients=%d depth=%d reads=%d%%: started in %.0f ms, "
+         "%ld operations (%ld failed) in %.2f seconds, "
+         "%.0f operations/second\n",
+         profile.c_str(), clients, depth, reads, startup.get().ms(),
+         succeeded, failed, elapsed, succeeded / elapsed);
+
+  return failed == 0 ? 0 : 1;
+}